@@ -1,14 +1,16 @@
-#include "aligner.h"
-#include "opencv2/highgui/highgui.hpp"
+#include "Aligner.h"
+#include "opencv2/imgproc/imgproc.hpp"
+#include <algorithm>
 
 using namespace cvip;
 
 /**
  * Constructor helper, compute eye centers, they will be used later.
  *
+ * @param  DetectionRect* eyes - the pair of eye rects
  * @return void
  */
-void Aligner::computeEyeCenters(const std::vector<DetectionRect>& eyes)
+void Aligner::computeEyeCenters(const DetectionRect* eyes)
 {
     unsigned short lIdx, rIdx;
 
@@ -30,125 +32,134 @@ void Aligner::computeEyeCenters(const std::vector<DetectionRect>& eyes)
 }
 
 /**
- * Return aligned face image
+ * Return aligned face image, as large as the strict face rect.
  *
  * @return cv::Mat
  */
 cv::Mat Aligner::getAligned()
 {
-    int mp = maxPadding();
+    double c, s, x, y;
+    int size = round(strictRect(c, s, x, y));
 
-    // limit padding to a half face
-    if (mp > r->width*0.5)
-        mp = std::floor(r->width*0.5);
+    cv::Mat strictFace;
+    alignTo(strictFace, std::max(size, 1));
 
-    // the rect given with the relative coordinates within the new box
-    cv::Rect rRel(mp, mp, r->width, r->height);
-    cv::Mat cropped(im->I, cv::Rect(r->x1-mp, r->y1-mp, r->width+2*mp, r->height+2*mp));
-
-    // convert eye coords to new relative coords after face is cropped
-    updateEyes(-mp+r->x1, -mp+r->y1);
-
-    // rotate image and eye coords
-    double theta = rotAngle();
-    cv::Mat rotated = cvip::imrotate(cropped, theta*180/cvip::PI);
-    rotateEyes(theta, rotated.cols/2, rotated.rows/2);
-
-    // find strict rect and update eyes coords again
-    cv::Rect strict = strictRect();
-    updateEyes(strict.x, strict.y);
-
-    cv::Mat strictFace(rotated, strict);
-    /*
-    cv::circle(strictFace, lEye, 4,  CV_RGB(255,0,0),2);
-    cv::circle(strictFace, rEye, 4, cv::Scalar::all(255),2);
-    cv::imshow("minili", strictFace);
-    cv::waitKey(100000);
-    */
     return strictFace;
 }
 
 /**
- * Guess strict face rectangle from eye centers data
+ * Aligned face resampled to size x size pixels: a single warp from im,
+ * out of image pixels replicate the border.
  *
- * @return cv::Rect
+ * @param  cv::Mat& dst - output, reused if it is size x size of im's type
+ * @param  uint size
+ * @return void
  */
-cv::Rect Aligner::strictRect() const
+void Aligner::alignTo(cv::Mat& dst, uint size) const
 {
-    size_t eyeDist = fabs(lEye.x-rEye.x);
-    double eyeSize = eyeDist/2.;
-
-    size_t lxStartGuess = (double)lEye.x - 1.5*eyeSize;
-    size_t lxEndGuess = lxStartGuess + 5*eyeSize;
-    size_t rxEndGuess = (double)rEye.x + 1.5*eyeSize;
-    size_t rxStartGuess = rxEndGuess - 5*eyeSize;
-
-    size_t xStartGuess = round((lxStartGuess+rxStartGuess)/2.);
-    size_t xEndGuess = round((lxEndGuess+rxEndGuess)/2.);
+    double m[6];
+    warpMap(size, m);
 
-    size_t yStartGuess = (double)lEye.y - 1.5*eyeSize;
-
-    size_t faceSize = xEndGuess-xStartGuess;
-
-    return cv::Rect(xStartGuess, yStartGuess, faceSize, faceSize);
+    cv::warpAffine(im->I, dst, cv::Mat(2, 3, CV_64F, m), cv::Size(size, size),
+                   cv::INTER_LINEAR | cv::WARP_INVERSE_MAP, cv::BORDER_REPLICATE);
 }
 
 /**
- * Update eye coords, convert them to relative after
- * face is cropped
+ * Align all faces of a frame, e.g. for a recognizer taking a batch.
+ * Faces are cut in jobs of FACES_PER_JOB, run by the threads of pool
+ * and the calling thread; pool must not be one whose job calls this.
  *
- * @param dx - Crop window offset, x and y
- * @param dy
+ * @param  Image* im
+ * @param  DetectionRect* faces - n face rects within im
+ * @param  DetectionRect* eyes - 2n eye rects, a pair per face
+ * @param  uint n
+ * @param  cv::Mat& out - n x size*size of im's type, allocated if it does not fit
+ * @param  uint size - side of the aligned faces
+ * @param  WorkerPool& pool
  * @return void
  */
-void Aligner::updateEyes(unsigned int dx, unsigned int dy)
+void Aligner::alignBatch(const Image* im, const DetectionRect* faces, const DetectionRect* eyes, uint n,
+                         cv::Mat& out, uint size, WorkerPool& pool)
 {
-    lEye.x -= dx;
-    lEye.y -= dy;
-    rEye.x -= dx;
-    rEye.y -= dy;
+    int type = im->I.type();
+
+    if (out.rows != (int)n || out.cols != (int)(size*size) || out.type() != type)
+        out.create(n, size*size, type);
+
+    uint numJobs = (n + FACES_PER_JOB-1)/FACES_PER_JOB;
+
+    pool.run(numJobs, [=, &out](uint job)
+    {
+        uint end = std::min(n, (job+1)*FACES_PER_JOB);
+
+        for (uint i=job*FACES_PER_JOB; i<end; ++i)
+        {
+            // a header on row i, alignTo() writes in place
+            cv::Mat face(size, size, out.type(), out.ptr(i));
+            Aligner(im, faces+i, eyes+2*i).alignTo(face, size);
+        }
+    });
 }
 
 /**
- * Rotate eyes n radians
+ * Guess strict face rectangle from eye centers data. Eyes are
+ * de-rotated about their midpoint, p' = [c s; -s c]*(p - mid), and the
+ * rect is guessed around them in these coords.
  *
- * @param  angle
- * @return voide
+ * @param  double& c - output, cos of the de-rotation angle
+ * @param  double& s - output, sin
+ * @param  double& x - output, top left corner
+ * @param  double& y
+ * @return double - side of the square rect
  */
-void Aligner::rotateEyes(double theta, double oX, double oY)
+double Aligner::strictRect(double& c, double& s, double& x, double& y) const
 {
-    theta = -theta;
+    double theta = rotAngle();
+    c = std::cos(theta);
+    s = std::sin(theta);
 
-    lEye.x -= oX;
-    lEye.y -= oY;
+    double mx = (lEye.x+rEye.x)/2., my = (lEye.y+rEye.y)/2.;
 
-    rEye.x -= oX;
-    rEye.y -= oY;
+    double lx = c*(lEye.x-mx) + s*(lEye.y-my);
+    double ly = -s*(lEye.x-mx) + c*(lEye.y-my);
+    double rx = c*(rEye.x-mx) + s*(rEye.y-my);
 
-    lEye = Aligner::ptrotate(lEye, theta);
-    rEye = Aligner::ptrotate(rEye, theta);
+    double eyeDist = std::fabs(lx-rx);
+    double eyeSize = eyeDist/2.;
+
+    double lxStartGuess = lx - 1.5*eyeSize;
+    double lxEndGuess = lxStartGuess + 5*eyeSize;
+    double rxEndGuess = rx + 1.5*eyeSize;
+    double rxStartGuess = rxEndGuess - 5*eyeSize;
 
-    lEye.x += oX;
-    lEye.y += oY;
+    x = (lxStartGuess+rxStartGuess)/2.;
+    y = ly - 1.5*eyeSize;
 
-    rEye.x += oX;
-    rEye.y += oY;
+    return (lxEndGuess+rxEndGuess)/2. - x;
 }
 
 /**
- * Rotate a single point
+ * Inverse map of the alignment: output pixel (u,v) of a size x size
+ * face samples im at m*(u,v,1), i.e. the strict rect point
+ * (x + u*scale, y + v*scale) rotated back about the eye midpoint.
  *
- * @param  cv::Point2i - input point
- * @param  double      - rot angle in radians
- * @return cv::Point2i
+ * @param  uint size
+ * @param  double* m - output, 2x3 row major
+ * @return void
  */
-cv::Point2i Aligner::ptrotate(const cv::Point2i& src, double theta)
+void Aligner::warpMap(uint size, double* m) const
 {
-    cv::Point2i dst;
-    dst.x = cos(theta)*src.x - sin(theta)*src.y;
-    dst.y = sin(theta)*src.x + cos(theta)*src.y;
+    double c, s, x, y;
+    double scale = strictRect(c, s, x, y)/size;
+
+    double mx = (lEye.x+rEye.x)/2., my = (lEye.y+rEye.y)/2.;
 
-    return dst;
+    m[0] = c*scale;
+    m[1] = -s*scale;
+    m[2] = mx + c*x - s*y;
+    m[3] = s*scale;
+    m[4] = c*scale;
+    m[5] = my + s*x + c*y;
 }
 
 /**
@@ -172,22 +183,3 @@ double Aligner::rotAngle() const
 
     return theta;
 }
-
-/**
- * Check rectangle boundaries and return the largest
- * rectangle you can.
- *
- * @return double
- */
-int Aligner::maxPadding() const
-{
-    int maxL = r->x1;
-    int maxR = im->width-r->x2-1;
-    int maxU = r->y1;
-    int maxB = im->height-r->y2-1;
-
-    using std::min;
-
-    // calculate the minimum rate that this box can extand
-    return min(maxL, min(maxR, min(maxU, maxB)));
-}
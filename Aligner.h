@@ -2,6 +2,7 @@
 #define ALIGNER_H
 
 #include "Image.h"
+#include "WorkerPool.h"
 
 namespace cvip
 {
@@ -10,6 +11,14 @@ namespace cvip
      * 1) Using two eyes for frontal view
      * 2) ... another method for profile view
      *
+     * The face is de-rotated so that the eyes are level and the strict
+     * face rectangle is cut around them. Both are done by one affine
+     * warp from the input image straight into the output, thus only the
+     * pixels that are kept are ever interpolated. alignBatch() aligns all
+     * faces of a frame in parallel into one preallocated matrix, on a
+     * WorkerPool (the shared one by default), so no thread is started
+     * per frame.
+     *
      * @author evangelos sariyanidi / sariyanidi at gmail dot com
      * @date may 2011
      */
@@ -18,35 +27,43 @@ namespace cvip
     public:
         // constructor, use pointers only
         Aligner(const Image* _im, const DetectionRect* _r, const std::vector<DetectionRect>& eyes)
+            : im(_im), r(_r) { computeEyeCenters(&eyes[0]); }
+
+        // eyes points to the pair of eye rects
+        Aligner(const Image* _im, const DetectionRect* _r, const DetectionRect* eyes)
             : im(_im), r(_r) { computeEyeCenters(eyes); }
 
         // return registered and cropped face
         cv::Mat getAligned();
 
+        // registered face resampled to size x size pixels into dst (of im's type,
+        // allocated only if it does not fit)
+        void alignTo(cv::Mat& dst, uint size) const;
+
+        // align n faces of im in parallel on pool: face i, with eyes eyes[2i] and eyes[2i+1],
+        // goes to row i of out as size*size pixels; out is allocated only if it does not fit
+        static void alignBatch(const Image* im, const DetectionRect* faces, const DetectionRect* eyes, uint n,
+                               cv::Mat& out, uint size, cvip::WorkerPool& pool = cvip::WorkerPool::shared());
+
+        //! faces a job of alignBatch() aligns, a batch of this many runs on the calling thread
+        static const uint FACES_PER_JOB = 4;
+
     private:
         // coordinates of eye centers
         cv::Point2i lEye, rEye;
 
-        // face will be cropped, update eye coords
-        void updateEyes(unsigned int dx, unsigned int dy);
-
         // get de-rotation angle in radians
         double rotAngle() const;
 
-        // rotate eye coords
-        void rotateEyes(double angle, double oX, double oY);
-
-        // how much can this box expand
-        int maxPadding() const;
-
-        // compute lEye, rEye
-        void computeEyeCenters(const std::vector<DetectionRect>& eyes);
+        // compute lEye, rEye from a pair of eye rects
+        void computeEyeCenters(const DetectionRect* eyes);
 
-        // rotate point
-        static cv::Point2i ptrotate(const cv::Point2i& src, double theta);
+        // strict face rect in coords de-rotated about the eye midpoint;
+        // the rotation goes to c, s and the side of the square is returned
+        double strictRect(double& c, double& s, double& x, double& y) const;
 
-        // compute strict rect from eye coords
-        cv::Rect strictRect() const;
+        // affine map from a size x size output to im
+        void warpMap(uint size, double* m) const;
 
         // the whole input im
         const Image* im;
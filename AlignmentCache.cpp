@@ -0,0 +1,143 @@
+#include "AlignmentCache.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace cvip;
+
+/**
+ * Aligned face of a track, from the cache if the track is still where
+ * its face was aligned and the face is young enough.
+ *
+ * @param  uint id - track id
+ * @param  DetectionRect& rect - track rect at this frame
+ * @param  Image* im - this frame, re-warped from with REWARP
+ * @param  cv::Mat& face - output, if true is returned
+ * @return bool - false if the face must be aligned anew (see store())
+ */
+bool AlignmentCache::fetch(uint id, const DetectionRect& rect, const Image* im, cv::Mat& face)
+{
+    Entry* e = find(id);
+
+    if (!e || frame - e->frame >= config.maxAge || moved(*e, rect)) {
+        ++numMisses;
+        return false;
+    }
+
+    if (config.reuse == REWARP)
+    {
+        // carry the eyes along with the track rect
+        double scale = (double)rect.width/std::max(e->rect.width, 1);
+        double cx0 = (e->rect.x1+e->rect.x2)/2., cy0 = (e->rect.y1+e->rect.y2)/2.;
+        double cx = (rect.x1+rect.x2)/2., cy = (rect.y1+rect.y2)/2.;
+
+        DetectionRect eyes[2];
+        for (uint i=0; i<2; ++i)
+        {
+            const DetectionRect& eye = e->eyes[i];
+            int x1 = round(cx + (eye.x1-cx0)*scale);
+            int y1 = round(cy + (eye.y1-cy0)*scale);
+
+            eyes[i] = DetectionRect(x1, y1, round(eye.width*scale), round(eye.height*scale), eye.angle, eye.scale);
+        }
+
+        Aligner(im, &rect, eyes).alignTo(e->face, size);
+    }
+
+    ++numHits;
+    face = e->face;
+    return true;
+}
+
+/**
+ * Align a face from its eyes and cache it with the track rect, for the
+ * next frames.
+ *
+ * @param  uint id - track id
+ * @param  DetectionRect& rect - track rect at this frame
+ * @param  Image* im
+ * @param  DetectionRect* eyes - the pair of eye rects
+ * @param  cv::Mat& face - output
+ * @return void
+ */
+void AlignmentCache::store(uint id, const DetectionRect& rect, const Image* im, const DetectionRect* eyes, cv::Mat& face)
+{
+    Entry* found = find(id);
+
+    if (!found)
+    {
+        // an expired track's entry is taken over, its buffer reused
+        uint k;
+        if (freeEntries.empty()) {
+            k = entries.size();
+            entries.push_back(Entry());
+        } else {
+            k = freeEntries.back();
+            freeEntries.pop_back();
+        }
+
+        index[id] = k;
+        found = &entries[k];
+    }
+
+    Entry& e = *found;
+    e.id = id;
+    e.rect = rect;
+    e.eyes[0] = eyes[0];
+    e.eyes[1] = eyes[1];
+    e.frame = frame;
+
+    Aligner(im, &rect, eyes).alignTo(e.face, size);
+    face = e.face;
+}
+
+AlignmentCache::Entry* AlignmentCache::find(uint id)
+{
+    std::map<uint, uint>::iterator it = index.find(id);
+
+    return it == index.end() ? 0 : &entries[it->second];
+}
+
+/**
+ * Start a new frame. Entries aligned maxAge frames ago or earlier can't
+ * hit anymore: their ids are forgotten and the entries kept for reuse,
+ * so the cache holds no more than the tracks of the last maxAge frames.
+ *
+ * @return void
+ */
+void AlignmentCache::nextFrame()
+{
+    ++frame;
+
+    for (std::map<uint, uint>::iterator it = index.begin(); it != index.end(); )
+    {
+        Entry& e = entries[it->second];
+
+        if (frame - e.frame < config.maxAge) {
+            ++it;
+            continue;
+        }
+
+        e.id = NONE;
+        freeEntries.push_back(it->second);
+        index.erase(it++);
+    }
+}
+
+/**
+ * Compare rect with the track rect at alignment: center shift relative
+ * to the width, and width ratio.
+ *
+ * @return bool
+ */
+bool AlignmentCache::moved(const Entry& e, const DetectionRect& rect) const
+{
+    double w0 = std::max(e.rect.width, 1);
+
+    double dx = ((rect.x1+rect.x2) - (e.rect.x1+e.rect.x2))/2.;
+    double dy = ((rect.y1+rect.y2) - (e.rect.y1+e.rect.y2))/2.;
+
+    if (std::fabs(dx) > config.maxShift*w0 || std::fabs(dy) > config.maxShift*w0)
+        return true;
+
+    return std::fabs(rect.width/w0 - 1.) > config.maxScale;
+}
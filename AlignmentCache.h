@@ -0,0 +1,127 @@
+#ifndef ALIGNMENTCACHE_H
+#define ALIGNMENTCACHE_H
+
+#include "Aligner.h"
+#include <map>
+#include <vector>
+
+namespace cvip
+{
+    /**
+     * Aligned faces of tracks, kept between frames so that a track that
+     * barely moves needs no eye detection and no alignment. Entries are
+     * keyed by track id (TrackItem::id, TrackOutput::id) and hold the
+     * track rect and eye rects at alignment, and the aligned face.
+     *
+     * fetch() hits while the track rect stays within maxShift (of the
+     * width, for the center) and maxScale (relative, for the width) of
+     * the rect at alignment and for maxAge frames; then, depending on
+     * reuse, the face is either the cached one or aligned again from the
+     * current image with the cached eyes, moved along with the track.
+     * On a miss the caller detects the eyes and calls store().
+     *
+     * Track ids are never reused, so entries that can no longer hit
+     * (older than maxAge) are freed by nextFrame(), and their buffers
+     * reused by the next store(). One cache serves one stream and is not
+     * thread safe.
+     *
+     * @author evangelos sariyanidi / sariyanidi[at]gmail[dot]com
+     * @date april 2011
+     */
+    class AlignmentCache
+    {
+    public:
+        //! what a hit gives
+        enum Reuse
+        {
+            CROP,       //! the cached face as it is
+            REWARP      //! the face aligned again from the current image with the cached eyes
+        };
+
+        struct Config
+        {
+            Config() : maxShift(0.05f), maxScale(0.05f), maxAge(30), reuse(CROP) {}
+
+            //! center may move this much of the width
+            float maxShift;
+
+            //! width may change this much, relative
+            float maxScale;
+
+            //! eyes are detected again after this many frames
+            uint maxAge;
+
+            Reuse reuse;
+        };
+
+        // faces are aligned to size x size pixels
+        AlignmentCache(uint _size, const Config& _config = Config())
+            : size(_size), config(_config), frame(0), numHits(0), numMisses(0) {}
+
+        // start a new frame, free the entries that have expired
+        void nextFrame();
+
+        // aligned face of track id at rect, false if the eyes are needed (see store());
+        // face shares the cached pixels, valid until the next call for id
+        bool fetch(uint id, const cvip::DetectionRect& rect, const cvip::Image* im, cv::Mat& face);
+
+        // align track id at rect from eyes (a pair of eye rects) and cache it
+        void store(uint id, const cvip::DetectionRect& rect, const cvip::Image* im,
+                   const cvip::DetectionRect* eyes, cv::Mat& face);
+
+        // forget all faces
+        void clear() { entries.clear(); index.clear(); freeEntries.clear(); }
+
+        void setConfig(const Config& _config) { config = _config; }
+        const Config& getConfig() const { return config; }
+
+        // fetch() calls that hit and missed
+        unsigned long hits() const { return numHits; }
+        unsigned long misses() const { return numMisses; }
+
+    private:
+        //! aligned face of a track
+        struct Entry
+        {
+            Entry() : id(NONE), frame(0) {}
+
+            uint id;
+
+            //! track rect and eyes at alignment
+            cvip::DetectionRect rect;
+            cvip::DetectionRect eyes[2];
+
+            cv::Mat face;
+
+            //! frame of alignment
+            unsigned long frame;
+        };
+
+        static const uint NONE = ~0u;
+
+        // entry of id, 0 if none
+        Entry* find(uint id);
+
+        // has rect drifted too far from the rect at alignment?
+        bool moved(const Entry& e, const cvip::DetectionRect& rect) const;
+
+        //! @property side of the aligned faces
+        uint size;
+
+        Config config;
+
+        //! @property frames since construction
+        unsigned long frame;
+
+        //! @property cached faces, entries[index[id]] is that of track id
+        std::vector<Entry> entries;
+        std::map<uint, uint> index;
+
+        //! @property entries of expired tracks, for store() to reuse
+        std::vector<uint> freeEntries;
+
+        unsigned long numHits, numMisses;
+    };
+}
+
+#endif // ALIGNMENTCACHE_H
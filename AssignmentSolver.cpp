@@ -0,0 +1,260 @@
+#include "AssignmentSolver.h"
+#include <limits>
+
+using namespace cvip;
+
+/**
+ * Minimize the sum of costs over candidate pairs. A row (column) that
+ * gets no candidate pair stays unassigned.
+ * A high missingCost makes the solver maximize the number of matched
+ * candidates first; a missingCost of 0 with negative candidate costs
+ * (i.e. weights) gives a maximum weight matching.
+ *
+ * @param  uint numRows
+ * @param  uint numCols
+ * @param  vector<uint>& candStart - numRows+1 offsets into candCol/candCost
+ * @param  vector<uint>& candCol - candidate columns, unique per row
+ * @param  vector<double>& candCost
+ * @param  double missingCost - cost of pairs that are not candidates
+ * @param  vector<int>& rowAssignment - output, column of each row or -1
+ * @return void
+ */
+void AssignmentSolver::solve(uint numRows, uint numCols,
+                             const std::vector<uint>& candStart,
+                             const std::vector<uint>& candCol,
+                             const std::vector<double>& candCost,
+                             double missingCost, std::vector<int>& rowAssignment)
+{
+    rowAssignment.assign(numRows, -1);
+
+    uint nNodes = numRows+numCols;
+
+    // nodes 0..numRows-1 are rows, the rest are columns
+    parent.resize(nNodes);
+    for (uint i=0; i<nNodes; ++i)
+        parent[i] = i;
+
+    for (uint r=0; r<numRows; ++r)
+        for (uint k=candStart[r]; k<candStart[r+1]; ++k)
+        {
+            uint a = findRoot(r), b = findRoot(numRows+candCol[k]);
+            if (a != b)
+                parent[a] = b;
+        }
+
+    // bucket nodes by their root, flatten the forest on the way
+    groupStart.assign(nNodes+1, 0);
+    for (uint i=0; i<nNodes; ++i)
+    {
+        parent[i] = findRoot(i);
+        ++groupStart[parent[i]+1];
+    }
+
+    for (uint g=0; g<nNodes; ++g)
+        groupStart[g+1] += groupStart[g];
+
+    groupNodes.resize(nNodes);
+    for (uint i=0; i<nNodes; ++i)
+        groupNodes[groupStart[parent[i]]++] = i;
+
+    for (uint g=nNodes; g>0; --g)
+        groupStart[g] = groupStart[g-1];
+    groupStart[0] = 0;
+
+    localIdx.resize(numCols);
+
+    for (uint g=0; g<nNodes; ++g)
+    {
+        // a single node has no candidate pair
+        if (groupStart[g+1]-groupStart[g] < 2)
+            continue;
+
+        groupRows.clear();
+        groupCols.clear();
+
+        for (uint k=groupStart[g]; k<groupStart[g+1]; ++k)
+        {
+            uint node = groupNodes[k];
+
+            if (node < numRows) {
+                groupRows.push_back(node);
+            } else {
+                localIdx[node-numRows] = groupCols.size();
+                groupCols.push_back(node-numRows);
+            }
+        }
+
+        uint rows = groupRows.size(), cols = groupCols.size();
+
+        costs.assign(rows*cols, missingCost);
+        isCandidate.assign(rows*cols, 0);
+
+        for (uint lr=0; lr<rows; ++lr)
+        {
+            uint r = groupRows[lr];
+            for (uint k=candStart[r]; k<candStart[r+1]; ++k)
+            {
+                costs[lr*cols + localIdx[candCol[k]]] = candCost[k];
+                isCandidate[lr*cols + localIdx[candCol[k]]] = 1;
+            }
+        }
+
+        solve(costs, rows, cols, groupAssignment);
+
+        // keep candidate pairs only
+        for (uint lr=0; lr<rows; ++lr)
+        {
+            int lc = groupAssignment[lr];
+
+            if (lc >= 0 && isCandidate[lr*cols + lc])
+                rowAssignment[groupRows[lr]] = groupCols[lc];
+        }
+    }
+}
+
+/**
+ * Make room for sparse solves of up to numRows rows and numCols
+ * columns whose groups have at most groupSize rows and groupSize
+ * columns; larger groups grow the dense buffers once.
+ *
+ * @param  uint numRows
+ * @param  uint numCols
+ * @param  uint groupSize
+ * @return void
+ */
+void AssignmentSolver::reserve(uint numRows, uint numCols, uint groupSize)
+{
+    uint nNodes = numRows+numCols;
+
+    parent.reserve(nNodes);
+    groupStart.reserve(nNodes+1);
+    groupNodes.reserve(nNodes);
+    localIdx.reserve(numCols);
+
+    groupRows.reserve(groupSize);
+    groupCols.reserve(groupSize);
+    groupAssignment.reserve(groupSize);
+    costs.reserve(groupSize*groupSize);
+    isCandidate.reserve(groupSize*groupSize);
+
+    u.reserve(groupSize+1);
+    v.reserve(groupSize+1);
+    minv.reserve(groupSize+1);
+    p.reserve(groupSize+1);
+    way.reserve(groupSize+1);
+    used.reserve(groupSize+1);
+}
+
+/**
+ * Minimize the sum of costs over the assigned pairs.
+ *
+ * @param  vector<double>& costs - row major numRows x numCols matrix
+ * @param  uint numRows
+ * @param  uint numCols
+ * @param  vector<int>& rowAssignment - output, column of each row or -1
+ * @return void
+ */
+void AssignmentSolver::solve(const std::vector<double>& costs, uint numRows, uint numCols,
+                             std::vector<int>& rowAssignment)
+{
+    rowAssignment.assign(numRows, -1);
+
+    // the solver needs rows <= cols, transpose the problem if necessary
+    bool transposed = numRows > numCols;
+    uint n = transposed ? numCols : numRows;
+    uint m = transposed ? numRows : numCols;
+
+    const double INF = std::numeric_limits<double>::max();
+
+    // 1-based indexing, index 0 is a virtual column
+    u.assign(n+1, 0.);
+    v.assign(m+1, 0.);
+    p.assign(m+1, 0);
+    way.assign(m+1, 0);
+
+    for (uint i=1; i<=n; ++i)
+    {
+        p[0] = i;
+        uint j0 = 0;
+
+        minv.assign(m+1, INF);
+        used.assign(m+1, 0);
+
+        do
+        {
+            used[j0] = 1;
+
+            uint i0 = p[j0], j1 = 0;
+            double delta = INF;
+
+            for (uint j=1; j<=m; ++j)
+            {
+                if (used[j])
+                    continue;
+
+                double cost = transposed ? costs[(j-1)*numCols + (i0-1)]
+                                         : costs[(i0-1)*numCols + (j-1)];
+                double cur = cost - u[i0] - v[j];
+
+                if (cur < minv[j])
+                {
+                    minv[j] = cur;
+                    way[j] = j0;
+                }
+
+                if (minv[j] < delta)
+                {
+                    delta = minv[j];
+                    j1 = j;
+                }
+            }
+
+            for (uint j=0; j<=m; ++j)
+            {
+                if (used[j]) {
+                    u[p[j]] += delta;
+                    v[j] -= delta;
+                } else {
+                    minv[j] -= delta;
+                }
+            }
+
+            j0 = j1;
+        } while (p[j0] != 0);
+
+        // augment along the found path
+        do
+        {
+            uint j1 = way[j0];
+            p[j0] = p[j1];
+            j0 = j1;
+        } while (j0 != 0);
+    }
+
+    // p[j] is the row assigned to column j
+    for (uint j=1; j<=m; ++j)
+    {
+        if (p[j] == 0)
+            continue;
+
+        if (transposed)
+            rowAssignment[j-1] = p[j]-1;
+        else
+            rowAssignment[p[j]-1] = j-1;
+    }
+}
+
+/**
+ * Root of node i in the union-find forest, with path halving.
+ *
+ * @return uint
+ */
+uint AssignmentSolver::findRoot(uint i)
+{
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+
+    return i;
+}
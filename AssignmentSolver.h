@@ -0,0 +1,63 @@
+#ifndef ASSIGNMENTSOLVER_H
+#define ASSIGNMENTSOLVER_H
+
+#include "FaceDetector.h"
+#include <vector>
+
+namespace cvip
+{
+    /**
+     * Minimum cost assignment between rows and columns, with the
+     * O(n^2 m) shortest augmenting path variant of the Hungarian method
+     * (Jonker-Volgenant style potentials).
+     * The dense solve takes a full cost matrix. The sparse solve takes
+     * candidate pairs only: rows and columns linked by candidates form
+     * independent groups, each solved on its own dense matrix, which
+     * gives the same result as one big matrix but costs far less when
+     * the problem is spread out. Buffers are kept between calls.
+     *
+     * @author evangelos sariyanidi / sariyanidi[at]gmail[dot]com
+     * @date april 2011
+     */
+    class AssignmentSolver
+    {
+    public:
+        // costs[r*numCols + c] is the cost of pair (r,c); fill one col (or -1) per row
+        void solve(const std::vector<double>& costs, uint numRows, uint numCols,
+                   std::vector<int>& rowAssignment);
+
+        // candidates of row r: candStart[r]..candStart[r+1]; other pairs cost missingCost
+        // and are never returned
+        void solve(uint numRows, uint numCols,
+                   const std::vector<uint>& candStart,
+                   const std::vector<uint>& candCol,
+                   const std::vector<double>& candCost,
+                   double missingCost, std::vector<int>& rowAssignment);
+
+        // room for sparse solves of numRows x numCols with groups of up to
+        // groupSize rows and columns each, which then allocate nothing
+        void reserve(uint numRows, uint numCols, uint groupSize);
+
+    private:
+        uint findRoot(uint i);
+
+        //! @property potentials, augmenting path and column state
+        std::vector<double> u, v, minv;
+        std::vector<int> p, way;
+        std::vector<char> used;
+
+        //! @property union-find forest over rows and columns
+        std::vector<uint> parent;
+
+        //! @property rows/columns bucketed by group: groupStart[g]..groupStart[g+1]
+        std::vector<uint> groupStart, groupNodes;
+
+        //! @property members of the group being solved and its dense costs
+        std::vector<uint> groupRows, groupCols;
+        std::vector<int> localIdx, groupAssignment;
+        std::vector<char> isCandidate;
+        std::vector<double> costs;
+    };
+}
+
+#endif // ASSIGNMENTSOLVER_H
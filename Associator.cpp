@@ -0,0 +1,387 @@
+#include "Associator.h"
+#include <algorithm>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+using namespace cvip;
+
+const double Associator::MIN_OVERLAP = 0.20;
+const float Associator::CHI2_4DOF_95 = 9.488f;
+const float Associator::CHI2_4DOF_99 = 13.277f;
+
+// cost of a pair that may not be matched, far above any 1 - overlap
+static const double INVALID_COST = 1e6;
+
+/**
+ * Overlap score of a detection and a track rectangle: the larger one
+ * of the two intersection/area ratios. Zero if rects don't intersect.
+ * This is the scalar reference; association scores pairs with the
+ * OverlapKernel, which gives the same scores in float.
+ *
+ * @param  DetectionRect& d - detection
+ * @param  DetectionRect& t - track rectangle
+ * @return double
+ */
+double Associator::overlap(const DetectionRect& d, const DetectionRect& t)
+{
+    uint area = Rect::intersect(d, t);
+
+    if (area == 0)
+        return 0.;
+
+    double ratio1 = (double)area/(d.width*d.height);
+    double ratio2 = (double)area/(t.width*t.height);
+
+    return std::max<double>(ratio1, ratio2);
+}
+
+/**
+ * Match detections to tracks.
+ * On return assignment[i] is the index (within tracks) of the track
+ * that detects[i] stands for, or -1 if detects[i] is not matched.
+ * A track is matched at most once, and only if the overlap of the pair
+ * exceeds MIN_OVERLAP and, with gating on, the pair passes the gate.
+ *
+ * @param  DetectionRect* detects - fresh detections
+ * @param  uint numDetects
+ * @param  vector<const DetectionRect*>& tracks - current track rectangles
+ * @param  vector<int>& assignment - output
+ * @param  vector<Gate>* gates - one per track, used only with gating on
+ * @param  vector<uint>* ids - one per track, greedy ties go to the lowest; 0 = by index
+ * @return void
+ */
+void Associator::associate(const DetectionRect* detects, uint numDetects,
+                           const std::vector<const DetectionRect*>& tracks,
+                           std::vector<int>& assignment,
+                           const std::vector<Gate>* gates,
+                           const std::vector<uint>* ids)
+{
+    assignment.assign(numDetects, -1);
+
+    if (numDetects == 0 || tracks.empty())
+        return;
+
+    bool gated = gateChi2 > 0 && gates && gates->size() == tracks.size();
+
+    // SoA copy of the gates, padded for the vectorized pass (padding is far away),
+    // and the detections in the coordinates of the gates
+    if (gated)
+    {
+        uint n = tracks.size(), padded = (n+7)/8*8;
+
+        for (uint k=0; k<4; ++k)
+        {
+            gateZ[k].assign(padded, 1e18f);
+            gateW[k].assign(padded, 1.f);
+
+            for (uint j=0; j<n; ++j)
+            {
+                const Gate& g = (*gates)[j];
+                gateZ[k][j] = g.z[k];
+                gateW[k][j] = 1.f/(gateChi2*std::max(g.var[k], 1e-12f));
+            }
+        }
+
+        gateExcess.resize(padded);
+
+        detectZ.resize(4*numDetects);
+        for (uint i=0; i<numDetects; ++i)
+            gateCoords(detects[i], &detectZ[4*i]);
+    }
+
+    buildCandidates(detects, numDetects, tracks, gated);
+
+    if (mode == GREEDY)
+        solveGreedy(numDetects, tracks.size(), ids && ids->size() == tracks.size() ? ids : 0, assignment);
+    else
+        solveHungarian(numDetects, tracks.size(), assignment);
+}
+
+/**
+ * Make room for frames of up to numDetects detections and numTracks
+ * tracks, allowing a few candidate tracks per detection and, for the
+ * Hungarian mode, groups of up to RESERVED_GROUP_SIZE mutually
+ * overlapping detections/tracks.
+ *
+ * @param  uint numDetects
+ * @param  uint numTracks
+ * @return void
+ */
+void Associator::reserve(uint numDetects, uint numTracks)
+{
+    uint padded = (numTracks+7)/8*8;
+
+    for (uint k=0; k<4; ++k) {
+        gateZ[k].reserve(padded);
+        gateW[k].reserve(padded);
+    }
+
+    gateExcess.reserve(padded);
+    detectZ.reserve(4*numDetects);
+
+    grid.reserve(numTracks);
+    kernel.reserve(numTracks);
+    detectBoxes.reserve(numDetects);
+    trackBoxes.reserve(numTracks);
+
+    candStart.reserve(numDetects+1);
+    candTrack.reserve(4*numDetects);
+    candScore.reserve(4*numDetects);
+    candCost.reserve(4*numDetects);
+
+    nearTracks.reserve(numTracks);
+    used.reserve(numTracks);
+
+    solver.reserve(numDetects, numTracks, RESERVED_GROUP_SIZE);
+}
+
+/**
+ * List, for every detection, the tracks that it overlaps more than
+ * MIN_OVERLAP, in ascending track order. A detection is scored against
+ * all tracks in one vectorized pass of the OverlapKernel, except in
+ * crowded frames, where only the tracks sharing a grid cell with it are
+ * scored. With gating, only the pairs passing the gate are scored.
+ *
+ * @return void
+ */
+void Associator::buildCandidates(const DetectionRect* detects, uint numDetects,
+                                 const std::vector<const DetectionRect*>& tracks,
+                                 bool gated)
+{
+    uint nD = numDetects, nT = tracks.size();
+    bool useGrid = (double)nD*nT >= minGridPairs;
+    const float minScore = (float)MIN_OVERLAP;
+
+    detectBoxes.assign(detects, nD);
+    trackBoxes.assign(tracks);
+
+    // no grid, no gate: all pairs in one call
+    if (!useGrid && !gated)
+    {
+        kernel.candidates(detectBoxes, trackBoxes, minScore, candStart, candTrack, candScore);
+        return;
+    }
+
+    if (useGrid)
+        grid.build(tracks);
+
+    candStart.resize(nD+1);
+    candTrack.clear();
+    candScore.clear();
+
+    for (uint i=0; i<nD; ++i)
+    {
+        candStart[i] = candTrack.size();
+
+        if (useGrid)
+        {
+            grid.query(detects[i], nearTracks);
+
+            for (uint k=0; k<nearTracks.size(); ++k)
+            {
+                if (gated && !gatePasses(i, nearTracks[k]))
+                    continue;
+
+                float s = kernel.pair(detectBoxes, i, trackBoxes, nearTracks[k]);
+
+                if (s > minScore) {
+                    candTrack.push_back(nearTracks[k]);
+                    candScore.push_back(s);
+                }
+            }
+        }
+        else
+        {
+            // gate all tracks in one pass, score the few that pass
+            gateAll(i, nT);
+
+            for (uint j=0; j<nT; ++j)
+            {
+                if (gateExcess[j] > 0)
+                    continue;
+
+                float s = kernel.pair(detectBoxes, i, trackBoxes, j);
+
+                if (s > minScore) {
+                    candTrack.push_back(j);
+                    candScore.push_back(s);
+                }
+            }
+        }
+    }
+
+    candStart[nD] = candTrack.size();
+}
+
+/**
+ * Coordinates of a detection in the space of the gates: its corners,
+ * or its center and size.
+ *
+ * @param  DetectionRect& d
+ * @param  float* z - output, 4 values
+ * @return void
+ */
+void Associator::gateCoords(const DetectionRect& d, float* z) const
+{
+    if (!centeredGates)
+    {
+        z[0] = d.x1;
+        z[1] = d.y1;
+        z[2] = d.x2;
+        z[3] = d.y2;
+        return;
+    }
+
+    z[0] = 0.5f*(d.x1 + d.x2);
+    z[1] = 0.5f*(d.y1 + d.y2);
+    z[2] = d.x2 - d.x1;
+    z[3] = d.y2 - d.y1;
+}
+
+/**
+ * Squared Mahalanobis distance of detection i to every track, over the
+ * track's limit, minus 1, in one vectorized pass: with the innovation
+ * covariance being diagonal in the coordinates of the gates, the
+ * distance is the sum of (z_k - (H*x)_k)^2 / var_k, and the pair passes
+ * if sum (z_k - (H*x)_k)^2 / (chi2*var_k) - 1 <= 0. Padding tracks never
+ * pass.
+ *
+ * @param  uint i
+ * @param  uint numTracks
+ * @return void
+ */
+void Associator::gateAll(uint i, uint numTracks)
+{
+    uint n = (numTracks+7)/8*8;
+    uint j = 0;
+    const float* z = &detectZ[4*i];
+
+#if defined(__AVX__)
+    const __m256 one = _mm256_set1_ps(1.f);
+
+    for (; j<n; j+=8)
+    {
+        __m256 d2 = _mm256_setzero_ps();
+
+        for (uint k=0; k<4; ++k)
+        {
+            __m256 e = _mm256_sub_ps(_mm256_set1_ps(z[k]), _mm256_loadu_ps(&gateZ[k][j]));
+            d2 = _mm256_add_ps(d2, _mm256_mul_ps(_mm256_mul_ps(e, e), _mm256_loadu_ps(&gateW[k][j])));
+        }
+
+        _mm256_storeu_ps(&gateExcess[j], _mm256_sub_ps(d2, one));
+    }
+#elif defined(__SSE__)
+    const __m128 one = _mm_set1_ps(1.f);
+
+    for (; j<n; j+=4)
+    {
+        __m128 d2 = _mm_setzero_ps();
+
+        for (uint k=0; k<4; ++k)
+        {
+            __m128 e = _mm_sub_ps(_mm_set1_ps(z[k]), _mm_loadu_ps(&gateZ[k][j]));
+            d2 = _mm_add_ps(d2, _mm_mul_ps(_mm_mul_ps(e, e), _mm_loadu_ps(&gateW[k][j])));
+        }
+
+        _mm_storeu_ps(&gateExcess[j], _mm_sub_ps(d2, one));
+    }
+#endif
+
+    // scalar fallback
+    for (; j<n; ++j)
+    {
+        float d2 = 0.f;
+        for (uint k=0; k<4; ++k)
+        {
+            float e = z[k]-gateZ[k][j];
+            d2 += e*e*gateW[k][j];
+        }
+
+        gateExcess[j] = d2 - 1.f;
+    }
+}
+
+/**
+ * Gate test of a single pair, see gateAll().
+ *
+ * @return bool
+ */
+bool Associator::gatePasses(uint i, uint j) const
+{
+    const float* z = &detectZ[4*i];
+    float d2 = 0.f;
+
+    for (uint k=0; k<4; ++k)
+    {
+        float e = z[k]-gateZ[k][j];
+        d2 += e*e*gateW[k][j];
+    }
+
+    return d2 <= 1.f;
+}
+
+/**
+ * Greedy association, exactly the way the Tracker used to do it:
+ * detections are visited from the last to the first one and each takes
+ * the free track that it overlaps the most. Of tracks overlapping it
+ * equally, the one of the lowest id wins, as when the Tracker kept its
+ * items by id; without ids the one of the lowest index.
+ *
+ * @param  uint numDetects
+ * @param  uint numTracks
+ * @param  vector<uint>* ids - id of each track, 0 if none
+ * @param  vector<int>& assignment - output
+ * @return void
+ */
+void Associator::solveGreedy(uint numDetects, uint numTracks, const std::vector<uint>* ids, std::vector<int>& assignment)
+{
+    used.assign(numTracks, 0);
+
+    for (int i=numDetects-1; i>=0; --i)
+    {
+        int maxIdx = -1;
+        float maxArea = 0.f;
+
+        for (uint k=candStart[i]; k<candStart[i+1]; ++k)
+        {
+            if (used[candTrack[k]]) // update an item only once
+                continue;
+
+            // try to find the best/largest intersection between rects
+            if (candScore[k] > maxArea
+                || (candScore[k] == maxArea && maxIdx >= 0 && ids && (*ids)[candTrack[k]] < (*ids)[maxIdx]))
+            {
+                maxArea = candScore[k];
+                maxIdx = candTrack[k];
+            }
+        }
+
+        // candidates are good enough by construction
+        if (maxIdx >= 0)
+        {
+            used[maxIdx] = 1;
+            assignment[i] = maxIdx;
+        }
+    }
+}
+
+/**
+ * Optimal association: minimize the sum of (1 - overlap) over matched
+ * pairs. Pairs that are not candidates get a prohibitive cost, so the
+ * number of matched pairs comes first.
+ *
+ * @return void
+ */
+void Associator::solveHungarian(uint numDetects, uint numTracks, std::vector<int>& assignment)
+{
+    candCost.resize(candScore.size());
+    for (uint k=0; k<candScore.size(); ++k)
+        candCost[k] = 1.-candScore[k];
+
+    solver.solve(numDetects, numTracks, candStart, candTrack, candCost, INVALID_COST, assignment);
+}
@@ -0,0 +1,172 @@
+#ifndef ASSOCIATOR_H
+#define ASSOCIATOR_H
+
+#include "FaceDetector.h"
+#include "SpatialGrid.h"
+#include "AssignmentSolver.h"
+#include "OverlapKernel.h"
+#include <vector>
+
+namespace cvip
+{
+    /**
+     * Association stage of the Tracker: decide which fresh detection
+     * stands for which track item.
+     * For every detection the tracks it overlaps enough are listed as
+     * candidates, either by scoring all pairs with the vectorized
+     * OverlapKernel or, in crowded frames, only the pairs that a
+     * SpatialGrid over the track rects reports. The
+     * candidates are then matched either greedily (the original
+     * behaviour of the Tracker, the default) or optimally with the AssignmentSolver,
+     * which solves each group of mutually overlapping detections/tracks
+     * on its own dense cost matrix.
+     * Optionally, pairs are first gated with the Kalman innovation
+     * covariance of the track: a detection too far from the prediction,
+     * in the Mahalanobis sense, is never scored against it.
+     *
+     * @author evangelos sariyanidi / sariyanidi[at]gmail[dot]com
+     * @date april 2011
+     */
+    class Associator
+    {
+    public:
+        //! association strategies
+        enum Mode
+        {
+            GREEDY,     //! fast: each detection takes its best free track
+            HUNGARIAN   //! optimal: maximize total overlap over all pairs
+        };
+
+        /**
+         * Statistical gate of a track: its predicted rect and the
+         * variance of the innovation of each coordinate, in pixels^2.
+         * The coordinates are the corners (x1, y1, x2, y2) or, for a
+         * centered motion model, center and size (cx, cy, w, h).
+         */
+        struct Gate
+        {
+            float z[4];
+            float var[4];
+        };
+
+        Associator(Mode _mode = GREEDY) : mode(_mode), minGridPairs(DEFAULT_MIN_GRID_PAIRS), gateChi2(0), centeredGates(false) {}
+
+        // choose association strategy
+        void setMode(Mode _mode) { mode = _mode; }
+        Mode getMode() const { return mode; }
+
+        // use the spatial grid once detections x tracks reaches n, 0 = always
+        void setMinGridPairs(uint n) { minGridPairs = n; }
+
+        // reject pairs whose squared Mahalanobis distance exceeds chi2 (0 = off)
+        void setGating(float chi2) { gateChi2 = chi2; }
+        float getGating() const { return gateChi2; }
+
+        // gates are in center and size coordinates rather than corners (see MotionModel::centered())
+        void setCenteredGates(bool on) { centeredGates = on; }
+
+        // match detections to tracks, fill one track index (or -1) per detection;
+        // with gating on, gates[j] is the gate of tracks[j]; ids[j] is the id of tracks[j],
+        // greedy ties go to the lowest id (to the lowest index without ids)
+        void associate(const DetectionRect* detects, uint numDetects,
+                       const std::vector<const DetectionRect*>& tracks,
+                       std::vector<int>& assignment,
+                       const std::vector<Gate>* gates = 0,
+                       const std::vector<uint>* ids = 0);
+
+        void associate(const std::vector<DetectionRect>& detects,
+                       const std::vector<const DetectionRect*>& tracks,
+                       std::vector<int>& assignment,
+                       const std::vector<Gate>* gates = 0,
+                       const std::vector<uint>* ids = 0)
+        { associate(detects.empty() ? 0 : &detects[0], detects.size(), tracks, assignment, gates, ids); }
+
+        // room for numDetects x numTracks frames, association doesn't allocate until then
+        void reserve(uint numDetects, uint numTracks);
+
+        // overlap score of two rectangles, 0 if they don't intersect
+        static double overlap(const DetectionRect& d, const DetectionRect& t);
+
+        //! @property minimum overlap to accept a detection/track pair
+        static const double MIN_OVERLAP;
+
+        //! @property below this many pairs, testing all of them is faster than the grid
+        static const uint DEFAULT_MIN_GRID_PAIRS = 2048;
+
+        //! @property groups of overlapping detections/tracks that reserve() makes room for
+        static const uint RESERVED_GROUP_SIZE = 32;
+
+        //! @property chi-square quantiles for 4 degrees of freedom (the 4 coordinates of a rect)
+        static const float CHI2_4DOF_95;
+        static const float CHI2_4DOF_99;
+
+    private:
+        //! @property selected association strategy
+        Mode mode;
+
+        //! @property grid gating threshold, see setMinGridPairs()
+        uint minGridPairs;
+
+        //! @property gating threshold, see setGating()
+        float gateChi2;
+
+        //! @property see setCenteredGates()
+        bool centeredGates;
+
+        //! @property gates of the tracks as SoA: predicted measurement and 1/(chi2*var) per coordinate
+        std::vector<float> gateZ[4], gateW[4];
+
+        //! @property measurement of each detection in the coordinates of the gates, z[4*i+k]
+        std::vector<float> detectZ;
+
+        //! @property squared distance over chi2, minus 1, of a detection to each track
+        std::vector<float> gateExcess;
+
+        //! @property index of track rects, rebuilt every frame
+        cvip::SpatialGrid grid;
+
+        //! @property candidates of detection i: candStart[i]..candStart[i+1]
+        std::vector<uint> candStart;
+
+        //! @property candidate track indices (ascending per detection) and their overlaps
+        std::vector<uint> candTrack;
+        std::vector<float> candScore;
+
+        //! @property scores pairs, see overlap()
+        cvip::OverlapKernel kernel;
+
+        //! @property detection and track rects as SoA, for the kernel
+        cvip::OverlapKernel::Boxes detectBoxes, trackBoxes;
+
+        //! @property grid query output
+        std::vector<uint> nearTracks;
+
+        //! @property 1 - overlap of each candidate
+        std::vector<double> candCost;
+
+        //! @property optimal assignment solver, keeps its buffers between frames
+        cvip::AssignmentSolver solver;
+
+        //! @property tracks taken by greedy association
+        std::vector<char> used;
+
+        // list candidate pairs, testing all of them or the ones the grid reports
+        void buildCandidates(const DetectionRect* detects, uint numDetects,
+                             const std::vector<const DetectionRect*>& tracks,
+                             bool gated);
+
+        // coordinates of d for the gates
+        void gateCoords(const DetectionRect& d, float* z) const;
+
+        // fill gateExcess for detection i against all tracks at once
+        void gateAll(uint i, uint numTracks);
+
+        // does detection i pass the gate of track j?
+        bool gatePasses(uint i, uint j) const;
+
+        void solveGreedy(uint numDetects, uint numTracks, const std::vector<uint>* ids, std::vector<int>& assignment);
+        void solveHungarian(uint numDetects, uint numTracks, std::vector<int>& assignment);
+    };
+}
+
+#endif // ASSOCIATOR_H
@@ -0,0 +1,694 @@
+#include "Tracker.h"
+#include "MotSequence.h"
+#include "MotMetrics.h"
+#include "SceneGenerator.h"
+#include "OverlapKernel.h"
+#include "KalmanFilter.h"
+#include "Instruments.h"
+#include "opencv2/video/tracking.hpp"
+#include <atomic>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <random>
+
+/**
+ * Headless replay benchmark: feed the detections of a recorded sequence
+ * (MOT text or binary file, see MotSequence) or of a synthetic scene
+ * (see SceneGenerator) to Tracker::update() frame by frame, and
+ * report throughput, per-frame latency, heap allocations made by the
+ * tracker and, given the ground truth, tracking accuracy. Nothing is
+ * drawn and no camera is opened.
+ *
+ * usage: Benchmark <detections> [-gt <ground truth>] [options]
+ *        Benchmark -synthetic <objects> [-frames n] [-seed s] [-lifetime n] [-motion cv|accel|turn] [options]
+ * options: -hungarian, -gate chi2, -model corner-cv|center-cv|corner-ca, -steady, -repeat n,
+ *          -lag n, -late, -warmup n, -prometheus <file> (needs CVIP_INSTRUMENTATION)
+ *
+ * The tracker is reserved for the largest frame of the sequence (see
+ * Tracker::reserve()), so after the first -warmup frames of each run
+ * (100 by default) it should not allocate at all: allocs/frame counts
+ * only the frames after the warm-up, and any allocation there is
+ * flagged and makes the exit status 2.
+ *
+ * -lag n emulates Tracker::trackAsync() with a detector n frames behind:
+ * the detections of every n-th frame come n frames later, frames in
+ * between coast. They are fused at the frame they were detected on with
+ * -late (see Tracker::setLateDetections()), at the frame they come at
+ * otherwise.
+ *
+ * Benchmark -overlap <boxes> times the overlap scores of all pairs of
+ * a synthetic frame's detections and boxes: the scalar path
+ * (Associator::overlap, i.e. Rect::intersect per pair) against the
+ * OverlapKernel with each instruction set the cpu supports.
+ *
+ * Benchmark -assoc [boxes] times the Associator on a synthetic frame,
+ * its detections against its true boxes as tracks, with greedy and
+ * with Hungarian matching, each scoring all pairs or the pairs the
+ * SpatialGrid reports. Without a number of boxes it sweeps 10 to 5000,
+ * which shows where the grid starts to pay off.
+ *
+ * Benchmark -kalman <tracks> [-model m] times one predict and correct
+ * of each of many tracks per frame: the KalmanBank, the full-matrix
+ * KalmanFilter template and cv::KalmanFilter (the original per-track
+ * filter), all on the same model and measurements. The bank's states
+ * are checked against the other two.
+ *
+ * @author evangelos sariyanidi / sariyanidi[at]gmail[dot]com
+ * @date april 2011
+ */
+
+// count heap allocations of the whole program
+static std::atomic<unsigned long> numAllocs(0);
+
+void* operator new(size_t size)
+{
+    ++numAllocs;
+
+    void* p = std::malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+
+    return p;
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+static void usage()
+{
+    std::cerr << "usage: Benchmark <detections> [-gt <ground truth>] [options]" << std::endl
+              << "       Benchmark -synthetic <objects> [-frames n] [-seed s] [-lifetime n] [-motion cv|accel|turn] [options]" << std::endl
+              << "options: -hungarian, -gate chi2, -model corner-cv|center-cv|corner-ca, -steady, -repeat n, -lag n, -late, -warmup n, -prometheus <file>" << std::endl
+              << "       Benchmark -overlap <boxes>" << std::endl
+              << "       Benchmark -assoc [boxes]" << std::endl
+              << "       Benchmark -kalman <tracks> [-model corner-cv|center-cv|corner-ca]" << std::endl;
+}
+
+/**
+ * A single synthetic frame of numBoxes objects: its detections and its
+ * true boxes. The frame grows with the number of objects, crowding
+ * stays that of the default scene.
+ *
+ * @param  uint numBoxes
+ * @param  vector<DetectionRect>& detects - output
+ * @param  vector<DetectionRect>& boxes - output
+ * @return void
+ */
+static void syntheticFrame(uint numBoxes, std::vector<cvip::DetectionRect>& detects, std::vector<cvip::DetectionRect>& boxes)
+{
+    cvip::SceneGenerator::Config scene;
+    double grow = std::sqrt(std::max(1., numBoxes/100.));
+    scene.width = (uint)(scene.width*grow);
+    scene.height = (uint)(scene.height*grow);
+    scene.numObjects = numBoxes;
+    scene.numFrames = 1;
+
+    cvip::MotSequence detections, truth;
+    cvip::SceneGenerator(scene).generate(detections, truth);
+
+    detections.detections(0, detects);
+    truth.detections(0, boxes);
+}
+
+/**
+ * Micro-benchmark of the overlap scores, see the top of this file.
+ * Kernel scores are checked against the scalar ones.
+ *
+ * @param  uint numBoxes
+ * @return int - exit code
+ */
+static int overlapBenchmark(uint numBoxes)
+{
+    std::vector<cvip::DetectionRect> detects, boxes;
+    syntheticFrame(numBoxes, detects, boxes);
+
+    uint nD = detects.size(), nB = boxes.size();
+    double numPairs = (double)nD*nB;
+
+    if (numPairs == 0) {
+        std::cerr << "no boxes" << std::endl;
+        return 1;
+    }
+
+    // enough rounds for ~50M pairs
+    uint numRounds = std::max(1, (int)(5e7/numPairs));
+
+    std::cout << nD << " x " << nB << " pairs, " << numRounds << " rounds" << std::endl;
+
+    std::vector<double> reference((size_t)nD*nB);
+    double checksum = 0.;
+    int64 t = cv::getTickCount();
+
+    for (uint r=0; r<numRounds; ++r)
+        for (uint i=0; i<nD; ++i)
+            for (uint j=0; j<nB; ++j)
+                checksum += reference[(size_t)i*nB+j] = cvip::Associator::overlap(detects[i], boxes[j]);
+
+    double tScalar = (cv::getTickCount()-t)/cv::getTickFrequency();
+
+    std::cout << "scalar Rect::intersect: " << tScalar/(numRounds*numPairs)*1e9 << " ns/pair"
+              << " (checksum " << checksum/numRounds << ")" << std::endl;
+
+    cvip::OverlapKernel kernel;
+    cvip::OverlapKernel::Boxes a, b;
+    std::vector<float> scores;
+
+    a.assign(detects);
+    b.assign(boxes);
+
+    for (int isa=cvip::OverlapKernel::SCALAR; isa<=cvip::OverlapKernel::bestIsa(); ++isa)
+    {
+        kernel.setIsa((cvip::OverlapKernel::Isa)isa);
+        t = cv::getTickCount();
+
+        for (uint r=0; r<numRounds; ++r)
+            kernel.matrix(a, b, scores);
+
+        double tKernel = (cv::getTickCount()-t)/cv::getTickFrequency();
+
+        // scores must agree up to float rounding, and on which side of MIN_OVERLAP they fall
+        uint numWrong = 0;
+
+        for (size_t k=0; k<scores.size(); ++k)
+            if (std::fabs(scores[k]-reference[k]) > 1e-6*std::max(1., reference[k])
+                || (scores[k] > (float)cvip::Associator::MIN_OVERLAP) != (reference[k] > cvip::Associator::MIN_OVERLAP))
+                ++numWrong;
+
+        std::cout << "kernel " << cvip::OverlapKernel::isaName(kernel.getIsa()) << ": "
+                  << tKernel/(numRounds*numPairs)*1e9 << " ns/pair, "
+                  << tScalar/tKernel << "x, " << numWrong << " mismatches" << std::endl;
+    }
+
+    return 0;
+}
+
+/**
+ * Micro-benchmark of the association, see the top of this file. The
+ * total overlap of the matched pairs tells how much the optimal
+ * matching gains over the greedy one; the grid must not change it.
+ *
+ * @param  uint numBoxes
+ * @return int - exit code
+ */
+static int assocBenchmark(uint numBoxes)
+{
+    std::vector<cvip::DetectionRect> detects, boxes;
+    syntheticFrame(numBoxes, detects, boxes);
+
+    std::vector<const cvip::DetectionRect*> tracks;
+    for (uint j=0; j<boxes.size(); ++j)
+        tracks.push_back(&boxes[j]);
+
+    if (detects.empty() || tracks.empty()) {
+        std::cerr << "no boxes" << std::endl;
+        return 1;
+    }
+
+    // fewer rounds for bigger frames, ~2e5 boxes in all
+    uint numRounds = std::max(1, (int)(2e5/(detects.size()+tracks.size())));
+
+    std::cout << detects.size() << " detections x " << tracks.size() << " tracks, " << numRounds << " rounds" << std::endl;
+
+    static const cvip::Associator::Mode modes[] = { cvip::Associator::GREEDY, cvip::Associator::HUNGARIAN };
+    static const char* modeNames[] = { "greedy", "hungarian" };
+
+    std::vector<int> assignment;
+
+    for (uint m=0; m<2; ++m)
+    {
+        for (uint useGrid=0; useGrid<2; ++useGrid)
+        {
+            cvip::Associator associator(modes[m]);
+            associator.setMinGridPairs(useGrid ? 0 : ~0u);
+
+            int64 t = cv::getTickCount();
+
+            for (uint r=0; r<numRounds; ++r)
+                associator.associate(detects, tracks, assignment);
+
+            double tAssoc = (cv::getTickCount()-t)/cv::getTickFrequency();
+
+            uint numMatched = 0;
+            double sumOverlap = 0.;
+
+            for (uint i=0; i<assignment.size(); ++i)
+            {
+                if (assignment[i] < 0)
+                    continue;
+
+                ++numMatched;
+                sumOverlap += cvip::Associator::overlap(detects[i], boxes[assignment[i]]);
+            }
+
+            std::cout << "  " << modeNames[m] << (useGrid ? ", grid:      " : ", all pairs: ")
+                      << tAssoc/numRounds*1e6 << " us/frame, "
+                      << numMatched << " matched, total overlap " << sumOverlap << std::endl;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Measurement rects of a synthetic run of the Kalman benchmark: track t
+ * at frame f moves on a line of its own, with a pixel of jitter.
+ *
+ * @param  uint numTracks
+ * @param  uint numFrames
+ * @param  vector<DetectionRect>& rects - output, rects[f*numTracks+t]
+ * @return void
+ */
+static void kalmanRects(uint numTracks, uint numFrames, std::vector<cvip::DetectionRect>& rects)
+{
+    std::mt19937 rng(1);
+    rects.resize(numTracks*numFrames);
+
+    for (uint f=0; f<numFrames; ++f)
+        for (uint t=0; t<numTracks; ++t)
+        {
+            int x = 10*(t % 100) + (int)(f*(1 + t % 3)), y = 10*(t / 100) + (int)(f*(t % 2));
+            rects[f*numTracks+t] = cvip::DetectionRect(x + (int)(rng() % 3) - 1, y + (int)(rng() % 3) - 1, 40, 50);
+        }
+}
+
+/**
+ * Kalman part of the micro-benchmark: the template filter and
+ * cv::KalmanFilter on model, measurements z (numFrames x numTracks x 4,
+ * from the first frame on); their positions after the last frame go to
+ * tmplX and cvX.
+ *
+ * @return void
+ */
+template <unsigned int N>
+static void kalmanFilters(const cvip::KalmanModel<N, 4>& model, const std::vector<float>& z, uint numTracks, uint numFrames,
+                          double& tTmpl, double& tCv, std::vector<float>& tmplX, std::vector<float>& cvX)
+{
+    const uint M = 4;
+
+    std::vector<cvip::KalmanFilter<N, M> > filters(numTracks, cvip::KalmanFilter<N, M>(model));
+    for (uint t=0; t<numTracks; ++t)
+        std::copy(&z[t*M], &z[t*M]+M, filters[t].x);
+
+    int64 tStart = cv::getTickCount();
+
+    for (uint f=1; f<numFrames; ++f)
+        for (uint t=0; t<numTracks; ++t) {
+            filters[t].predict();
+            filters[t].correct(&z[(f*numTracks+t)*M]);
+        }
+
+    tTmpl = (cv::getTickCount()-tStart)/cv::getTickFrequency();
+
+    // cv::KalmanFilter, set up as TrackItem used to do it; each one is built in place,
+    // copies would share their matrices
+    std::vector<cv::KalmanFilter> cvFilters;
+    cvFilters.reserve(numTracks);
+
+    for (uint t=0; t<numTracks; ++t)
+    {
+        cvFilters.emplace_back(N, M, 0);
+        cv::KalmanFilter* kf = &cvFilters.back();
+
+        for (uint i=0; i<N; ++i)
+            for (uint j=0; j<N; ++j) {
+                kf->transitionMatrix.at<float>(i, j) = model.F[i][j];
+                kf->processNoiseCov.at<float>(i, j) = model.Q[i][j];
+                kf->errorCovPost.at<float>(i, j) = i == j ? 1.f : 0.f;
+            }
+
+        for (uint i=0; i<M; ++i) {
+            for (uint j=0; j<N; ++j)
+                kf->measurementMatrix.at<float>(i, j) = model.H[i][j];
+            for (uint j=0; j<M; ++j)
+                kf->measurementNoiseCov.at<float>(i, j) = model.R[i][j];
+        }
+
+        for (uint i=0; i<N; ++i)
+            kf->statePost.at<float>(i) = i < M ? z[t*M+i] : 0.f;
+    }
+
+    cv::Mat measurement(M, 1, CV_32F);
+    tStart = cv::getTickCount();
+
+    for (uint f=1; f<numFrames; ++f)
+        for (uint t=0; t<numTracks; ++t)
+        {
+            for (uint i=0; i<M; ++i)
+                measurement.at<float>(i) = z[(f*numTracks+t)*M+i];
+
+            cvFilters[t].predict();
+            cvFilters[t].correct(measurement);
+        }
+
+    tCv = (cv::getTickCount()-tStart)/cv::getTickFrequency();
+
+    tmplX.resize(numTracks*M);
+    cvX.resize(numTracks*M);
+
+    for (uint t=0; t<numTracks; ++t)
+        for (uint i=0; i<M; ++i) {
+            tmplX[t*M+i] = filters[t].x[i];
+            cvX[t*M+i] = cvFilters[t].statePost.at<float>(i);
+        }
+}
+
+/**
+ * Micro-benchmark of the Kalman filters, see the top of this file.
+ *
+ * @param  uint numTracks
+ * @param  MotionModel::Kind kind
+ * @return int - exit code
+ */
+static int kalmanBenchmark(uint numTracks, cvip::MotionModel::Kind kind)
+{
+    const uint M = cvip::KalmanBank::M;
+
+    if (numTracks == 0) {
+        std::cerr << "no tracks" << std::endl;
+        return 1;
+    }
+
+    // enough frames for ~2M track updates
+    uint numFrames = std::max(2, (int)(2e6/numTracks));
+
+    cvip::MotionModel model(kind);
+    cvip::KalmanBank bank(model);
+    bank.reserve(numTracks);
+
+    std::vector<cvip::DetectionRect> rects;
+    kalmanRects(numTracks, numFrames, rects);
+
+    std::vector<float> z(rects.size()*M);
+    for (size_t k=0; k<rects.size(); ++k)
+        bank.measure(rects[k], &z[k*M]);
+
+    std::cout << numTracks << " tracks, " << numFrames << " frames, " << cvip::MotionModel::name(kind) << std::endl;
+
+    for (uint t=0; t<numTracks; ++t)
+        bank.alloc(rects[t]);
+
+    int64 tStart = cv::getTickCount();
+
+    for (uint f=1; f<numFrames; ++f)
+    {
+        bank.predict();
+
+        for (uint t=0; t<numTracks; ++t)
+            bank.correct(t, rects[f*numTracks+t]);
+    }
+
+    double tBank = (cv::getTickCount()-tStart)/cv::getTickFrequency();
+    double tTmpl, tCv;
+    std::vector<float> tmplX, cvX;
+
+    float dt = model.dt, q = model.processNoise, r = model.measurementNoise;
+
+    if (kind == cvip::MotionModel::CORNER_ACCELERATION)
+        kalmanFilters<12>(cvip::cornerAccelerationModel(dt, q, r), z, numTracks, numFrames, tTmpl, tCv, tmplX, cvX);
+    else if (kind == cvip::MotionModel::CENTER_SCALE_VELOCITY)
+        kalmanFilters<8>(cvip::centerScaleVelocityModel(dt, q, r), z, numTracks, numFrames, tTmpl, tCv, tmplX, cvX);
+    else
+        kalmanFilters<8>(cvip::cornerVelocityModel(dt, q, r), z, numTracks, numFrames, tTmpl, tCv, tmplX, cvX);
+
+    // largest distance of the bank's positions from those of the other filters
+    float diffTmpl = 0.f, diffCv = 0.f;
+
+    for (uint t=0; t<numTracks; ++t)
+        for (uint i=0; i<M; ++i) {
+            diffTmpl = std::max(diffTmpl, std::fabs(bank.position(t, i) - tmplX[t*M+i]));
+            diffCv = std::max(diffCv, std::fabs(bank.position(t, i) - cvX[t*M+i]));
+        }
+
+    double numUpdates = (double)numTracks*(numFrames-1);
+
+    std::cout << "KalmanBank:         " << tBank/numUpdates*1e9 << " ns/track" << std::endl
+              << "KalmanFilter<" << (kind == cvip::MotionModel::CORNER_ACCELERATION ? 12 : 8) << ",4>:  "
+              << tTmpl/numUpdates*1e9 << " ns/track, " << tTmpl/tBank << "x the bank, max diff " << diffTmpl << std::endl
+              << "cv::KalmanFilter:   " << tCv/numUpdates*1e9 << " ns/track, " << tCv/tBank << "x the bank, max diff " << diffCv << std::endl;
+
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        usage();
+        return 1;
+    }
+
+    if (!strcmp(argv[1], "-overlap"))
+        return argc == 3 ? overlapBenchmark(atoi(argv[2])) : (usage(), 1);
+
+    if (!strcmp(argv[1], "-kalman"))
+    {
+        cvip::MotionModel::Kind kind = cvip::MotionModel::CORNER_VELOCITY;
+
+        if (argc == 5 && !strcmp(argv[3], "-model") && !cvip::MotionModel::parse(argv[4], kind)) {
+            std::cerr << "unknown model " << argv[4] << std::endl;
+            return 1;
+        }
+
+        return argc == 3 || argc == 5 ? kalmanBenchmark(atoi(argv[2]), kind) : (usage(), 1);
+    }
+
+    if (!strcmp(argv[1], "-assoc"))
+    {
+        if (argc == 3)
+            return assocBenchmark(atoi(argv[2]));
+
+        static const uint sizes[] = { 10, 30, 100, 300, 1000, 3000, 5000 };
+
+        for (uint k=0; k<sizeof(sizes)/sizeof(sizes[0]); ++k)
+            if (assocBenchmark(sizes[k]))
+                return 1;
+
+        return 0;
+    }
+
+    std::string detPath, gtPath, promPath;
+    bool hungarian = false, synthetic = false, steady = false, late = false;
+    float gateChi2 = 0.f;
+    cvip::MotionModel model;
+    uint numRepeats = 1, lag = 0, warmup = 100;
+    cvip::SceneGenerator::Config scene;
+
+    for (int i=1; i<argc; ++i)
+    {
+        if (i == 1 && argv[i][0] != '-') {
+            detPath = argv[i];
+        } else if (!strcmp(argv[i], "-synthetic") && i+1 < argc) {
+            synthetic = true;
+            scene.numObjects = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-frames") && i+1 < argc) {
+            scene.numFrames = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-seed") && i+1 < argc) {
+            scene.seed = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-lifetime") && i+1 < argc) {
+            scene.lifetime = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-motion") && i+1 < argc) {
+            std::string m(argv[++i]);
+            scene.motion = m == "accel" ? cvip::SceneGenerator::RANDOM_ACCELERATION
+                         : m == "turn" ? cvip::SceneGenerator::TURNING
+                         : cvip::SceneGenerator::CONSTANT_VELOCITY;
+        } else if (!strcmp(argv[i], "-gt") && i+1 < argc) {
+            gtPath = argv[++i];
+        } else if (!strcmp(argv[i], "-prometheus") && i+1 < argc) {
+            promPath = argv[++i];
+        } else if (!strcmp(argv[i], "-gate") && i+1 < argc) {
+            gateChi2 = (float)atof(argv[++i]);
+        } else if (!strcmp(argv[i], "-model") && i+1 < argc) {
+            if (!cvip::MotionModel::parse(argv[++i], model.kind)) {
+                usage();
+                return 1;
+            }
+        } else if (!strcmp(argv[i], "-steady")) {
+            steady = true;
+        } else if (!strcmp(argv[i], "-lag") && i+1 < argc) {
+            lag = std::max(0, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "-late")) {
+            late = true;
+        } else if (!strcmp(argv[i], "-hungarian")) {
+            hungarian = true;
+        } else if (!strcmp(argv[i], "-warmup") && i+1 < argc) {
+            warmup = std::max(0, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "-repeat") && i+1 < argc) {
+            numRepeats = std::max(1, atoi(argv[++i]));
+        } else {
+            usage();
+            return 1;
+        }
+    }
+
+    if (synthetic == !detPath.empty()) {
+        usage();
+        return 1;
+    }
+
+    cvip::MotSequence detections, truth;
+    bool hasTruth = synthetic || !gtPath.empty();
+
+    if (synthetic) {
+        // grow the frame with the number of objects, crowding stays that of the default scene
+        double grow = std::sqrt(std::max(1., scene.numObjects/100.));
+        scene.width = (uint)(scene.width*grow);
+        scene.height = (uint)(scene.height*grow);
+
+        cvip::SceneGenerator(scene).generate(detections, truth);
+    } else if (!detections.load(detPath)) {
+        std::cerr << "can't read " << detPath << std::endl;
+        return 1;
+    }
+
+    if (!gtPath.empty() && !truth.load(gtPath)) {
+        std::cerr << "can't read " << gtPath << std::endl;
+        return 1;
+    }
+
+    std::vector<double> latencies;
+    std::vector<cvip::DetectionRect> frameDetects;
+    std::vector<cvip::MotBox> hyps;
+    cvip::MotMetrics metrics;
+    unsigned long numBoxes = 0, warmupAllocs = 0, steadyAllocs = 0, steadyFrames = 0;
+    double totalTime = 0.;
+
+    // a detection updates or starts at most one item and items are dropped after
+    // NUM_MAX_INACTIVE_FRAMES frames without one, thus there are never more items
+    // than detections in that many frames
+    uint maxDetects = 0, maxItems = 0, window = 0;
+    const uint span = cvip::Tracker::NUM_MAX_INACTIVE_FRAMES;
+
+    for (uint f=0; f<detections.numFrames(); ++f)
+    {
+        window += detections.frame(f).size();
+        if (f >= span)
+            window -= detections.frame(f-span).size();
+
+        maxDetects = std::max(maxDetects, (uint)detections.frame(f).size());
+        maxItems = std::max(maxItems, window);
+    }
+
+    for (uint rep=0; rep<numRepeats; ++rep)
+    {
+        // no detector needed, detections come from the file
+        cvip::Tracker tracker(0);
+        tracker.setAssociationMode(hungarian ? cvip::Associator::HUNGARIAN : cvip::Associator::GREEDY);
+        tracker.setGating(gateChi2);
+        tracker.setMotionModel(model);
+        tracker.setSteadyStateGain(steady);
+        tracker.setLateDetections(late ? lag : 0);
+        tracker.reserve(maxItems, maxDetects);
+
+        for (uint f=0; f<detections.numFrames(); ++f)
+        {
+            // detections of frame f-lag come now, if it was submitted
+            bool detected = lag == 0 || (f >= lag && f % lag == 0);
+
+            if (detected) {
+                detections.detections(f-lag, frameDetects);
+                numBoxes += frameDetects.size();
+            }
+
+            unsigned long allocs0 = numAllocs;
+            int64 t = cv::getTickCount();
+
+            if (lag == 0)
+                tracker.update(frameDetects);
+            else if (detected)
+                tracker.updateLate(frameDetects, f-lag);
+            else
+                tracker.coast();
+
+            double dt = (cv::getTickCount()-t)/cv::getTickFrequency();
+            if (f < warmup) {
+                warmupAllocs += numAllocs - allocs0;
+            } else {
+                steadyAllocs += numAllocs - allocs0;
+                ++steadyFrames;
+            }
+
+            totalTime += dt;
+            latencies.push_back(dt);
+
+            // accuracy of the first run is enough, runs are identical
+            if (rep > 0 || !hasTruth)
+                continue;
+
+            typedef cvip::Tracker::TrackTable::const_iterator TiIter;
+            const cvip::Tracker::TrackTable& items = tracker.items();
+
+            hyps.clear();
+            for (TiIter it=items.begin(); it != items.end(); ++it)
+            {
+                if (!(*it)->isActive())
+                    continue;
+
+                cvip::MotBox b;
+                b.id = (*it)->id;
+                b.rect = (*it)->dRect;
+                b.conf = 1.f;
+                hyps.push_back(b);
+            }
+
+            static const std::vector<cvip::MotBox> noTruth;
+            metrics.addFrame(f < truth.numFrames() ? truth.frame(f) : noTruth, hyps);
+        }
+
+        // step timers of the last run, if built with CVIP_INSTRUMENTATION
+        const cvip::Instruments* instr = tracker.instruments();
+
+        if (rep+1 == numRepeats && instr)
+        {
+            cvip::Instruments::Snapshot snap = instr->snapshot();
+
+            for (uint t=0; t<cvip::Instruments::NUM_TIMERS; ++t)
+                std::cout << "step " << cvip::Instruments::timerName((cvip::Instruments::Timer)t) << ": "
+                          << snap.timers[t].p50*1000 << " ms p50, " << snap.timers[t].p99*1000 << " ms p99" << std::endl;
+
+            for (uint c=0; c<cvip::Instruments::NUM_COUNTERS; ++c)
+                std::cout << cvip::Instruments::counterName((cvip::Instruments::Counter)c) << ": "
+                          << snap.counters[c] << std::endl;
+
+            if (!promPath.empty() && !instr->writePrometheus(promPath))
+                std::cerr << "can't write " << promPath << std::endl;
+        }
+    }
+
+    uint numFrames = latencies.size();
+
+    if (numFrames == 0) {
+        std::cerr << "no frames to run" << std::endl;
+        return 1;
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+
+    std::cout << "frames:          " << numFrames << " (" << numRepeats << " runs)" << std::endl;
+    std::cout << "objects/frame:   " << (double)numBoxes/numFrames << std::endl;
+    std::cout << "frames/sec:      " << (totalTime > 0 ? numFrames/totalTime : 0.) << std::endl;
+    std::cout << "latency p50:     " << latencies[numFrames/2]*1000 << " ms" << std::endl;
+    std::cout << "latency p99:     " << latencies[std::min(numFrames-1, numFrames*99/100)]*1000 << " ms" << std::endl;
+    std::cout << "latency max:     " << latencies[numFrames-1]*1000 << " ms" << std::endl;
+    std::cout << "allocs/frame:    " << (steadyFrames ? (double)steadyAllocs/steadyFrames : 0.)
+              << " (after " << warmup << " warm-up frames per run, " << warmupAllocs << " in warm-up)" << std::endl;
+
+    if (steadyAllocs > 0)
+        std::cout << "FLAG: " << steadyAllocs << " allocations in " << steadyFrames << " steady-state frames" << std::endl;
+
+    if (hasTruth)
+    {
+        cvip::MotMetrics::Summary s = metrics.summary();
+
+        std::cout << "MOTA:            " << s.mota << std::endl;
+        std::cout << "MOTP:            " << s.motp << std::endl;
+        std::cout << "IDF1:            " << s.idf1 << " (IDP " << s.idPrecision << ", IDR " << s.idRecall << ")" << std::endl;
+        std::cout << "misses/FP/IDSW:  " << s.numMisses << " / " << s.numFalsePositives << " / " << s.numSwitches << std::endl;
+    }
+
+    return steadyAllocs > 0 ? 2 : 0;
+}
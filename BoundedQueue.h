@@ -0,0 +1,257 @@
+#ifndef BOUNDEDQUEUE_H
+#define BOUNDEDQUEUE_H
+
+#include <atomic>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstddef>
+
+namespace cvip
+{
+    /**
+     * Backpressure policies, shared by all BoundedQueue instantiations.
+     */
+    struct BoundedQueueBase
+    {
+        // what a producer does when the queue is full
+        enum Policy
+        {
+            BLOCK,          //! wait for room
+            DROP_OLDEST     //! discard the oldest item to make room
+        };
+    };
+
+    /**
+     * Bounded lock-free queue (D. Vyukov's bounded MPMC algorithm).
+     * Every cell carries a sequence number telling whether it's ready to
+     * be written or read at a given position, so producers and consumers
+     * only race on two position counters.
+     * Being safe with several consumers lets a producer drop the oldest
+     * item itself when the queue is full.
+     * A push() on a full queue or a pop() on an empty one spins for a
+     * few tries, then blocks on a condition variable. The lock is taken
+     * only on that slow path, and by the other side when someone waits.
+     *
+     * @author evangelos sariyanidi / sariyanidi[at]gmail[dot]com
+     * @date april 2011
+     */
+    template <typename T>
+    class BoundedQueue : public BoundedQueueBase
+    {
+    public:
+        BoundedQueue(size_t _capacity) : capacity(_capacity ? _capacity : 1), cells(capacity),
+            enqueuePos(0), dequeuePos(0), closed(false), numPushWaiting(0), numPopWaiting(0)
+        {
+            for (size_t i=0; i<capacity; ++i)
+                cells[i].seq.store(i, std::memory_order_relaxed);
+        }
+
+        // try to add item, false if the queue is full
+        bool tryPush(const T& item);
+
+        // try to take the oldest item, false if the queue is empty
+        bool tryPop(T& item);
+
+        // add item applying policy; a dropped item is moved to dropped, return true then
+        bool push(const T& item, Policy policy, T& dropped);
+
+        // wait for an item, false if the queue is closed and drained
+        bool pop(T& item);
+
+        // no more push after this, pop() returns false once drained
+        void close();
+
+        size_t size() const
+        {
+            return enqueuePos.load(std::memory_order_relaxed) - dequeuePos.load(std::memory_order_relaxed);
+        }
+
+    private:
+        struct Cell
+        {
+            Cell() : seq(0) {}
+            Cell(const Cell&) : seq(0) {}
+
+            std::atomic<size_t> seq;
+            T data;
+        };
+
+        const size_t capacity;
+        std::vector<Cell> cells;
+
+        // keep the two counters on different cache lines
+        char pad0[64];
+        std::atomic<size_t> enqueuePos;
+        char pad1[64];
+        std::atomic<size_t> dequeuePos;
+        char pad2[64];
+
+        std::atomic<bool> closed;
+
+        //! @property tries of push()/pop() before blocking
+        static const unsigned SPIN_TRIES = 64;
+
+        // wake the threads waiting on cv, if numWaiting says there are any
+        void wake(std::atomic<unsigned>& numWaiting, std::condition_variable& cv);
+
+        //! @property blocked push() and pop() calls sleep on these
+        std::mutex waitLock;
+        std::condition_variable notFull, notEmpty;
+        std::atomic<unsigned> numPushWaiting, numPopWaiting;
+    };
+
+    template <typename T>
+    bool BoundedQueue<T>::tryPush(const T& item)
+    {
+        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        Cell* cell;
+
+        while (true)
+        {
+            cell = &cells[pos % capacity];
+            size_t seq = cell->seq.load(std::memory_order_acquire);
+            ptrdiff_t dif = (ptrdiff_t)seq - (ptrdiff_t)pos;
+
+            if (dif == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed))
+                    break;
+            } else if (dif < 0) {
+                return false; // full
+            } else {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        cell->data = item;
+        cell->seq.store(pos+1, std::memory_order_release);
+
+        wake(numPopWaiting, notEmpty);
+
+        return true;
+    }
+
+    template <typename T>
+    bool BoundedQueue<T>::tryPop(T& item)
+    {
+        size_t pos = dequeuePos.load(std::memory_order_relaxed);
+        Cell* cell;
+
+        while (true)
+        {
+            cell = &cells[pos % capacity];
+            size_t seq = cell->seq.load(std::memory_order_acquire);
+            ptrdiff_t dif = (ptrdiff_t)seq - (ptrdiff_t)(pos+1);
+
+            if (dif == 0) {
+                if (dequeuePos.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed))
+                    break;
+            } else if (dif < 0) {
+                return false; // empty
+            } else {
+                pos = dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        item = cell->data;
+        cell->data = T();
+        cell->seq.store(pos+capacity, std::memory_order_release);
+
+        wake(numPushWaiting, notFull);
+
+        return true;
+    }
+
+    template <typename T>
+    bool BoundedQueue<T>::push(const T& item, Policy policy, T& dropped)
+    {
+        bool hasDropped = false;
+        unsigned spins = 0;
+
+        while (!tryPush(item))
+        {
+            if (policy == DROP_OLDEST && !hasDropped && tryPop(dropped)) {
+                hasDropped = true;
+                continue;
+            }
+
+            if (++spins < SPIN_TRIES) {
+                std::this_thread::yield();
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lk(waitLock);
+            numPushWaiting.fetch_add(1);
+
+            // pairs with the fence of wake(): either it sees us waiting or we see the room
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            if (size() >= capacity)
+                notFull.wait(lk);
+
+            numPushWaiting.fetch_sub(1);
+        }
+
+        return hasDropped;
+    }
+
+    template <typename T>
+    bool BoundedQueue<T>::pop(T& item)
+    {
+        unsigned spins = 0;
+
+        while (!tryPop(item))
+        {
+            if (closed.load(std::memory_order_acquire) && size() == 0)
+                return false;
+
+            if (++spins < SPIN_TRIES) {
+                std::this_thread::yield();
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lk(waitLock);
+            numPopWaiting.fetch_add(1);
+
+            // pairs with the fence of wake(): either it sees us waiting or we see the item
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            if (size() == 0 && !closed.load(std::memory_order_acquire))
+                notEmpty.wait(lk);
+
+            numPopWaiting.fetch_sub(1);
+        }
+
+        return true;
+    }
+
+    template <typename T>
+    void BoundedQueue<T>::close()
+    {
+        closed.store(true, std::memory_order_release);
+
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        {
+            std::lock_guard<std::mutex> lk(waitLock);
+        }
+        notEmpty.notify_all();
+    }
+
+    template <typename T>
+    void BoundedQueue<T>::wake(std::atomic<unsigned>& numWaiting, std::condition_variable& cv)
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (numWaiting.load(std::memory_order_relaxed) == 0)
+            return;
+
+        // a waiter holds the lock from its check until it sleeps
+        {
+            std::lock_guard<std::mutex> lk(waitLock);
+        }
+        cv.notify_all();
+    }
+}
+
+#endif // BOUNDEDQUEUE_H
@@ -0,0 +1,89 @@
+#include "CascadeDetector.h"
+
+using namespace cvip;
+
+/**
+ * Destructor
+ * Finish the queued requests, then delete the cascade detector.
+ */
+CascadeDetector::~CascadeDetector()
+{
+    stop();
+
+    pyramid.release();
+    delete faceDetector;
+}
+
+/**
+ * Build the scale spaces of an image, then run the cascade on them.
+ *
+ * @param  Mat& image
+ * @param  vector<cv::Rect>& rois - regions within image, empty for the whole image
+ * @return vector<DetectionRect> - detections in image coordinates
+ */
+std::vector<DetectionRect> CascadeDetector::detect(const cv::Mat& image, const std::vector<cv::Rect>& rois)
+{
+    std::lock_guard<std::mutex> lk(detectLock);
+
+    pyramid.build(image, rois);
+    return detectRegions(pyramid);
+}
+
+/**
+ * Build the scale spaces of an image as the cascade wants them, one
+ * per region. Levels the cascade has to make are made under
+ * detectLock, the rest is resampling (see ScaleSpace) and runs in
+ * parallel with detections.
+ *
+ * @param  Mat& image
+ * @param  vector<cv::Rect>& rois - regions within image, empty for the whole image
+ * @param  ScaleSpace& scales - output, replaces the scale spaces of its previous image
+ * @return void
+ */
+void CascadeDetector::scaleSpace(const cv::Mat& image, const std::vector<cv::Rect>& rois, ScaleSpace& scales)
+{
+    scales.setDetector(faceDetector, &detectLock);
+    scales.build(image, rois);
+}
+
+/**
+ * Run the cascade on already built scale spaces.
+ *
+ * @param  ScaleSpace& scales
+ * @return vector<DetectionRect> - detections in image coordinates
+ */
+std::vector<DetectionRect> CascadeDetector::detect(ScaleSpace& scales)
+{
+    std::lock_guard<std::mutex> lk(detectLock);
+    return detectRegions(scales);
+}
+
+/**
+ * Run the cascade on the scale space of each region, detectLock held.
+ *
+ * @param  ScaleSpace& scales
+ * @return vector<DetectionRect> - detections in image coordinates
+ */
+std::vector<DetectionRect> CascadeDetector::detectRegions(ScaleSpace& scales)
+{
+    std::vector<DetectionRect> detections;
+
+    for (uint r=0; r<scales.size(); ++r)
+    {
+        std::vector<DetectionRect> roiDetects = faceDetector->detect(scales.levels(r), true);
+        const cv::Rect& roi = scales.region(r);
+
+        // back to image coordinates
+        for (uint j=0; j<roiDetects.size(); ++j)
+        {
+            DetectionRect& d = roiDetects[j];
+            d.x1 += roi.x;
+            d.x2 += roi.x;
+            d.y1 += roi.y;
+            d.y2 += roi.y;
+            detections.push_back(d);
+        }
+    }
+
+    return detections;
+}
@@ -0,0 +1,58 @@
+#ifndef CASCADEDETECTOR_H
+#define CASCADEDETECTOR_H
+
+#include "Detector.h"
+#include "FaceDetector.h"
+#include "ScaleSpace.h"
+#include <mutex>
+
+namespace cvip
+{
+    /**
+     * Reference Detector backend: the cascade FaceDetector run on the
+     * scale space of the image (of each region, see ScaleSpace). It runs
+     * on the cpu and needs nothing but OpenCV.
+     *
+     * The FaceDetector is not assumed to be thread safe: detections are
+     * serialized, the asynchronous worker and blocking callers take turns.
+     * Scale space building (scaleSpace()) may run on any thread, which is
+     * what the Pipeline does in its own stage; its only call into the
+     * FaceDetector, Image::create_scale_space(), takes detectLock too.
+     *
+     * @author evangelos sariyanidi / sariyanidi[at]gmail[dot]com
+     * @date april 2011
+     */
+    class CascadeDetector : public Detector
+    {
+    public:
+        // take a cascade detector, ownership is taken
+        CascadeDetector(cvip::FaceDetector* _faceDetector, uint maxBatch = 8)
+            : Detector(maxBatch), faceDetector(_faceDetector), pyramid(_faceDetector) {}
+
+        ~CascadeDetector();
+
+        std::vector<cvip::DetectionRect> detect(const cv::Mat& image, const std::vector<cv::Rect>& rois);
+
+        // build the scale spaces of the regions of image (the whole image if none) into scales
+        void scaleSpace(const cv::Mat& image, const std::vector<cv::Rect>& rois, cvip::ScaleSpace& scales);
+
+        // run the cascade on the scale spaces of all regions, detections are in image coordinates
+        std::vector<cvip::DetectionRect> detect(cvip::ScaleSpace& scales);
+
+    private:
+        // the cascade on each region of scales, detectLock held
+        std::vector<cvip::DetectionRect> detectRegions(cvip::ScaleSpace& scales);
+
+        //! @property the wrapped detector
+        cvip::FaceDetector* faceDetector;
+
+        //! @property serializes faceDetector and pyramid
+        std::mutex detectLock;
+
+        //! @property scale spaces of the last image given to detect(), kept for the next one;
+        //! built with detectLock held, thus it takes no lock of its own
+        cvip::ScaleSpace pyramid;
+    };
+}
+
+#endif // CASCADEDETECTOR_H
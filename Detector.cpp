@@ -0,0 +1,176 @@
+#include "Detector.h"
+#include <algorithm>
+
+using namespace cvip;
+
+/**
+ * Queue a request for the worker, starting it on first use.
+ *
+ * @param  Request& request - copied, the image is shared, not copied
+ * @return Ticket - to poll() the result with
+ */
+Detector::Ticket Detector::submit(const Request& request)
+{
+    std::lock_guard<std::mutex> lk(lock);
+
+    if (!worker.joinable())
+        worker = std::thread(&Detector::run, this);
+
+    Ticket ticket = nextTicket++;
+
+    queue.push_back(request);
+    queueTickets.push_back(ticket);
+    ++numQueued;
+
+    wake.notify_one();
+
+    return ticket;
+}
+
+/**
+ * Take the result of a request if the worker is done with it.
+ *
+ * @param  Ticket ticket
+ * @param  Result& result - output
+ * @return bool - false if the result is not ready (or was taken already)
+ */
+bool Detector::poll(Ticket ticket, Result& result)
+{
+    std::lock_guard<std::mutex> lk(lock);
+
+    for (uint i=0; i<ready.size(); ++i)
+    {
+        if (ready[i].ticket != ticket)
+            continue;
+
+        std::swap(result, ready[i]);
+        ready.erase(ready.begin()+i);
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * Take all ready results, in the order the worker finished them.
+ *
+ * @param  vector<Result>& results - output, appended to
+ * @return uint - number of results taken
+ */
+uint Detector::poll(std::vector<Result>& results)
+{
+    std::lock_guard<std::mutex> lk(lock);
+
+    uint n = ready.size();
+    results.insert(results.end(), ready.begin(), ready.end());
+    ready.clear();
+
+    return n;
+}
+
+/**
+ * Block until the worker has run every submitted request.
+ *
+ * @return void
+ */
+void Detector::wait()
+{
+    std::unique_lock<std::mutex> lk(lock);
+    idle.wait(lk, [this] { return numQueued == 0; });
+}
+
+uint Detector::numPending() const
+{
+    std::lock_guard<std::mutex> lk(lock);
+    return numQueued + ready.size();
+}
+
+/**
+ * Detect on a batch of requests. Backends that can't batch keep this
+ * one, which runs detect() on each request in turn.
+ *
+ * @param  vector<const Request*>& batch
+ * @param  vector<Result>& results - output, detections of batch[i] go to results[i]
+ * @return void
+ */
+void Detector::detectBatch(const std::vector<const Request*>& batch, std::vector<Result>& results)
+{
+    results.resize(batch.size());
+
+    for (uint i=0; i<batch.size(); ++i)
+        results[i].detections = detect(batch[i]->image, batch[i]->rois);
+}
+
+/**
+ * Let the worker run what is queued, then stop it. Called by the
+ * destructor of the backend, while detect() is still there.
+ *
+ * @return void
+ */
+void Detector::stop()
+{
+    {
+        std::lock_guard<std::mutex> lk(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+
+    if (worker.joinable())
+        worker.join();
+}
+
+/**
+ * Worker thread: take up to maxBatch queued requests at a time, of
+ * whatever frames and streams, and detect on them.
+ *
+ * @return void
+ */
+void Detector::run()
+{
+    std::vector<Request> batch;
+    std::vector<const Request*> batchPtrs;
+    std::vector<Ticket> tickets;
+    std::vector<Result> results;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lk(lock);
+            wake.wait(lk, [this] { return stopping || !queue.empty(); });
+
+            if (queue.empty())
+                return;
+
+            uint n = std::min<size_t>(maxBatch, queue.size());
+
+            batch.assign(queue.begin(), queue.begin()+n);
+            tickets.assign(queueTickets.begin(), queueTickets.begin()+n);
+            queue.erase(queue.begin(), queue.begin()+n);
+            queueTickets.erase(queueTickets.begin(), queueTickets.begin()+n);
+        }
+
+        batchPtrs.clear();
+        for (uint i=0; i<batch.size(); ++i)
+            batchPtrs.push_back(&batch[i]);
+
+        detectBatch(batchPtrs, results);
+
+        for (uint i=0; i<batch.size(); ++i)
+        {
+            results[i].ticket = tickets[i];
+            results[i].stream = batch[i].stream;
+            results[i].frame = batch[i].frame;
+            results[i].timestamp = batch[i].timestamp;
+        }
+
+        {
+            std::lock_guard<std::mutex> lk(lock);
+            ready.insert(ready.end(), results.begin(), results.begin()+batch.size());
+            numQueued -= batch.size();
+        }
+        idle.notify_all();
+
+        // drop the images, they may be large
+        batch.clear();
+    }
+}
@@ -0,0 +1,122 @@
+#ifndef DETECTOR_H
+#define DETECTOR_H
+
+#include "Image.h"
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace cvip
+{
+    /**
+     * Object detector as seen by the Tracker. A backend implements the
+     * blocking detect(); the asynchronous API comes with this class:
+     * submit() queues a request and returns at once, a worker thread
+     * takes the queued requests (of any frames and streams) in batches
+     * of up to maxBatch and hands them to detectBatch(), and poll()
+     * picks up the results by ticket. The worker is started by the
+     * first submit(), thus blocking-only use runs no thread.
+     *
+     * A backend overrides detectBatch() if it can do better than one
+     * detect() after the other (e.g. a remote or GPU detector), and
+     * must call stop() first thing in its destructor, so that the worker
+     * never runs into a half destroyed object.
+     *
+     * @author evangelos sariyanidi / sariyanidi[at]gmail[dot]com
+     * @date april 2011
+     */
+    class Detector
+    {
+    public:
+        //! identifies a submitted request
+        typedef unsigned long Ticket;
+
+        //! a frame to detect on
+        struct Request
+        {
+            Request() : stream(0), frame(0), timestamp(-1.) {}
+
+            uint stream;
+            unsigned long frame;
+            double timestamp;
+
+            //! @property must stay unchanged until the result is polled
+            cv::Mat image;
+
+            //! @property regions of image to detect on, empty for the whole image
+            std::vector<cv::Rect> rois;
+        };
+
+        //! detections of a request, in image coordinates
+        struct Result
+        {
+            Ticket ticket;
+            uint stream;
+            unsigned long frame;
+            double timestamp;
+            std::vector<cvip::DetectionRect> detections;
+        };
+
+        Detector(uint _maxBatch = 8) : maxBatch(_maxBatch ? _maxBatch : 1), nextTicket(1), numQueued(0), stopping(false) {}
+        virtual ~Detector() { stop(); }
+
+        // detections of image (of its regions, empty = whole image), blocking
+        virtual std::vector<cvip::DetectionRect> detect(const cv::Mat& image, const std::vector<cv::Rect>& rois) = 0;
+
+        // queue a request, return its ticket
+        Ticket submit(const Request& request);
+
+        // take the result of ticket if it is ready, false otherwise
+        bool poll(Ticket ticket, Result& result);
+
+        // take all ready results, appended to results; return how many
+        uint poll(std::vector<Result>& results);
+
+        // block until every submitted request has its result
+        void wait();
+
+        // requests submitted whose results are not taken yet
+        uint numPending() const;
+
+    protected:
+        // run a batch of requests, results[i] is that of batch[i]; default: detect() in turn
+        virtual void detectBatch(const std::vector<const Request*>& batch, std::vector<Result>& results);
+
+        // finish queued requests and stop the worker, see the class comment
+        void stop();
+
+    private:
+        // not copyable
+        Detector(const Detector&);
+        Detector& operator=(const Detector&);
+
+        // worker thread body
+        void run();
+
+        //! @property requests a detectBatch() call takes at most
+        uint maxBatch;
+
+        //! @property guards all below
+        mutable std::mutex lock;
+        std::condition_variable wake, idle;
+
+        //! @property submitted requests not taken by the worker, their tickets
+        std::deque<Request> queue;
+        std::deque<Ticket> queueTickets;
+
+        //! @property results not taken by poll()
+        std::vector<Result> ready;
+
+        Ticket nextTicket;
+
+        //! @property requests queued or running
+        uint numQueued;
+
+        bool stopping;
+        std::thread worker;
+    };
+}
+
+#endif // DETECTOR_H
@@ -0,0 +1,217 @@
+#include "Instruments.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+using namespace cvip;
+
+static const char* TIMER_NAMES[Instruments::NUM_TIMERS] =
+    { "frame", "detect", "predict", "associate", "correct", "birth", "drop" };
+
+static const char* COUNTER_NAMES[Instruments::NUM_COUNTERS] =
+    { "frames", "detections", "tracks_created", "tracks_confirmed", "tracks_dropped" };
+
+/**
+ * Bucket of a value: values below SUB_COUNT have a bucket each, above
+ * that every power of two is split into SUB_COUNT buckets. Values past
+ * the range go to the last bucket.
+ *
+ * @param  unsigned long long ns
+ * @return uint
+ */
+uint LatencyHistogram::bucket(unsigned long long ns)
+{
+    if (ns < SUB_COUNT)
+        return (uint)ns;
+
+    // index of the highest set bit
+#if defined(__GNUC__)
+    uint e = 63 - __builtin_clzll(ns);
+#else
+    uint e = 0;
+    for (unsigned long long v = ns >> 1; v; v >>= 1)
+        ++e;
+#endif
+
+    if (e >= MAX_BITS)
+        return NUM_BUCKETS-1;
+
+    uint shift = e - SUB_BITS;
+
+    return SUB_COUNT*(shift+1) + (uint)((ns >> shift) - SUB_COUNT);
+}
+
+/**
+ * Middle of the value range of a bucket.
+ *
+ * @param  uint b
+ * @return unsigned long long
+ */
+unsigned long long LatencyHistogram::bucketValue(uint b)
+{
+    if (b < SUB_COUNT)
+        return b;
+
+    uint shift = b/SUB_COUNT - 1;
+    unsigned long long low = (unsigned long long)(SUB_COUNT + b%SUB_COUNT) << shift;
+
+    return low + ((1ull << shift) >> 1);
+}
+
+/**
+ * Forget all records.
+ *
+ * @return void
+ */
+void LatencyHistogram::clear()
+{
+    for (uint b=0; b<NUM_BUCKETS; ++b)
+        buckets[b].store(0, std::memory_order_relaxed);
+
+    total.store(0, std::memory_order_relaxed);
+    maxValue.store(0, std::memory_order_relaxed);
+}
+
+/**
+ * Number of records.
+ *
+ * @return unsigned long long
+ */
+unsigned long long LatencyHistogram::count() const
+{
+    unsigned long long n = 0;
+
+    for (uint b=0; b<NUM_BUCKETS; ++b)
+        n += buckets[b].load(std::memory_order_relaxed);
+
+    return n;
+}
+
+/**
+ * Smallest bucket value v such that a fraction q of the records are not
+ * above v's bucket. Records made during the call may or may not count.
+ *
+ * @param  double q - in [0,1]
+ * @return unsigned long long - ns, 0 if nothing is recorded
+ */
+unsigned long long LatencyHistogram::percentile(double q) const
+{
+    unsigned long long n = count();
+
+    if (n == 0)
+        return 0;
+
+    unsigned long long rank = (unsigned long long)(q*n + 0.5), seen = 0;
+    if (rank < 1)
+        rank = 1;
+
+    for (uint b=0; b<NUM_BUCKETS; ++b)
+    {
+        seen += buckets[b].load(std::memory_order_relaxed);
+
+        if (seen >= rank)
+            return std::min(bucketValue(b), max());
+    }
+
+    return max();
+}
+
+/**
+ * Forget all records.
+ *
+ * @return void
+ */
+void Instruments::clear()
+{
+    for (uint t=0; t<NUM_TIMERS; ++t)
+        timers[t].clear();
+
+    for (uint c=0; c<NUM_COUNTERS; ++c)
+        counters[c].store(0, std::memory_order_relaxed);
+}
+
+/**
+ * Copy of all timers and counters. Timers are in secs.
+ *
+ * @return Snapshot
+ */
+Instruments::Snapshot Instruments::snapshot() const
+{
+    Snapshot s;
+
+    for (uint t=0; t<NUM_TIMERS; ++t)
+    {
+        const LatencyHistogram& h = timers[t];
+        TimerStats& ts = s.timers[t];
+
+        ts.count = h.count();
+        ts.mean = ts.count ? h.sum()*1e-9/ts.count : 0.;
+        ts.p50 = h.percentile(0.50)*1e-9;
+        ts.p90 = h.percentile(0.90)*1e-9;
+        ts.p99 = h.percentile(0.99)*1e-9;
+        ts.max = h.max()*1e-9;
+    }
+
+    for (uint c=0; c<NUM_COUNTERS; ++c)
+        s.counters[c] = counters[c].load(std::memory_order_relaxed);
+
+    return s;
+}
+
+/**
+ * Dump a snapshot in the Prometheus text exposition format: a summary
+ * per timer (cvip_tracker_step_seconds{step="..."}) and a counter per
+ * event (cvip_tracker_<event>_total). The file is written aside and
+ * renamed, so a scraper never reads half of it.
+ *
+ * @param  string& path
+ * @return bool
+ */
+bool Instruments::writePrometheus(const std::string& path) const
+{
+    Snapshot s = snapshot();
+    std::string tmpPath = path + ".tmp";
+
+    {
+        std::ofstream out(tmpPath.c_str());
+
+        if (!out)
+            return false;
+
+        out << "# HELP cvip_tracker_step_seconds Time spent per frame by a step of the tracker.\n";
+        out << "# TYPE cvip_tracker_step_seconds summary\n";
+
+        for (uint t=0; t<NUM_TIMERS; ++t)
+        {
+            const TimerStats& ts = s.timers[t];
+            const char* name = TIMER_NAMES[t];
+
+            out << "cvip_tracker_step_seconds{step=\"" << name << "\",quantile=\"0.5\"} " << ts.p50 << "\n";
+            out << "cvip_tracker_step_seconds{step=\"" << name << "\",quantile=\"0.9\"} " << ts.p90 << "\n";
+            out << "cvip_tracker_step_seconds{step=\"" << name << "\",quantile=\"0.99\"} " << ts.p99 << "\n";
+            out << "cvip_tracker_step_seconds_sum{step=\"" << name << "\"} " << ts.mean*ts.count << "\n";
+            out << "cvip_tracker_step_seconds_count{step=\"" << name << "\"} " << ts.count << "\n";
+        }
+
+        for (uint c=0; c<NUM_COUNTERS; ++c)
+        {
+            out << "# TYPE cvip_tracker_" << COUNTER_NAMES[c] << "_total counter\n";
+            out << "cvip_tracker_" << COUNTER_NAMES[c] << "_total " << s.counters[c] << "\n";
+        }
+
+        if (!out)
+            return false;
+    }
+
+    return std::rename(tmpPath.c_str(), path.c_str()) == 0;
+}
+
+const char* Instruments::timerName(Timer t)
+{
+    return TIMER_NAMES[t];
+}
+
+const char* Instruments::counterName(Counter c)
+{
+    return COUNTER_NAMES[c];
+}
@@ -0,0 +1,147 @@
+#ifndef INSTRUMENTS_H
+#define INSTRUMENTS_H
+
+#include "opencv2/core/core.hpp"
+#include <atomic>
+#include <string>
+
+namespace cvip
+{
+    /**
+     * Latency histogram in the manner of HdrHistogram: values (in ns) are
+     * counted in buckets whose width is 1/2^SUB_BITS of their magnitude,
+     * so any recorded value is known within ~6% from 1 ns up to about
+     * 2 minutes, in a fixed amount of memory. Counts are atomics, thus
+     * any thread may record while another one reads.
+     *
+     * @author evangelos sariyanidi / sariyanidi[at]gmail[dot]com
+     * @date april 2011
+     */
+    class LatencyHistogram
+    {
+    public:
+        static const uint SUB_BITS = 4;
+        static const uint SUB_COUNT = 1u << SUB_BITS;
+        static const uint MAX_BITS = 37;
+        static const uint NUM_BUCKETS = SUB_COUNT*(MAX_BITS-SUB_BITS+1);
+
+        LatencyHistogram() { clear(); }
+
+        void record(unsigned long long ns)
+        {
+            buckets[bucket(ns)].fetch_add(1, std::memory_order_relaxed);
+            total.fetch_add(ns, std::memory_order_relaxed);
+
+            unsigned long long m = maxValue.load(std::memory_order_relaxed);
+            while (ns > m && !maxValue.compare_exchange_weak(m, ns, std::memory_order_relaxed))
+                ;
+        }
+
+        void clear();
+
+        unsigned long long count() const;
+        unsigned long long sum() const { return total.load(std::memory_order_relaxed); }
+        unsigned long long max() const { return maxValue.load(std::memory_order_relaxed); }
+
+        // value below which a fraction q of the records fall, in ns
+        unsigned long long percentile(double q) const;
+
+    private:
+        static uint bucket(unsigned long long ns);
+        static unsigned long long bucketValue(uint b);
+
+        std::atomic<unsigned long long> buckets[NUM_BUCKETS];
+        std::atomic<unsigned long long> total;
+        std::atomic<unsigned long long> maxValue;
+    };
+
+    /**
+     * Instrumentation of a Tracker: per-frame timers of its steps and
+     * counters of track events. Recording is lock-free, reading is done
+     * through snapshot() or dumped as Prometheus text.
+     *
+     * Instrumentation is compiled in only if CVIP_INSTRUMENTATION is
+     * defined; otherwise CVIP_TIME/CVIP_COUNT expand to nothing and the
+     * Tracker carries no Instruments at all.
+     *
+     * @author evangelos sariyanidi / sariyanidi[at]gmail[dot]com
+     * @date april 2011
+     */
+    class Instruments
+    {
+    public:
+        //! timed steps
+        enum Timer { FRAME, DETECT, PREDICT, ASSOCIATE, CORRECT, BIRTH, DROP, NUM_TIMERS };
+
+        //! counted events
+        enum Counter { FRAMES, DETECTIONS, TRACKS_CREATED, TRACKS_CONFIRMED, TRACKS_DROPPED, NUM_COUNTERS };
+
+        //! timing of a step, in secs.
+        struct TimerStats
+        {
+            unsigned long long count;
+            double mean, p50, p90, p99, max;
+        };
+
+        //! everything recorded so far
+        struct Snapshot
+        {
+            TimerStats timers[NUM_TIMERS];
+            unsigned long long counters[NUM_COUNTERS];
+        };
+
+        /**
+         * Times its own scope into a timer.
+         */
+        class Scope
+        {
+        public:
+            Scope(Instruments& _instr, Timer _timer) : instr(_instr), timer(_timer), tStart(cv::getTickCount()) {}
+            ~Scope() { instr.record(timer, cv::getTickCount()-tStart); }
+
+        private:
+            Instruments& instr;
+            const Timer timer;
+            const int64 tStart;
+        };
+
+        Instruments() : nsPerTick(1e9/cv::getTickFrequency()) { clear(); }
+
+        // add a duration, in ticks of cv::getTickCount()
+        void record(Timer t, int64 ticks) { timers[t].record(ticks > 0 ? (unsigned long long)(ticks*nsPerTick) : 0); }
+
+        void add(Counter c, unsigned long long n) { counters[c].fetch_add(n, std::memory_order_relaxed); }
+
+        void clear();
+
+        Snapshot snapshot() const;
+
+        // write a snapshot in Prometheus text format, false on failure
+        bool writePrometheus(const std::string& path) const;
+
+        static const char* timerName(Timer t);
+        static const char* counterName(Counter c);
+
+    private:
+        //! @property nanoseconds per tick of cv::getTickCount()
+        const double nsPerTick;
+
+        LatencyHistogram timers[NUM_TIMERS];
+        std::atomic<unsigned long long> counters[NUM_COUNTERS];
+    };
+}
+
+#define CVIP_CONCAT_(a, b) a##b
+#define CVIP_CONCAT(a, b) CVIP_CONCAT_(a, b)
+
+#ifdef CVIP_INSTRUMENTATION
+// time the rest of the enclosing scope
+#define CVIP_TIME(instr, timer) cvip::Instruments::Scope CVIP_CONCAT(cvipScope, __LINE__)((instr), cvip::Instruments::timer)
+// add n to a counter
+#define CVIP_COUNT(instr, counter, n) (instr).add(cvip::Instruments::counter, (n))
+#else
+#define CVIP_TIME(instr, timer)
+#define CVIP_COUNT(instr, counter, n)
+#endif
+
+#endif // INSTRUMENTS_H
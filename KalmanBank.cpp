@@ -0,0 +1,751 @@
+#include "KalmanBank.h"
+#include <cmath>
+#include <algorithm>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+using namespace cvip;
+
+const float KalmanBank::STEADY_TOLERANCE = 1e-2f;
+
+// number of floats processed at once by predict(), buffers are padded to it
+#if defined(__AVX__)
+static const uint SIMD_WIDTH = 8;
+#elif defined(__SSE__)
+static const uint SIMD_WIDTH = 4;
+#else
+static const uint SIMD_WIDTH = 1;
+#endif
+
+/**
+ * Switch to another motion model. Only possible while no slot is in
+ * use, since slots of different models can't share the buffers.
+ *
+ * @param  MotionModel& _model
+ * @return bool - false if a slot is in use
+ */
+bool KalmanBank::setModel(const MotionModel& _model)
+{
+    if (numSlots != freeSlots.size())
+        return false;
+
+    model = _model;
+
+    // records of the old model can't be replayed with the new one
+    historyHead = numRecords = 0;
+
+    if (steadyOn)
+        solveSteadyState();
+
+    return true;
+}
+
+/**
+ * Turn the steady-state gain on or off. All slots start on the full
+ * path and switch as they converge.
+ *
+ * @param  bool on
+ * @return void
+ */
+void KalmanBank::setSteadyState(bool on)
+{
+    steadyOn = on;
+    steady.assign(steady.size(), TRANSIENT);
+
+    if (on)
+        solveSteadyState();
+}
+
+/**
+ * Steady-state covariance and gain of the model for a track measured
+ * every nominal frame: the fixed point of the Riccati recursion (the
+ * solution of the discrete algebraic Riccati equation), found by
+ * iterating it, which converges for any stable model.
+ *
+ * @return void
+ */
+void KalmanBank::solveSteadyState()
+{
+    Block b = { 1.f, 0.f, 0.f, 1.f, 0.f, model.order() == 3 ? 1.f : 0.f };
+
+    for (uint it=0; it<100000; ++it)
+    {
+        Block prev = b;
+
+        predictBlock(b, model.dt, model.processNoise, model.order() == 3);
+        steadyPrior = b;
+        correctBlock(b, model.measurementNoise, steadyGain);
+
+        float change = std::fabs(b.p00-prev.p00) + std::fabs(b.p01-prev.p01) + std::fabs(b.p11-prev.p11)
+                     + std::fabs(b.p02-prev.p02) + std::fabs(b.p12-prev.p12) + std::fabs(b.p22-prev.p22);
+
+        if (change <= 1e-7f*(b.p00 + b.p11 + b.p22))
+            break;
+    }
+
+    steadyPost = b;
+}
+
+/**
+ * Keep the last depth frames, see correctLate(). Records kept so far
+ * are dropped.
+ *
+ * @param  uint depth - 0 to turn the history off
+ * @return void
+ */
+void KalmanBank::setHistory(uint depth)
+{
+    history.clear();
+    history.resize(depth);
+    historyHead = numRecords = 0;
+
+    for (uint i=0; i<history.size(); ++i)
+        reserveRecord(history[i], capacity);
+}
+
+/**
+ * Make room for n slots in a record of the history.
+ *
+ * @param  Record& r
+ * @param  uint n
+ * @return void
+ */
+void KalmanBank::reserveRecord(Record& r, uint n)
+{
+    r.x.reserve(MAX_N*n);
+    r.p.reserve(6*n);
+    r.z.reserve(M*n);
+    r.measured.reserve(n);
+}
+
+/**
+ * Record the end of a frame: state and covariance of every slot, and
+ * the measurements it was corrected with, over the oldest record once
+ * the ring is full. Called after the last correction of the frame.
+ *
+ * @param  unsigned long frame - frames are numbered consecutively
+ * @return void
+ */
+void KalmanBank::record(unsigned long frame)
+{
+    if (history.empty())
+        return;
+
+    uint idx;
+    if (numRecords < history.size()) {
+        idx = (historyHead + numRecords++) % history.size();
+    } else {
+        idx = historyHead;
+        historyHead = (historyHead+1) % history.size();
+    }
+
+    Record& r = history[idx];
+    uint n = numSlots, rows = model.order()*M;
+
+    r.frame = frame;
+    r.dt = lastDt;
+    r.n = n;
+
+    r.x.resize(rows*n);
+    for (uint k=0; k<rows; ++k)
+        std::copy(state[k].begin(), state[k].begin()+n, r.x.begin()+k*n);
+
+    // in the order of Block
+    const std::vector<float>* p[6] = { &pPos, &pPosVel, &pPosAcc, &pVel, &pVelAcc, &pAcc };
+
+    r.p.resize(6*n);
+    for (uint j=0; j<6; ++j)
+        std::copy(p[j]->begin(), p[j]->begin()+n, r.p.begin()+j*n);
+
+    r.z.assign(frameZ.begin(), frameZ.begin()+n*M);
+    r.measured.assign(frameMeasured.begin(), frameMeasured.begin()+n);
+    std::fill(frameMeasured.begin(), frameMeasured.begin()+n, 0);
+
+    currentFrame = frame+1;
+}
+
+/**
+ * Fuse a measurement of an earlier frame at that frame: the slot is
+ * taken back to its record of the frame and corrected there, then
+ * brought to the current frame again by the time steps and
+ * measurements recorded since, and by the current frame's prediction
+ * and measurement (if any). Like correct(), called after predict() of
+ * the current frame. The records on the way are rewritten, thus later
+ * late measurements see this one.
+ *
+ * @param  uint slot
+ * @param  unsigned long frame - of the measurement
+ * @param  DetectionRect& d - measurement
+ * @return bool - false if nothing is done: the slot wasn't allocated by frame
+ *                 (or was reused since), frame is not in the history, or
+ *                 the slot was measured at frame already
+ */
+bool KalmanBank::correctLate(uint slot, unsigned long frame, const DetectionRect& d)
+{
+    int idx = recordIndex(frame);
+
+    if (idx < 0 || born[slot] > frame || history[idx].measured[slot])
+        return false;
+
+    Record& r = history[idx];
+    float z[M];
+    measure(d, z);
+
+    load(slot, r);
+    correctZ(slot, z);
+    save(slot, r);
+
+    std::copy(z, z+M, r.z.begin()+slot*M);
+    r.measured[slot] = 1;
+
+    // re-run the frames recorded after it
+    uint size = history.size();
+    for (uint o=(idx+size-historyHead)%size+1; o<numRecords; ++o)
+    {
+        Record& rj = history[(historyHead+o) % size];
+
+        predictSlot(slot, rj.dt);
+        if (rj.measured[slot])
+            correctZ(slot, &rj.z[slot*M]);
+
+        save(slot, rj);
+    }
+
+    // and the current one
+    predictSlot(slot, lastDt);
+    if (frameMeasured[slot])
+        correctZ(slot, &frameZ[slot*M]);
+
+    return true;
+}
+
+/**
+ * Rectangle of a slot at the end of a recorded frame.
+ *
+ * @param  uint slot
+ * @param  unsigned long frame
+ * @param  float* rect - output, x1, y1, x2, y2
+ * @return bool - false if the slot wasn't allocated by frame or frame is not in the history
+ */
+bool KalmanBank::coordAt(uint slot, unsigned long frame, float* rect) const
+{
+    int idx = recordIndex(frame);
+
+    if (idx < 0 || born[slot] > frame)
+        return false;
+
+    const Record& r = history[idx];
+    const float* x = &r.x[slot];
+    uint n = r.n;
+
+    for (uint i=0; i<M; ++i)
+        rect[i] = model.centered() ? corner(x[0], x[n], x[2*n], x[3*n], i) : x[i*n];
+
+    return true;
+}
+
+int KalmanBank::recordIndex(unsigned long frame) const
+{
+    if (numRecords == 0)
+        return -1;
+
+    unsigned long oldest = history[historyHead].frame;
+
+    if (frame < oldest || frame - oldest >= numRecords)
+        return -1;
+
+    uint idx = (historyHead + (frame - oldest)) % history.size();
+
+    // frames were not consecutive
+    if (history[idx].frame != frame)
+        return -1;
+
+    return idx;
+}
+
+void KalmanBank::load(uint slot, const Record& r)
+{
+    uint n = r.n, rows = model.order()*M;
+
+    for (uint k=0; k<rows; ++k)
+        state[k][slot] = r.x[k*n+slot];
+
+    Block b = { r.p[slot], r.p[n+slot], r.p[2*n+slot], r.p[3*n+slot], r.p[4*n+slot], r.p[5*n+slot] };
+    setBlock(slot, b);
+
+    // the recorded covariance is not known to be converged
+    steady[slot] = TRANSIENT;
+}
+
+void KalmanBank::save(uint slot, Record& r) const
+{
+    uint n = r.n, rows = model.order()*M;
+
+    for (uint k=0; k<rows; ++k)
+        r.x[k*n+slot] = state[k][slot];
+
+    Block b = block(slot);
+    r.p[slot] = b.p00;
+    r.p[n+slot] = b.p01;
+    r.p[2*n+slot] = b.p02;
+    r.p[3*n+slot] = b.p11;
+    r.p[4*n+slot] = b.p12;
+    r.p[5*n+slot] = b.p22;
+}
+
+/**
+ * Take a free slot (or a new one) and initialize its filter at
+ * the coordinates of initRect with zero derivatives and identity
+ * error covariance.
+ *
+ * @param  DetectionRect& initRect
+ * @return uint - slot index
+ */
+uint KalmanBank::alloc(const DetectionRect& initRect)
+{
+    uint slot;
+
+    if (!freeSlots.empty()) {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    } else {
+        slot = numSlots++;
+        reserve(numSlots);
+    }
+
+    // we are tracking 4 points, thus having 4 states: corners of rectangle (by default)
+    float z[M];
+    measure(initRect, z);
+
+    for (uint i=0; i<M; ++i)
+        state[i][slot] = z[i];
+
+    for (uint i=M; i<MAX_N; ++i)
+        state[i][slot] = 0.f;
+
+    pPos[slot] = 1.f;
+    pPosVel[slot] = 0.f;
+    pVel[slot] = 1.f;
+
+    // accelerations: unit variance if the model has them, nothing otherwise
+    pPosAcc[slot] = pVelAcc[slot] = 0.f;
+    pAcc[slot] = model.order() == 3 ? 1.f : 0.f;
+
+    kPos[slot] = kVel[slot] = kAcc[slot] = 0.f;
+
+    steady[slot] = TRANSIENT;
+
+    born[slot] = currentFrame;
+    frameMeasured[slot] = 0;
+
+    return slot;
+}
+
+/**
+ * Measurement of the model from a rect: its corners, or its center,
+ * aspect ratio and height.
+ *
+ * @param  DetectionRect& d
+ * @param  float* z - output, M values
+ * @return void
+ */
+void KalmanBank::measure(const DetectionRect& d, float* z) const
+{
+    if (!model.centered())
+    {
+        z[0] = d.x1;
+        z[1] = d.y1;
+        z[2] = d.x2;
+        z[3] = d.y2;
+        return;
+    }
+
+    float w = d.x2 - d.x1, h = d.y2 - d.y1;
+
+    z[0] = 0.5f*(d.x1 + d.x2);
+    z[1] = 0.5f*(d.y1 + d.y2);
+    z[2] = h > 0 ? w/h : 1.f;
+    z[3] = h;
+}
+
+/**
+ * Corner i (x1, y1, x2, y2) of a state of the center/aspect/height model.
+ *
+ * @return float
+ */
+float KalmanBank::corner(float cx, float cy, float aspect, float h, uint i)
+{
+    float half = 0.5f*(i & 1 ? h : aspect*h);
+
+    return (i & 1 ? cy : cx) + (i < 2 ? -half : half);
+}
+
+/**
+ * Grow all buffers so that n slots fit. New entries are zeroed, thus
+ * free slots can be predicted along with the others harmlessly.
+ *
+ * @param  uint n
+ * @return void
+ */
+void KalmanBank::reserve(uint n)
+{
+    if (n <= capacity)
+        return;
+
+    uint newCapacity = capacity ? capacity : 16;
+    while (newCapacity < n)
+        newCapacity *= 2;
+
+    // keep the length a multiple of the SIMD width
+    newCapacity = (newCapacity + SIMD_WIDTH-1)/SIMD_WIDTH*SIMD_WIDTH;
+
+    for (uint i=0; i<MAX_N; ++i)
+        state[i].resize(newCapacity, 0.f);
+
+    pPos.resize(newCapacity, 0.f);
+    pPosVel.resize(newCapacity, 0.f);
+    pVel.resize(newCapacity, 0.f);
+    pPosAcc.resize(newCapacity, 0.f);
+    pVelAcc.resize(newCapacity, 0.f);
+    pAcc.resize(newCapacity, 0.f);
+    kPos.resize(newCapacity, 0.f);
+    kVel.resize(newCapacity, 0.f);
+    kAcc.resize(newCapacity, 0.f);
+    steady.resize(newCapacity, TRANSIENT);
+    born.resize(newCapacity, 0);
+    frameZ.resize(newCapacity*M, 0.f);
+    frameMeasured.resize(newCapacity, 0);
+    freeSlots.reserve(newCapacity);
+
+    for (uint i=0; i<history.size(); ++i)
+        reserveRecord(history[i], newCapacity);
+
+    capacity = newCapacity;
+}
+
+/**
+ * Predict every slot dt secs. ahead:
+ *   x = F*x, P = F*P*F' + Q*dt/model.dt
+ * Like cv::KalmanFilter::predict(), the prediction is also taken as
+ * the posterior so that consecutive predictions without any
+ * measurement keep moving the track. A dt within model.dtTolerance of
+ * the nominal frame interval is taken as the nominal one.
+ *
+ * @param  float dt
+ * @return void
+ */
+void KalmanBank::predict(float dt)
+{
+    if (numSlots == 0)
+        return;
+
+    // timestamps jitter: a step this close to a nominal frame is one, and keeps the steady gain
+    dt = nominalDt(dt);
+    lastDt = dt;
+
+    // process noise is given per nominal frame
+    float q = dt == model.dt ? model.processNoise : model.processNoise*dt/model.dt;
+
+    // converged slots corrected last frame stay converged over a nominal step;
+    // missed ones, or any slot over another step, go back to the full path
+    if (steadyOn)
+    {
+        unsigned char* st = &steady[0];
+        unsigned char post = dt == model.dt ? STEADY_POST : 0xff;
+        uint n = numSlots;
+
+        for (uint s=0; s<n; ++s)
+            st[s] = st[s] == post ? STEADY_PRIOR : TRANSIENT;
+    }
+
+    if (model.order() == 3)
+        predictAcceleration(dt, q);
+    else
+        predictVelocity(dt, q);
+}
+
+/**
+ * Constant velocity prediction, F = [I dt*I; 0 I].
+ *
+ * @return void
+ */
+void KalmanBank::predictVelocity(float dt, float q)
+{
+    uint n = (numSlots + SIMD_WIDTH-1)/SIMD_WIDTH*SIMD_WIDTH;
+    uint s = 0;
+
+#if defined(__AVX__)
+    const __m256 vDt = _mm256_set1_ps(dt);
+    const __m256 vQ = _mm256_set1_ps(q);
+
+    for (; s<n; s+=8)
+    {
+        for (uint i=0; i<M; ++i)
+        {
+            float* x = &state[i][s];
+            __m256 v = _mm256_loadu_ps(&state[M+i][s]);
+            _mm256_storeu_ps(x, _mm256_add_ps(_mm256_loadu_ps(x), _mm256_mul_ps(vDt, v)));
+        }
+
+        __m256 a = _mm256_loadu_ps(&pPos[s]);
+        __m256 b = _mm256_loadu_ps(&pPosVel[s]);
+        __m256 c = _mm256_loadu_ps(&pVel[s]);
+        __m256 bNew = _mm256_add_ps(b, _mm256_mul_ps(vDt, c));
+
+        a = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(a, _mm256_mul_ps(vDt, b)), _mm256_mul_ps(vDt, bNew)), vQ);
+
+        _mm256_storeu_ps(&pPos[s], a);
+        _mm256_storeu_ps(&pPosVel[s], bNew);
+        _mm256_storeu_ps(&pVel[s], _mm256_add_ps(c, vQ));
+    }
+#elif defined(__SSE__)
+    const __m128 vDt = _mm_set1_ps(dt);
+    const __m128 vQ = _mm_set1_ps(q);
+
+    for (; s<n; s+=4)
+    {
+        for (uint i=0; i<M; ++i)
+        {
+            float* x = &state[i][s];
+            __m128 v = _mm_loadu_ps(&state[M+i][s]);
+            _mm_storeu_ps(x, _mm_add_ps(_mm_loadu_ps(x), _mm_mul_ps(vDt, v)));
+        }
+
+        __m128 a = _mm_loadu_ps(&pPos[s]);
+        __m128 b = _mm_loadu_ps(&pPosVel[s]);
+        __m128 c = _mm_loadu_ps(&pVel[s]);
+        __m128 bNew = _mm_add_ps(b, _mm_mul_ps(vDt, c));
+
+        a = _mm_add_ps(_mm_add_ps(_mm_add_ps(a, _mm_mul_ps(vDt, b)), _mm_mul_ps(vDt, bNew)), vQ);
+
+        _mm_storeu_ps(&pPos[s], a);
+        _mm_storeu_ps(&pPosVel[s], bNew);
+        _mm_storeu_ps(&pVel[s], _mm_add_ps(c, vQ));
+    }
+#endif
+
+    // scalar fallback
+    for (; s<n; ++s)
+    {
+        for (uint i=0; i<M; ++i)
+            state[i][s] += dt*state[M+i][s];
+
+        float a = pPos[s], b = pPosVel[s], c = pVel[s];
+        float bNew = b + dt*c;
+
+        pPos[s] = a + dt*b + dt*bNew + q;
+        pPosVel[s] = bNew;
+        pVel[s] = c + q;
+    }
+}
+
+/**
+ * Constant acceleration prediction: per coordinate
+ * F = [1 dt dt^2/2; 0 1 dt; 0 0 1] on (position, velocity, acceleration).
+ * Written as plain loops over slots, which compilers vectorize.
+ *
+ * @return void
+ */
+void KalmanBank::predictAcceleration(float dt, float q)
+{
+    float h = 0.5f*dt*dt;
+
+    for (uint i=0; i<M; ++i)
+    {
+        float* x = &state[i][0];
+        float* v = &state[M+i][0];
+        const float* acc = &state[2*M+i][0];
+
+        for (uint s=0; s<numSlots; ++s)
+        {
+            x[s] += dt*v[s] + h*acc[s];
+            v[s] += dt*acc[s];
+        }
+    }
+
+    // converged slots too: the branch would cost more than the few flops
+    for (uint s=0; s<numSlots; ++s)
+    {
+        Block b = block(s);
+        predictBlock(b, dt, q, true);
+        setBlock(s, b);
+    }
+}
+
+/**
+ * Prediction of a single slot, for correctLate(): the scalar version of
+ * predictAcceleration(), which is exact for the constant velocity
+ * models as well since their accelerations are 0.
+ *
+ * @param  uint slot
+ * @param  float dt
+ * @return void
+ */
+void KalmanBank::predictSlot(uint slot, float dt)
+{
+    dt = nominalDt(dt);
+
+    float q = dt == model.dt ? model.processNoise : model.processNoise*dt/model.dt;
+    float h = 0.5f*dt*dt;
+
+    for (uint i=0; i<M; ++i)
+    {
+        state[i][slot] += dt*state[M+i][slot] + h*state[2*M+i][slot];
+        state[M+i][slot] += dt*state[2*M+i][slot];
+    }
+
+    Block b = block(slot);
+    predictBlock(b, dt, q, model.order() == 3);
+    setBlock(slot, b);
+
+    steady[slot] = TRANSIENT;
+}
+
+/**
+ * Prediction of the covariance block of one coordinate,
+ * F = [1 dt dt^2/2; 0 1 dt; 0 0 1]. Without accelerations (acc false)
+ * their entries are 0 and it reduces to the constant velocity prediction.
+ *
+ * @param  Block& b
+ * @param  float dt
+ * @param  float q - process noise
+ * @param  bool acc
+ * @return void
+ */
+void KalmanBank::predictBlock(Block& b, float dt, float q, bool acc)
+{
+    float h = 0.5f*dt*dt;
+
+    // rows of F*P
+    float r00 = b.p00 + dt*b.p01 + h*b.p02, r01 = b.p01 + dt*b.p11 + h*b.p12, r02 = b.p02 + dt*b.p12 + h*b.p22;
+    float r11 = b.p11 + dt*b.p12, r12 = b.p12 + dt*b.p22;
+
+    // F*P*F' + Q
+    b.p00 = r00 + dt*r01 + h*r02 + q;
+    b.p01 = r01 + dt*r02;
+    b.p02 = r02;
+    b.p11 = r11 + dt*r12 + q;
+    b.p12 = r12;
+    b.p22 = acc ? b.p22 + q : 0.f;
+}
+
+/**
+ * Correction of the covariance block of one coordinate with H = [1 0 0]:
+ * K = P*H'/(H*P*H' + r), P = P - K*H*P.
+ *
+ * @param  Block& b
+ * @param  float r - measurement noise
+ * @param  float* k - output, 3 gains
+ * @return void
+ */
+void KalmanBank::correctBlock(Block& b, float r, float* k)
+{
+    float sInv = 1.f/(b.p00 + r);
+
+    k[0] = b.p00*sInv;
+    k[1] = b.p01*sInv;
+    k[2] = b.p02*sInv;
+
+    b.p11 -= k[1]*b.p01;
+    b.p12 -= k[1]*b.p02;
+    b.p22 -= k[2]*b.p02;
+    b.p00 -= k[0]*b.p00;
+    b.p01 -= k[0]*b.p01;
+    b.p02 -= k[0]*b.p02;
+}
+
+KalmanBank::Block KalmanBank::block(uint slot) const
+{
+    Block b = { pPos[slot], pPosVel[slot], pPosAcc[slot], pVel[slot], pVelAcc[slot], pAcc[slot] };
+    return b;
+}
+
+void KalmanBank::setBlock(uint slot, const Block& b)
+{
+    pPos[slot] = b.p00;
+    pPosVel[slot] = b.p01;
+    pPosAcc[slot] = b.p02;
+    pVel[slot] = b.p11;
+    pVelAcc[slot] = b.p12;
+    pAcc[slot] = b.p22;
+}
+
+/**
+ * Correct the prediction of a slot with measurement d:
+ *   K = P*H'*(H*P*H' + R)^-1, x = x + K*(z - H*x), P = P - K*H*P
+ * with H = [I 0]. The 4x4 inversion reduces to a single division
+ * since the coordinates are independent.
+ *
+ * @param  uint slot
+ * @param  DetectionRect& d - measurement
+ * @return void
+ */
+void KalmanBank::correct(uint slot, const DetectionRect& d)
+{
+    // Tracking 4 points
+    float z[M];
+    measure(d, z);
+
+    if (!history.empty()) {
+        std::copy(z, z+M, frameZ.begin()+slot*M);
+        frameMeasured[slot] = 1;
+    }
+
+    correctZ(slot, z);
+}
+
+/**
+ * Correction of correct(), on the measurement of the model.
+ *
+ * @param  uint slot
+ * @param  float* z - M values
+ * @return void
+ */
+void KalmanBank::correctZ(uint slot, const float* z)
+{
+    float k[3];
+    bool converged = steady[slot] == STEADY_PRIOR;
+    Block b;
+
+    if (converged) {
+        // cached gain and covariance, no division
+        k[0] = steadyGain[0];
+        k[1] = steadyGain[1];
+        k[2] = steadyGain[2];
+        b = steadyPost;
+    } else {
+        b = block(slot);
+        correctBlock(b, model.measurementNoise, k);
+    }
+
+    // k[2] is 0 without accelerations, which then stay 0
+    for (uint i=0; i<M; ++i)
+    {
+        float innovation = z[i] - state[i][slot];
+        state[i][slot] += k[0]*innovation;
+        state[M+i][slot] += k[1]*innovation;
+        state[2*M+i][slot] += k[2]*innovation;
+    }
+
+    // has the full path reached the steady state?
+    if (steadyOn && !converged)
+    {
+        const Block& p = steadyPost;
+        float tol = STEADY_TOLERANCE;
+
+        converged = std::fabs(b.p00-p.p00) <= tol*p.p00 && std::fabs(b.p01-p.p01) <= tol*std::fabs(p.p01)
+                 && std::fabs(b.p11-p.p11) <= tol*p.p11 && std::fabs(b.p02-p.p02) <= tol*std::fabs(p.p02)
+                 && std::fabs(b.p12-p.p12) <= tol*std::fabs(p.p12) && std::fabs(b.p22-p.p22) <= tol*p.p22;
+    }
+
+    steady[slot] = converged ? STEADY_POST : TRANSIENT;
+    setBlock(slot, b);
+
+    kPos[slot] = k[0];
+    kVel[slot] = k[1];
+    kAcc[slot] = k[2];
+}
@@ -0,0 +1,244 @@
+#ifndef KALMANBANK_H
+#define KALMANBANK_H
+
+#include "FaceDetector.h"
+#include "MotionModel.h"
+#include <vector>
+#include <cmath>
+
+namespace cvip
+{
+    /**
+     * Kalman filters of all track items of a Tracker, stored as
+     * structure-of-arrays so that all tracks are predicted in a single
+     * vectorized pass.
+     *
+     * The model is a MotionModel: 4 measured coordinates (rectangle
+     * corners by default), each with its velocity and optionally its
+     * acceleration, identity initial error covariance and diagonal
+     * noise matrices. With such a model the 4 coordinates never interact
+     * and their (position, velocity[, acceleration]) covariance blocks
+     * stay identical, so one block (3 or 6 floats) and one gain (2 or 3
+     * floats) per track describe the full covariance and gain exactly.
+     * The model is shared by all slots; nothing is rebuilt per track.
+     *
+     * Optionally (setSteadyState()) a track that is measured every
+     * nominal frame switches to the steady-state gain once its
+     * covariance has converged: its correction takes the cached gain
+     * and covariance instead of computing them. A missed detection or
+     * an off-nominal time step puts it back on the full path.
+     *
+     * Optionally (setHistory()) the state, covariance and measurement
+     * of every slot at the end of each of the last frames is kept in a
+     * ring, one record per frame. A late measurement (of a frame in the
+     * ring) is then fused at its own frame by correctLate(), and the
+     * slot is re-run to the current frame: predicted by the recorded
+     * time steps and corrected by the recorded measurements, O(lag)
+     * scalar steps for that slot alone.
+     *
+     * @author evangelos sariyanidi / sariyanidi[at]gmail[dot]com
+     * @date april 2011
+     */
+    class KalmanBank
+    {
+    public:
+        KalmanBank(const cvip::MotionModel& _model = cvip::MotionModel())
+            : model(_model), steadyOn(false), lastDt(_model.dt), currentFrame(0), historyHead(0), numRecords(0), numSlots(0), capacity(0) {}
+
+        // change the model, false if any slot is in use
+        bool setModel(const cvip::MotionModel& _model);
+        const cvip::MotionModel& getModel() const { return model; }
+
+        // use the steady-state gain for converged tracks (off by default)
+        void setSteadyState(bool on);
+        bool getSteadyState() const { return steadyOn; }
+
+        // is slot on the steady-state gain?
+        bool isSteady(uint slot) const { return steady[slot] != TRANSIENT; }
+
+        // keep the last depth frames for correctLate() (0 = off, the default)
+        void setHistory(uint depth);
+        uint getHistory() const { return history.size(); }
+
+        // end of frame: record every slot, the next frame is frame+1 (no-op without history)
+        void record(unsigned long frame);
+
+        // is frame in the history?
+        bool inHistory(unsigned long frame) const { return recordIndex(frame) >= 0; }
+
+        // correct slot with a measurement of an earlier frame and re-run it to the current one;
+        // false if the slot didn't exist at frame, frame is not in the history or already measured
+        bool correctLate(uint slot, unsigned long frame, const cvip::DetectionRect& d);
+
+        // i-th rectangle coordinate of slot at the end of a recorded frame, false as above
+        bool coordAt(uint slot, unsigned long frame, float* rect) const;
+
+        // grow buffers so that at least n slots fit, alloc() and record() don't allocate until then
+        void reserve(uint n);
+
+        // get a filter slot initialized at rect
+        uint alloc(const cvip::DetectionRect& initRect);
+
+        // give slot back, it may be reused by alloc()
+        void release(uint slot) { freeSlots.push_back(slot); }
+
+        // predict all slots dt secs. ahead, or one nominal frame
+        void predict(float dt);
+        void predict() { predict(model.dt); }
+
+        // correct a single slot with its measurement
+        void correct(uint slot, const cvip::DetectionRect& d);
+
+        // measurement of the model from a rect: corners, or center, aspect and height
+        void measure(const cvip::DetectionRect& d, float* z) const;
+
+        // i-th rectangle coordinate (x1, y1, x2, y2) of slot
+        float coord(uint slot, uint i) const { return model.centered() ? corner(slot, i) : state[i][slot]; }
+
+        // i-th position of slot, in the coordinates of the model (its predicted measurement)
+        float position(uint slot, uint i) const { return state[i][slot]; }
+
+        // i-th velocity of slot, in the coordinates of the model
+        float velocity(uint slot, uint i) const { return state[M+i][slot]; }
+
+        // i-th acceleration of slot, in the coordinates of the model; 0 if the model has none
+        float acceleration(uint slot, uint i) const { return state[2*M+i][slot]; }
+
+        // covariance block of slot: position, position-velocity, velocity
+        float covPos(uint slot) const { return pPos[slot]; }
+        float covPosVel(uint slot) const { return pPosVel[slot]; }
+        float covVel(uint slot) const { return pVel[slot]; }
+
+        // acceleration terms of the covariance block, 0 if the model has no acceleration
+        float covPosAcc(uint slot) const { return pPosAcc[slot]; }
+        float covVelAcc(uint slot) const { return pVelAcc[slot]; }
+        float covAcc(uint slot) const { return pAcc[slot]; }
+
+        // trace of the error covariance of slot
+        float uncertainty(uint slot) const { return M*(pPos[slot] + pVel[slot] + pAcc[slot]); }
+
+        // innovation covariance H*P*H' + R of slot, it's this times identity
+        float innovationVar(uint slot) const { return pPos[slot] + model.measurementNoise; }
+
+        // gain of the last correction of slot: position and velocity rows
+        float gainPos(uint slot) const { return kPos[slot]; }
+        float gainVel(uint slot) const { return kVel[slot]; }
+
+        //! @property length of the measurement vector
+        static const uint M = 4;
+
+        //! @property maximum dimension of the state vector: M coordinates, 2 derivatives
+        static const uint MAX_N = 3*M;
+
+        //! @property relative distance to the steady-state covariance that counts as converged
+        static const float STEADY_TOLERANCE;
+
+    private:
+        //! steady-state phase of a slot
+        enum Steady
+        {
+            TRANSIENT,      //! full path
+            STEADY_POST,    //! converged, corrected this frame
+            STEADY_PRIOR    //! converged and predicted one nominal frame, next correction takes the cached gain
+        };
+
+        //! covariance block of one coordinate, upper triangle of (position, velocity, acceleration)
+        struct Block
+        {
+            float p00, p01, p02, p11, p12, p22;
+        };
+
+        Block block(uint slot) const;
+        void setBlock(uint slot, const Block& b);
+
+        // P = F*P*F' + Q and P = P - K*H*P, k gets K, for one coordinate
+        static void predictBlock(Block& b, float dt, float q, bool acc);
+        static void correctBlock(Block& b, float r, float* k);
+
+        // solve the Riccati equation of the model by iterating it at the nominal dt
+        void solveSteadyState();
+
+        // i-th corner of slot from center, aspect and height
+        float corner(uint slot, uint i) const { return corner(state[0][slot], state[1][slot], state[2][slot], state[3][slot], i); }
+        static float corner(float cx, float cy, float aspect, float h, uint i);
+
+        // correct slot with the measurement of the model z
+        void correctZ(uint slot, const float* z);
+
+        // predict a single slot dt secs. ahead, as predict() does
+        void predictSlot(uint slot, float dt);
+
+        // dt, or the nominal frame interval if dt is within model.dtTolerance of it
+        float nominalDt(float dt) const { return std::fabs(dt - model.dt) <= model.dtTolerance*model.dt ? model.dt : dt; }
+
+        void predictVelocity(float dt, float q);
+        void predictAcceleration(float dt, float q);
+
+        //! @property the model of all slots
+        cvip::MotionModel model;
+
+        //! @property state vectors, state[k][slot] is the k-th state of slot:
+        //! coordinates, velocities, accelerations (if the model has them)
+        std::vector<float> state[MAX_N];
+
+        //! @property shared error covariance block of each slot, upper triangle
+        std::vector<float> pPos, pPosVel, pVel, pPosAcc, pVelAcc, pAcc;
+
+        //! @property shared gain of each slot: position, velocity and acceleration
+        std::vector<float> kPos, kVel, kAcc;
+
+        //! @property see setSteadyState(): on/off, phase of each slot
+        bool steadyOn;
+        std::vector<unsigned char> steady;
+
+        //! @property steady-state covariance after correction and after prediction, and gain
+        Block steadyPost, steadyPrior;
+        float steadyGain[3];
+
+        //! one frame of the history, x[k*n+slot], p[j*n+slot] and z[slot*M+i] for n slots
+        struct Record
+        {
+            unsigned long frame;
+            float dt;
+            uint n;
+            std::vector<float> x, p, z;
+            std::vector<unsigned char> measured;
+        };
+
+        // room for n slots in r
+        static void reserveRecord(Record& r, uint n);
+
+        // index in history of the record of frame, -1 if none
+        int recordIndex(unsigned long frame) const;
+
+        // copy slot from/to a record
+        void load(uint slot, const Record& r);
+        void save(uint slot, Record& r) const;
+
+        //! @property dt of the last predict(), the current frame's step
+        float lastDt;
+
+        //! @property frame being run, and the frame each slot was allocated at
+        unsigned long currentFrame;
+        std::vector<unsigned long> born;
+
+        //! @property measurement of each slot at the current frame, z[slot*M+i], and whether it has one
+        std::vector<float> frameZ;
+        std::vector<unsigned char> frameMeasured;
+
+        //! @property see setHistory(): ring of records, its oldest record and number of records
+        std::vector<Record> history;
+        uint historyHead, numRecords;
+
+        //! @property released slots waiting to be reused
+        std::vector<uint> freeSlots;
+
+        //! @property number of slots ever handed out
+        uint numSlots;
+
+        //! @property allocated length of each buffer, multiple of the SIMD width
+        uint capacity;
+    };
+}
+
+#endif // KALMANBANK_H
@@ -0,0 +1,292 @@
+#ifndef KALMANFILTER_H
+#define KALMANFILTER_H
+
+#include <cmath>
+
+namespace cvip
+{
+    /**
+     * Parameters of a linear Kalman model with fixed dimensions:
+     * transition F, measurement H and the noise covariances Q, R.
+     * A model is built once and shared by all filters using it.
+     *
+     * @author evangelos sariyanidi / sariyanidi[at]gmail[dot]com
+     * @date april 2011
+     */
+    template <unsigned int StateDim, unsigned int MeasDim, typename Scalar = float>
+    struct KalmanModel
+    {
+        Scalar F[StateDim][StateDim];  //! transition matrix
+        Scalar H[MeasDim][StateDim];   //! measurement matrix
+        Scalar Q[StateDim][StateDim];  //! process noise covariance
+        Scalar R[MeasDim][MeasDim];    //! measurement noise covariance
+
+        // identity F, zero H, Q and R
+        KalmanModel()
+        {
+            for (unsigned int i=0; i<StateDim; ++i)
+                for (unsigned int j=0; j<StateDim; ++j) {
+                    F[i][j] = (i == j) ? Scalar(1) : Scalar(0);
+                    Q[i][j] = Scalar(0);
+                }
+
+            for (unsigned int i=0; i<MeasDim; ++i) {
+                for (unsigned int j=0; j<StateDim; ++j)
+                    H[i][j] = Scalar(0);
+                for (unsigned int j=0; j<MeasDim; ++j)
+                    R[i][j] = Scalar(0);
+            }
+        }
+    };
+
+    /**
+     * Kalman filter with compile-time dimensions. All matrices live
+     * inside the object (no heap allocation) and every loop has constant
+     * bounds so the compiler can unroll them. The model is not copied,
+     * only referenced.
+     *
+     * The tracker filters with KalmanBank, which exploits the structure
+     * of its models; this full-matrix filter is the reference it is
+     * checked against (tests/KalmanBankTest.cpp) and timed against,
+     * along with cv::KalmanFilter (Benchmark -kalman).
+     *
+     * @author evangelos sariyanidi / sariyanidi[at]gmail[dot]com
+     * @date april 2011
+     */
+    template <unsigned int StateDim, unsigned int MeasDim, typename Scalar = float>
+    class KalmanFilter
+    {
+    public:
+        typedef KalmanModel<StateDim, MeasDim, Scalar> Model;
+
+        static const unsigned int N = StateDim;
+        static const unsigned int M = MeasDim;
+
+        // zero state, identity error covariance
+        KalmanFilter(const Model& _model) : model(&_model)
+        {
+            for (unsigned int i=0; i<N; ++i) {
+                x[i] = Scalar(0);
+                for (unsigned int j=0; j<N; ++j)
+                    P[i][j] = (i == j) ? Scalar(1) : Scalar(0);
+            }
+
+            for (unsigned int i=0; i<N; ++i)
+                for (unsigned int j=0; j<M; ++j)
+                    K[i][j] = Scalar(0);
+        }
+
+        // x = F*x, P = F*P*F' + Q
+        void predict();
+
+        // fuse measurement z, return false if innovation covariance is singular
+        bool correct(const Scalar* z);
+
+        //! @property state vector
+        Scalar x[StateDim];
+
+        //! @property error covariance
+        Scalar P[StateDim][StateDim];
+
+        //! @property gain of the last correction
+        Scalar K[StateDim][MeasDim];
+
+    private:
+        //! @property shared model parameters
+        const Model* model;
+    };
+
+    /**
+     * Predict one step ahead. Like cv::KalmanFilter::predict(), the
+     * prediction becomes the current state.
+     *
+     * @return void
+     */
+    template <unsigned int StateDim, unsigned int MeasDim, typename Scalar>
+    void KalmanFilter<StateDim, MeasDim, Scalar>::predict()
+    {
+        const Scalar (&F)[N][N] = model->F;
+
+        Scalar xNew[N];
+        for (unsigned int i=0; i<N; ++i) {
+            xNew[i] = Scalar(0);
+            for (unsigned int k=0; k<N; ++k)
+                xNew[i] += F[i][k]*x[k];
+        }
+
+        // FP = F*P
+        Scalar FP[N][N];
+        for (unsigned int i=0; i<N; ++i)
+            for (unsigned int j=0; j<N; ++j) {
+                Scalar s(0);
+                for (unsigned int k=0; k<N; ++k)
+                    s += F[i][k]*P[k][j];
+                FP[i][j] = s;
+            }
+
+        // P = FP*F' + Q
+        for (unsigned int i=0; i<N; ++i)
+            for (unsigned int j=0; j<N; ++j) {
+                Scalar s = model->Q[i][j];
+                for (unsigned int k=0; k<N; ++k)
+                    s += FP[i][k]*F[j][k];
+                P[i][j] = s;
+            }
+
+        for (unsigned int i=0; i<N; ++i)
+            x[i] = xNew[i];
+    }
+
+    /**
+     * Correct the state with a measurement:
+     *   S = H*P*H' + R, K = P*H'*S^-1, x += K*(z - H*x), P -= K*H*P
+     * S is symmetric positive definite, it is solved via Cholesky.
+     *
+     * @param  Scalar* z - measurement vector of length MeasDim
+     * @return bool - false if S is not positive definite (state untouched)
+     */
+    template <unsigned int StateDim, unsigned int MeasDim, typename Scalar>
+    bool KalmanFilter<StateDim, MeasDim, Scalar>::correct(const Scalar* z)
+    {
+        const Scalar (&H)[M][N] = model->H;
+
+        // HP = H*P
+        Scalar HP[M][N];
+        for (unsigned int i=0; i<M; ++i)
+            for (unsigned int j=0; j<N; ++j) {
+                Scalar s(0);
+                for (unsigned int k=0; k<N; ++k)
+                    s += H[i][k]*P[k][j];
+                HP[i][j] = s;
+            }
+
+        // S = HP*H' + R, factorized in place as L*L'
+        Scalar L[M][M];
+        for (unsigned int i=0; i<M; ++i)
+            for (unsigned int j=0; j<M; ++j) {
+                Scalar s = model->R[i][j];
+                for (unsigned int k=0; k<N; ++k)
+                    s += HP[i][k]*H[j][k];
+                L[i][j] = s;
+            }
+
+        for (unsigned int j=0; j<M; ++j)
+        {
+            Scalar d = L[j][j];
+            for (unsigned int k=0; k<j; ++k)
+                d -= L[j][k]*L[j][k];
+
+            if (!(d > Scalar(0)))
+                return false;
+
+            L[j][j] = std::sqrt(d);
+
+            for (unsigned int i=j+1; i<M; ++i) {
+                Scalar s = L[i][j];
+                for (unsigned int k=0; k<j; ++k)
+                    s -= L[i][k]*L[j][k];
+                L[i][j] = s/L[j][j];
+            }
+        }
+
+        // solve S*X = HP column by column, then K = X'
+        for (unsigned int c=0; c<N; ++c)
+        {
+            Scalar y[M];
+            for (unsigned int i=0; i<M; ++i) {
+                Scalar s = HP[i][c];
+                for (unsigned int k=0; k<i; ++k)
+                    s -= L[i][k]*y[k];
+                y[i] = s/L[i][i];
+            }
+
+            for (int i=M-1; i>=0; --i) {
+                Scalar s = y[i];
+                for (unsigned int k=i+1; k<M; ++k)
+                    s -= L[k][i]*K[c][k];
+                K[c][i] = s/L[i][i];
+            }
+        }
+
+        // innovation
+        Scalar r[M];
+        for (unsigned int i=0; i<M; ++i) {
+            Scalar s = z[i];
+            for (unsigned int k=0; k<N; ++k)
+                s -= H[i][k]*x[k];
+            r[i] = s;
+        }
+
+        for (unsigned int i=0; i<N; ++i)
+            for (unsigned int k=0; k<M; ++k)
+                x[i] += K[i][k]*r[k];
+
+        for (unsigned int i=0; i<N; ++i)
+            for (unsigned int j=0; j<N; ++j)
+                for (unsigned int k=0; k<M; ++k)
+                    P[i][j] -= K[i][k]*HP[k][j];
+
+        return true;
+    }
+
+    /**
+     * Constant velocity model of the 4 corners of a rectangle:
+     * state (x1, y1, x2, y2, vx1, vy1, vx2, vy2), measurement (x1, y1, x2, y2).
+     * MotionModel::CORNER_VELOCITY; over a step of dt, KalmanBank scales
+     * the process noise by dt/MotionModel::dt.
+     */
+    template <typename Scalar>
+    KalmanModel<8, 4, Scalar> cornerVelocityModel(Scalar dt, Scalar processNoise, Scalar measurementNoise)
+    {
+        KalmanModel<8, 4, Scalar> m;
+
+        for (unsigned int i=0; i<4; ++i) {
+            m.F[i][4+i] = dt;
+            m.H[i][i] = Scalar(1);
+            m.R[i][i] = measurementNoise;
+        }
+
+        for (unsigned int i=0; i<8; ++i)
+            m.Q[i][i] = processNoise;
+
+        return m;
+    }
+
+    /**
+     * Constant velocity model of center, aspect ratio and height:
+     * state (cx, cy, a, h, vcx, vcy, va, vh), measurement (cx, cy, a, h).
+     * MotionModel::CENTER_SCALE_VELOCITY.
+     */
+    template <typename Scalar>
+    KalmanModel<8, 4, Scalar> centerScaleVelocityModel(Scalar dt, Scalar processNoise, Scalar measurementNoise)
+    {
+        // same structure as the corner model, only the meaning of the states differs
+        return cornerVelocityModel<Scalar>(dt, processNoise, measurementNoise);
+    }
+
+    /**
+     * Constant acceleration model of the 4 corners of a rectangle:
+     * state (corners, velocities, accelerations), measurement (corners).
+     * MotionModel::CORNER_ACCELERATION.
+     */
+    template <typename Scalar>
+    KalmanModel<12, 4, Scalar> cornerAccelerationModel(Scalar dt, Scalar processNoise, Scalar measurementNoise)
+    {
+        KalmanModel<12, 4, Scalar> m;
+
+        for (unsigned int i=0; i<4; ++i) {
+            m.F[i][4+i] = dt;
+            m.F[i][8+i] = dt*dt/Scalar(2);
+            m.F[4+i][8+i] = dt;
+            m.H[i][i] = Scalar(1);
+            m.R[i][i] = measurementNoise;
+        }
+
+        for (unsigned int i=0; i<12; ++i)
+            m.Q[i][i] = processNoise;
+
+        return m;
+    }
+}
+
+#endif // KALMANFILTER_H
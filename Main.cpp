@@ -3,6 +3,8 @@
 #include "FaceDetector.h"
 #include "Image.h"
 #include "Tracker.h"
+#include "CascadeDetector.h"
+#include "Pipeline.h"
 #include <iostream>
 #include "opencv2/core/core.hpp"
 #include "opencv2/highgui/highgui.hpp"
@@ -41,9 +43,11 @@ int main(int argc, char* argv[])
 	//cascades.push_back(profileLeft);
 	//cascades.push_back(profileRight);
 	
-	cvip::Tracker t(new cvip::FaceDetector(cascades));
+	cvip::Tracker t(new cvip::CascadeDetector(new cvip::FaceDetector(cascades)));
 
-	t.onVideo();
+	cvip::Pipeline pipeline(t);
+	pipeline.run();
+	pipeline.report(std::cout);
 	
 	//d.on_single_image(std::string("D:/Training Data/Negatives/0004.png"),0,0,false);
 	//d.on_single_image(std::string("D:/Training Data/Positives/150.png"),0,0,false);
@@ -0,0 +1,226 @@
+#include "MotMetrics.h"
+#include <algorithm>
+
+using namespace cvip;
+
+// cost of a pair that may not be matched, far above any 1 - IoU
+static const double INVALID_COST = 1e6;
+
+/**
+ * Forget all frames.
+ *
+ * @return void
+ */
+void MotMetrics::clear()
+{
+    numTruth = numHyps = numMatches = numMisses = numFalsePositives = numSwitches = 0;
+    sumIou = 0.;
+
+    lastMatch.clear();
+    pairFrames.clear();
+}
+
+/**
+ * Intersection over union, 0 for empty rects.
+ *
+ * @return double
+ */
+double MotMetrics::iou(const DetectionRect& a, const DetectionRect& b)
+{
+    double inter = Rect::intersect(a, b);
+    double uni = (double)a.width*a.height + (double)b.width*b.height - inter;
+
+    return uni > 0 ? inter/uni : 0.;
+}
+
+/**
+ * Match the truth and hypothesis boxes of a frame and update the counts.
+ * Ids must be unique within a frame.
+ *
+ * @param  vector<MotBox>& truth
+ * @param  vector<MotBox>& hyps
+ * @return void
+ */
+void MotMetrics::addFrame(const std::vector<MotBox>& truth, const std::vector<MotBox>& hyps)
+{
+    uint nT = truth.size(), nH = hyps.size();
+
+    numTruth += nT;
+    numHyps += nH;
+
+    hypRects.resize(nH);
+    for (uint j=0; j<nH; ++j)
+        hypRects[j] = &hyps[j].rect;
+
+    grid.build(hypRects);
+
+    // candidate pairs, and identity counts of every matching pair
+    candStart.resize(nT+1);
+    candCol.clear();
+    candCost.clear();
+
+    for (uint i=0; i<nT; ++i)
+    {
+        candStart[i] = candCol.size();
+        grid.query(truth[i].rect, nearHyps);
+
+        for (uint k=0; k<nearHyps.size(); ++k)
+        {
+            double s = iou(truth[i].rect, hyps[nearHyps[k]].rect);
+
+            if (s < minIou)
+                continue;
+
+            candCol.push_back(nearHyps[k]);
+            candCost.push_back(1.-s);
+            ++pairFrames[std::make_pair(truth[i].id, hyps[nearHyps[k]].id)];
+        }
+    }
+    candStart[nT] = candCol.size();
+
+    // keep last frame's matches that still hold
+    truthMatch.assign(nT, -1);
+    hypTaken.assign(nH, 0);
+
+    for (uint i=0; i<nT; ++i)
+    {
+        std::map<int, int>::const_iterator it = lastMatch.find(truth[i].id);
+
+        if (it == lastMatch.end())
+            continue;
+
+        for (uint k=candStart[i]; k<candStart[i+1]; ++k)
+            if (hyps[candCol[k]].id == it->second && !hypTaken[candCol[k]])
+            {
+                truthMatch[i] = candCol[k];
+                hypTaken[candCol[k]] = 1;
+                break;
+            }
+    }
+
+    // match the rest optimally, on the candidates among free boxes only
+    freeTruth.clear();
+    for (uint i=0; i<nT; ++i)
+        if (truthMatch[i] < 0)
+            freeTruth.push_back(i);
+
+    freeHyps.clear();
+    hypLocal.assign(nH, -1);
+    for (uint j=0; j<nH; ++j)
+        if (!hypTaken[j]) {
+            hypLocal[j] = freeHyps.size();
+            freeHyps.push_back(j);
+        }
+
+    subStart.resize(freeTruth.size()+1);
+    subCol.clear();
+    subCost.clear();
+
+    for (uint r=0; r<freeTruth.size(); ++r)
+    {
+        uint i = freeTruth[r];
+        subStart[r] = subCol.size();
+
+        for (uint k=candStart[i]; k<candStart[i+1]; ++k)
+            if (hypLocal[candCol[k]] >= 0) {
+                subCol.push_back(hypLocal[candCol[k]]);
+                subCost.push_back(candCost[k]);
+            }
+    }
+    subStart[freeTruth.size()] = subCol.size();
+
+    solver.solve(freeTruth.size(), freeHyps.size(), subStart, subCol, subCost, INVALID_COST, assignment);
+
+    for (uint r=0; r<freeTruth.size(); ++r)
+        if (assignment[r] >= 0)
+            truthMatch[freeTruth[r]] = freeHyps[assignment[r]];
+
+    // count
+    uint frameMatches = 0;
+
+    for (uint i=0; i<nT; ++i)
+    {
+        if (truthMatch[i] < 0) {
+            ++numMisses;
+            continue;
+        }
+
+        const MotBox& h = hyps[truthMatch[i]];
+
+        ++frameMatches;
+        sumIou += iou(truth[i].rect, h.rect);
+
+        std::map<int, int>::iterator it = lastMatch.find(truth[i].id);
+
+        if (it == lastMatch.end()) {
+            lastMatch.insert(std::make_pair(truth[i].id, h.id));
+        } else if (it->second != h.id) {
+            ++numSwitches;
+            it->second = h.id;
+        }
+    }
+
+    numMatches += frameMatches;
+    numFalsePositives += nH - frameMatches;
+}
+
+/**
+ * CLEAR MOT and identity figures of all frames so far. The identity
+ * binding of truth to hypothesis ids is solved here, as a maximum
+ * weight matching where the weight of a pair is the number of frames
+ * it matches.
+ *
+ * @return Summary
+ */
+MotMetrics::Summary MotMetrics::summary()
+{
+    Summary s;
+    s.numTruth = numTruth;
+    s.numHyps = numHyps;
+    s.numMatches = numMatches;
+    s.numMisses = numMisses;
+    s.numFalsePositives = numFalsePositives;
+    s.numSwitches = numSwitches;
+    s.mota = numTruth ? 1. - (double)(numMisses + numFalsePositives + numSwitches)/numTruth : 0.;
+    s.motp = numMatches ? sumIou/numMatches : 0.;
+
+    // index ids, pairFrames is sorted by truth id already
+    std::map<int, uint> truthIdx, hypIdx;
+    typedef std::map<std::pair<int, int>, unsigned long>::const_iterator PairIter;
+
+    for (PairIter it=pairFrames.begin(); it != pairFrames.end(); ++it)
+    {
+        truthIdx.insert(std::make_pair(it->first.first, (uint)truthIdx.size()));
+        hypIdx.insert(std::make_pair(it->first.second, (uint)hypIdx.size()));
+    }
+
+    subStart.assign(truthIdx.size()+1, 0);
+    subCol.clear();
+    subCost.clear();
+
+    for (PairIter it=pairFrames.begin(); it != pairFrames.end(); ++it)
+    {
+        ++subStart[truthIdx[it->first.first]+1];
+        subCol.push_back(hypIdx[it->first.second]);
+        subCost.push_back(-(double)it->second);
+    }
+
+    for (uint r=0; r<truthIdx.size(); ++r)
+        subStart[r+1] += subStart[r];
+
+    // a missing pair costs as much as leaving both ids unbound
+    solver.solve(truthIdx.size(), hypIdx.size(), subStart, subCol, subCost, 0., assignment);
+
+    double idtp = 0.;
+
+    for (uint r=0; r<truthIdx.size(); ++r)
+        for (uint k=subStart[r]; k<subStart[r+1]; ++k)
+            if (assignment[r] == (int)subCol[k])
+                idtp -= subCost[k];
+
+    s.idPrecision = numHyps ? idtp/numHyps : 0.;
+    s.idRecall = numTruth ? idtp/numTruth : 0.;
+    s.idf1 = numTruth+numHyps ? 2.*idtp/(numTruth+numHyps) : 0.;
+
+    return s;
+}
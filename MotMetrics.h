@@ -0,0 +1,77 @@
+#ifndef MOTMETRICS_H
+#define MOTMETRICS_H
+
+#include "MotSequence.h"
+#include "SpatialGrid.h"
+#include "AssignmentSolver.h"
+#include <map>
+#include <vector>
+
+namespace cvip
+{
+    /**
+     * Tracking accuracy of a hypothesis (tracker output) sequence against
+     * ground truth, frame by frame:
+     * - CLEAR MOT: truth/hypothesis boxes are matched per frame with
+     *   IoU >= minIou, keeping the matches of the previous frame when
+     *   they still hold; misses, false positives and id switches give
+     *   MOTA = 1 - (misses + false positives + switches) / truth boxes.
+     * - Identity: every truth id is bound to at most one hypothesis id
+     *   for the whole sequence so that the number of frames they match
+     *   is maximal, which gives IDP, IDR and IDF1.
+     *
+     * @author evangelos sariyanidi / sariyanidi[at]gmail[dot]com
+     * @date april 2011
+     */
+    class MotMetrics
+    {
+    public:
+        //! accuracy figures, see summary()
+        struct Summary
+        {
+            unsigned long numTruth, numHyps;
+            unsigned long numMatches, numMisses, numFalsePositives, numSwitches;
+            double mota, motp;
+            double idPrecision, idRecall, idf1;
+        };
+
+        MotMetrics(double _minIou = 0.5) : minIou(_minIou) { clear(); }
+
+        // account for one frame
+        void addFrame(const std::vector<MotBox>& truth, const std::vector<MotBox>& hyps);
+
+        // figures of all frames so far
+        Summary summary();
+
+        void clear();
+
+        // intersection over union of two rects
+        static double iou(const DetectionRect& a, const DetectionRect& b);
+
+    private:
+        //! @property a truth and a hypothesis box match at this IoU or above
+        double minIou;
+
+        //! @property CLEAR MOT counts
+        unsigned long numTruth, numHyps, numMatches, numMisses, numFalsePositives, numSwitches;
+        double sumIou;
+
+        //! @property hypothesis id last matched to each truth id
+        std::map<int, int> lastMatch;
+
+        //! @property frames each truth/hypothesis pair matches
+        std::map<std::pair<int, int>, unsigned long> pairFrames;
+
+        //! @property per-frame buffers
+        cvip::SpatialGrid grid;
+        cvip::AssignmentSolver solver;
+        std::vector<const DetectionRect*> hypRects;
+        std::vector<uint> nearHyps, candStart, candCol, subStart, subCol;
+        std::vector<double> candCost, subCost;
+        std::vector<int> truthMatch, freeTruth, freeHyps, hypLocal;
+        std::vector<char> hypTaken;
+        std::vector<int> assignment;
+    };
+}
+
+#endif // MOTMETRICS_H
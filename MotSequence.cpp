@@ -0,0 +1,182 @@
+#include "MotSequence.h"
+#include <fstream>
+#include <sstream>
+#include <cstring>
+
+using namespace cvip;
+
+// header of the binary form, followed by the number of boxes (int32)
+static const char BINARY_MAGIC[8] = { 'M', 'O', 'T', 'B', 'I', 'N', '0', '1' };
+
+// one box of the binary form
+struct BinaryBox
+{
+    int frame, id;
+    float left, top, width, height, conf;
+};
+
+/**
+ * Read a MOT file, text or binary. Previous content is dropped.
+ *
+ * @param  string& path
+ * @return bool - false if the file can't be read
+ */
+bool MotSequence::load(const std::string& path)
+{
+    std::ifstream in(path.c_str(), std::ios::binary);
+    char magic[sizeof(BINARY_MAGIC)];
+
+    if (!in)
+        return false;
+
+    clear();
+
+    if (in.read(magic, sizeof(magic)) && !memcmp(magic, BINARY_MAGIC, sizeof(magic)))
+        return loadBinary(path);
+
+    return loadText(path);
+}
+
+/**
+ * Read the text form. Lines that don't parse (headers, comments) are
+ * skipped; fields may be separated by commas or spaces.
+ *
+ * @return bool
+ */
+bool MotSequence::loadText(const std::string& path)
+{
+    std::ifstream in(path.c_str());
+    std::string line;
+
+    if (!in)
+        return false;
+
+    while (std::getline(in, line))
+    {
+        for (uint i=0; i<line.size(); ++i)
+            if (line[i] == ',')
+                line[i] = ' ';
+
+        std::istringstream ss(line);
+        int f, id;
+        float left, top, width, height, conf = 1.f;
+
+        if (!(ss >> f >> id >> left >> top >> width >> height) || f < 1)
+            continue;
+
+        ss >> conf;
+
+        MotBox b;
+        b.id = id;
+        b.rect = DetectionRect(cvip::round(left), cvip::round(top), cvip::round(width), cvip::round(height));
+        b.conf = conf;
+
+        add(f-1, b);
+    }
+
+    return true;
+}
+
+/**
+ * Read the binary form, see save().
+ *
+ * @return bool
+ */
+bool MotSequence::loadBinary(const std::string& path)
+{
+    std::ifstream in(path.c_str(), std::ios::binary);
+    int numBoxes;
+
+    in.seekg(sizeof(BINARY_MAGIC));
+
+    if (!in.read((char*)&numBoxes, sizeof(numBoxes)) || numBoxes < 0)
+        return false;
+
+    std::vector<BinaryBox> boxes(numBoxes);
+
+    if (numBoxes > 0 && !in.read((char*)&boxes[0], numBoxes*sizeof(BinaryBox)))
+        return false;
+
+    for (int i=0; i<numBoxes; ++i)
+    {
+        const BinaryBox& bb = boxes[i];
+
+        if (bb.frame < 1)
+            continue;
+
+        MotBox b;
+        b.id = bb.id;
+        b.rect = DetectionRect(cvip::round(bb.left), cvip::round(bb.top), cvip::round(bb.width), cvip::round(bb.height));
+        b.conf = bb.conf;
+
+        add(bb.frame-1, b);
+    }
+
+    return true;
+}
+
+/**
+ * Write in binary form: BINARY_MAGIC, number of boxes, then the boxes
+ * as BinaryBox records in host byte order.
+ *
+ * @param  string& path
+ * @return bool
+ */
+bool MotSequence::save(const std::string& path) const
+{
+    std::ofstream out(path.c_str(), std::ios::binary);
+
+    if (!out)
+        return false;
+
+    std::vector<BinaryBox> boxes;
+
+    for (uint f=0; f<frames.size(); ++f)
+        for (uint i=0; i<frames[f].size(); ++i)
+        {
+            const MotBox& b = frames[f][i];
+            BinaryBox bb = { (int)f+1, b.id, (float)b.rect.x1, (float)b.rect.y1,
+                             (float)b.rect.width, (float)b.rect.height, b.conf };
+            boxes.push_back(bb);
+        }
+
+    int numBoxes = boxes.size();
+
+    out.write(BINARY_MAGIC, sizeof(BINARY_MAGIC));
+    out.write((const char*)&numBoxes, sizeof(numBoxes));
+
+    if (numBoxes > 0)
+        out.write((const char*)&boxes[0], numBoxes*sizeof(BinaryBox));
+
+    return (bool)out;
+}
+
+/**
+ * Append a box to a frame.
+ *
+ * @param  uint f - 0-based frame index
+ * @param  MotBox& b
+ * @return void
+ */
+void MotSequence::add(uint f, const MotBox& b)
+{
+    if (f >= frames.size())
+        frames.resize(f+1);
+
+    frames[f].push_back(b);
+}
+
+/**
+ * Rects of the boxes of a frame.
+ *
+ * @param  uint f
+ * @param  vector<DetectionRect>& out
+ * @return void
+ */
+void MotSequence::detections(uint f, std::vector<DetectionRect>& out) const
+{
+    out.clear();
+
+    for (uint i=0; i<frames[f].size(); ++i)
+        out.push_back(frames[f][i].rect);
+}
@@ -0,0 +1,61 @@
+#ifndef MOTSEQUENCE_H
+#define MOTSEQUENCE_H
+
+#include "FaceDetector.h"
+#include <string>
+#include <vector>
+
+namespace cvip
+{
+    //! a box of a MOT file: detection (id -1) or ground truth
+    struct MotBox
+    {
+        int id;
+        cvip::DetectionRect rect;
+        float conf;
+    };
+
+    /**
+     * Boxes of a recorded sequence, frame by frame, in the format of the
+     * MOT Challenge: one box per line,
+     *     frame, id, left, top, width, height, conf[, ...]
+     * with 1-based frame numbers and id -1 for detections. Extra columns
+     * are ignored. The same data can be saved in a binary form that
+     * loads much faster, load() tells the two apart by their header.
+     *
+     * @author evangelos sariyanidi / sariyanidi[at]gmail[dot]com
+     * @date april 2011
+     */
+    class MotSequence
+    {
+    public:
+        // read a text or binary MOT file, false on failure
+        bool load(const std::string& path);
+
+        // write in binary form, false on failure
+        bool save(const std::string& path) const;
+
+        // append a box to frame f (0-based), frames up to f are created
+        void add(uint f, const MotBox& b);
+
+        void clear() { frames.clear(); }
+
+        // set the number of frames, new frames are empty
+        void resize(uint numFrames) { frames.resize(numFrames); }
+
+        uint numFrames() const { return frames.size(); }
+        const std::vector<MotBox>& frame(uint f) const { return frames[f]; }
+
+        // boxes of frame f as DetectionRects, the input of Tracker::update()
+        void detections(uint f, std::vector<DetectionRect>& out) const;
+
+    private:
+        bool loadText(const std::string& path);
+        bool loadBinary(const std::string& path);
+
+        //! @property boxes of each frame, 0-based
+        std::vector< std::vector<MotBox> > frames;
+    };
+}
+
+#endif // MOTSEQUENCE_H
@@ -0,0 +1,88 @@
+#ifndef MOTIONMODEL_H
+#define MOTIONMODEL_H
+
+#include <string>
+
+namespace cvip
+{
+    /**
+     * Motion model of the track filters (see KalmanBank) and its
+     * parameters; each Tracker (i.e. stream) has its own.
+     *
+     * All models measure 4 coordinates of the detection rect and keep,
+     * per coordinate, the position and 1 or 2 derivatives. Noise
+     * matrices are diagonal, thus the coordinates never interact and
+     * the filters stay as cheap as the original corner model.
+     *
+     * dt is the nominal frame interval: it is used when frames come
+     * without timestamps, and the process noise is given per nominal
+     * frame, i.e. it is scaled by actual dt / nominal dt. Intervals
+     * within dtTolerance of dt are taken as dt: timestamps of a live
+     * source jitter by milliseconds (scheduling, clock resolution), and
+     * this keeps such frames nominal for the steady-state gain (see
+     * KalmanBank::setSteadyState()). Raise it for fast streams with a
+     * coarse clock.
+     *
+     * @author evangelos sariyanidi / sariyanidi[at]gmail[dot]com
+     * @date april 2011
+     */
+    struct MotionModel
+    {
+        //! registered models
+        enum Kind
+        {
+            CORNER_VELOCITY,        //! corners x1,y1,x2,y2, constant velocity (the original model)
+            CENTER_SCALE_VELOCITY,  //! center cx,cy, aspect w/h and height, constant velocity
+            CORNER_ACCELERATION,    //! corners, constant acceleration
+            NUM_KINDS
+        };
+
+        MotionModel(Kind _kind = CORNER_VELOCITY, float _dt = 0.067f, float _processNoise = 1e-2f,
+                    float _measurementNoise = 1e-1f, float _maxDt = 1.f, float _dtTolerance = 0.05f)
+            : kind(_kind), dt(_dt), processNoise(_processNoise),
+            measurementNoise(_measurementNoise), maxDt(_maxDt), dtTolerance(_dtTolerance) {}
+
+        Kind kind;
+
+        //! nominal time between two frames in secs.
+        float dt;
+
+        //! diagonal coeffs of processNoiseCov, per nominal frame
+        float processNoise;
+
+        //! diagonal coeffs of measurementNoiseCov
+        float measurementNoise;
+
+        //! timestamp gaps are cut to this many secs., e.g. after a stall
+        float maxDt;
+
+        //! frame intervals within this fraction of dt count as nominal
+        float dtTolerance;
+
+        // position and derivatives kept per coordinate: 2 or 3
+        unsigned int order() const { return kind == CORNER_ACCELERATION ? 3 : 2; }
+
+        // are the coordinates center, aspect and height rather than corners?
+        bool centered() const { return kind == CENTER_SCALE_VELOCITY; }
+
+        // registry: name of a model and model of a name
+        static const char* name(Kind k)
+        {
+            static const char* names[NUM_KINDS] = { "corner-cv", "center-cv", "corner-ca" };
+            return names[k];
+        }
+
+        static bool parse(const std::string& s, Kind& k)
+        {
+            for (unsigned int i=0; i<NUM_KINDS; ++i)
+                if (s == name((Kind)i)) {
+                    k = (Kind)i;
+                    return true;
+                }
+
+            return false;
+        }
+    };
+}
+
+#endif // MOTIONMODEL_H
@@ -0,0 +1,88 @@
+#ifndef OBJECTPOOL_H
+#define OBJECTPOOL_H
+
+#include <vector>
+#include <new>
+
+namespace cvip
+{
+    /**
+     * Storage for objects of type T, handed out from blocks of blockSize
+     * objects. Released storage goes to a free list and is reused first,
+     * thus once the number of live objects settles nothing is allocated.
+     *
+     * Construct with placement new on allocate(), destroy with release():
+     *     T* t = new (pool.allocate()) T(...);
+     *     pool.release(t);
+     *
+     * @author evangelos sariyanidi / sariyanidi[at]gmail[dot]com
+     * @date april 2011
+     */
+    template <typename T>
+    class ObjectPool
+    {
+    public:
+        ObjectPool(unsigned int _blockSize = 64) : blockSize(_blockSize ? _blockSize : 1) {}
+
+        // all objects must be released before
+        ~ObjectPool()
+        {
+            for (unsigned int i=0; i<blocks.size(); ++i)
+                ::operator delete(blocks[i]);
+        }
+
+        // raw storage for one T
+        void* allocate()
+        {
+            if (freeList.empty())
+                grow();
+
+            void* p = freeList.back();
+            freeList.pop_back();
+
+            return p;
+        }
+
+        // storage for n objects in all, allocate() takes no more until then
+        void reserve(unsigned int n)
+        {
+            while (blocks.size()*blockSize < n)
+                grow();
+        }
+
+        // destroy t and keep its storage
+        void release(T* t)
+        {
+            t->~T();
+            freeList.push_back(t);
+        }
+
+    private:
+        // add a block to the free list
+        void grow()
+        {
+            char* block = static_cast<char*>(::operator new(sizeof(T)*blockSize));
+            blocks.push_back(block);
+
+            freeList.reserve(blocks.size()*blockSize);
+
+            // push backwards, so storage is handed out in address order
+            for (unsigned int i=blockSize; i>0; --i)
+                freeList.push_back(block + (i-1)*sizeof(T));
+        }
+
+        // not copyable
+        ObjectPool(const ObjectPool&);
+        ObjectPool& operator=(const ObjectPool&);
+
+        const unsigned int blockSize;
+
+        //! @property storage blocks, each holds blockSize objects
+        std::vector<char*> blocks;
+
+        //! @property storage not in use
+        std::vector<void*> freeList;
+    };
+}
+
+#endif // OBJECTPOOL_H
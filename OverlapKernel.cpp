@@ -0,0 +1,300 @@
+#include "OverlapKernel.h"
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+// every variant is compiled, the cpu picks one at runtime
+#include <immintrin.h>
+#define WITH_SSE
+#define WITH_AVX
+#define TARGET_SSE __attribute__((target("sse2")))
+#define TARGET_AVX __attribute__((target("avx")))
+#define RUNTIME_DISPATCH
+#else
+// only what the compiler targets
+#if defined(__AVX__)
+#include <immintrin.h>
+#define WITH_AVX
+#endif
+#if defined(__AVX__) || defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define WITH_SSE
+#endif
+#define TARGET_SSE
+#define TARGET_AVX
+#endif
+
+using namespace cvip;
+
+static const char* ISA_NAMES[] = { "scalar", "sse", "avx" };
+
+/**
+ * Score of one pair: intersection over the smaller area or over the
+ * union. The denominator is kept >= 1 so that empty rects score 0.
+ *
+ * @return float
+ */
+static inline float scorePair(float ax1, float ay1, float ax2, float ay2, float aArea,
+                              float bx1, float by1, float bx2, float by2, float bArea, bool iou)
+{
+    float w = std::max(std::min(ax2, bx2) - std::max(ax1, bx1), 0.f);
+    float h = std::max(std::min(ay2, by2) - std::max(ay1, by1), 0.f);
+    float inter = w*h;
+    float den = iou ? aArea + bArea - inter : std::min(aArea, bArea);
+
+    return inter/std::max(den, 1.f);
+}
+
+static void rowScalar(const OverlapKernel::Boxes& a, uint i, const OverlapKernel::Boxes& b, bool iou, float* out)
+{
+    for (uint j=0; j<b.padded(); ++j)
+        out[j] = scorePair(a.x1[i], a.y1[i], a.x2[i], a.y2[i], a.area[i],
+                           b.x1[j], b.y1[j], b.x2[j], b.y2[j], b.area[j], iou);
+}
+
+#ifdef WITH_SSE
+TARGET_SSE static void rowSse(const OverlapKernel::Boxes& a, uint i, const OverlapKernel::Boxes& b, bool iou, float* out)
+{
+    const __m128 ax1 = _mm_set1_ps(a.x1[i]), ay1 = _mm_set1_ps(a.y1[i]);
+    const __m128 ax2 = _mm_set1_ps(a.x2[i]), ay2 = _mm_set1_ps(a.y2[i]);
+    const __m128 aArea = _mm_set1_ps(a.area[i]);
+    const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.f);
+
+    for (uint j=0; j<b.padded(); j+=4)
+    {
+        __m128 w = _mm_sub_ps(_mm_min_ps(ax2, _mm_loadu_ps(&b.x2[j])), _mm_max_ps(ax1, _mm_loadu_ps(&b.x1[j])));
+        __m128 h = _mm_sub_ps(_mm_min_ps(ay2, _mm_loadu_ps(&b.y2[j])), _mm_max_ps(ay1, _mm_loadu_ps(&b.y1[j])));
+        __m128 inter = _mm_mul_ps(_mm_max_ps(w, zero), _mm_max_ps(h, zero));
+
+        __m128 bArea = _mm_loadu_ps(&b.area[j]);
+        __m128 den = iou ? _mm_sub_ps(_mm_add_ps(aArea, bArea), inter) : _mm_min_ps(aArea, bArea);
+
+        _mm_storeu_ps(out+j, _mm_div_ps(inter, _mm_max_ps(den, one)));
+    }
+}
+#endif
+
+#ifdef WITH_AVX
+TARGET_AVX static void rowAvx(const OverlapKernel::Boxes& a, uint i, const OverlapKernel::Boxes& b, bool iou, float* out)
+{
+    const __m256 ax1 = _mm256_set1_ps(a.x1[i]), ay1 = _mm256_set1_ps(a.y1[i]);
+    const __m256 ax2 = _mm256_set1_ps(a.x2[i]), ay2 = _mm256_set1_ps(a.y2[i]);
+    const __m256 aArea = _mm256_set1_ps(a.area[i]);
+    const __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.f);
+
+    for (uint j=0; j<b.padded(); j+=8)
+    {
+        __m256 w = _mm256_sub_ps(_mm256_min_ps(ax2, _mm256_loadu_ps(&b.x2[j])), _mm256_max_ps(ax1, _mm256_loadu_ps(&b.x1[j])));
+        __m256 h = _mm256_sub_ps(_mm256_min_ps(ay2, _mm256_loadu_ps(&b.y2[j])), _mm256_max_ps(ay1, _mm256_loadu_ps(&b.y1[j])));
+        __m256 inter = _mm256_mul_ps(_mm256_max_ps(w, zero), _mm256_max_ps(h, zero));
+
+        __m256 bArea = _mm256_loadu_ps(&b.area[j]);
+        __m256 den = iou ? _mm256_sub_ps(_mm256_add_ps(aArea, bArea), inter) : _mm256_min_ps(aArea, bArea);
+
+        _mm256_storeu_ps(out+j, _mm256_div_ps(inter, _mm256_max_ps(den, one)));
+    }
+}
+#endif
+
+/**
+ * Copy rects, padding included.
+ *
+ * @param  DetectionRect* rects
+ * @param  uint n
+ * @return void
+ */
+void OverlapKernel::Boxes::assign(const DetectionRect* rects, uint n)
+{
+    resize(n);
+
+    for (uint i=0; i<count; ++i)
+        set(i, rects[i]);
+}
+
+/**
+ * Copy rects, padding included.
+ *
+ * @param  vector<const DetectionRect*>& rects
+ * @return void
+ */
+void OverlapKernel::Boxes::assign(const std::vector<const DetectionRect*>& rects)
+{
+    resize(rects.size());
+
+    for (uint i=0; i<count; ++i)
+        set(i, *rects[i]);
+}
+
+void OverlapKernel::Boxes::resize(uint n)
+{
+    uint padded = (n+PAD-1)/PAD*PAD;
+
+    count = n;
+    x1.assign(padded, 0.f);
+    y1.assign(padded, 0.f);
+    x2.assign(padded, 0.f);
+    y2.assign(padded, 0.f);
+    area.assign(padded, 0.f);
+}
+
+void OverlapKernel::Boxes::reserve(uint n)
+{
+    uint padded = (n+PAD-1)/PAD*PAD;
+
+    x1.reserve(padded);
+    y1.reserve(padded);
+    x2.reserve(padded);
+    y2.reserve(padded);
+    area.reserve(padded);
+}
+
+void OverlapKernel::Boxes::set(uint i, const DetectionRect& r)
+{
+    x1[i] = (float)r.x1;
+    y1[i] = (float)r.y1;
+    x2[i] = (float)r.x2;
+    y2[i] = (float)r.y2;
+    area[i] = (float)r.width*r.height;
+}
+
+/**
+ * Best instruction set that both the build and the cpu support.
+ *
+ * @return Isa
+ */
+OverlapKernel::Isa OverlapKernel::bestIsa()
+{
+#if defined(RUNTIME_DISPATCH)
+    if (__builtin_cpu_supports("avx"))
+        return AVX;
+    if (__builtin_cpu_supports("sse2"))
+        return SSE;
+    return SCALAR;
+#elif defined(WITH_AVX)
+    return AVX;
+#elif defined(WITH_SSE)
+    return SSE;
+#else
+    return SCALAR;
+#endif
+}
+
+/**
+ * Force an instruction set, e.g. to compare them. One that is not
+ * supported falls back to the best supported one.
+ *
+ * @param  Isa _isa
+ * @return void
+ */
+void OverlapKernel::setIsa(Isa _isa)
+{
+    isa = std::min(_isa, bestIsa());
+}
+
+const char* OverlapKernel::isaName(Isa _isa)
+{
+    return ISA_NAMES[_isa];
+}
+
+/**
+ * Scores of a's rect i against every rect of b, padding included.
+ *
+ * @param  Boxes& a
+ * @param  uint i
+ * @param  Boxes& b
+ * @param  float* out - b.padded() scores
+ * @return void
+ */
+void OverlapKernel::row(const Boxes& a, uint i, const Boxes& b, float* out) const
+{
+    bool iou = score == IOU;
+
+    switch (isa)
+    {
+#ifdef WITH_AVX
+    case AVX:
+        rowAvx(a, i, b, iou, out);
+        break;
+#endif
+#ifdef WITH_SSE
+    case SSE:
+        rowSse(a, i, b, iou, out);
+        break;
+#endif
+    default:
+        rowScalar(a, i, b, iou, out);
+    }
+}
+
+/**
+ * Scores of all pairs; out[i*b.count + j] is the score of a's rect i
+ * and b's rect j.
+ *
+ * @param  Boxes& a
+ * @param  Boxes& b
+ * @param  vector<float>& out
+ * @return void
+ */
+void OverlapKernel::matrix(const Boxes& a, const Boxes& b, std::vector<float>& out)
+{
+    out.resize((size_t)a.count*b.count);
+    rowScores.resize(b.padded());
+
+    for (uint i=0; i<a.count; ++i)
+    {
+        row(a, i, b, rowScores.empty() ? 0 : &rowScores[0]);
+        std::copy(rowScores.begin(), rowScores.begin()+b.count, out.begin()+(size_t)i*b.count);
+    }
+}
+
+/**
+ * Pairs scoring above minScore, as a sparse list: the rects of b that
+ * a's rect i scores above minScore are col[start[i]..start[i+1]), in
+ * ascending order, and their scores are scores[start[i]..start[i+1]).
+ *
+ * @param  Boxes& a
+ * @param  Boxes& b
+ * @param  float minScore
+ * @param  vector<uint>& start - output, a.count+1 offsets
+ * @param  vector<uint>& col - output
+ * @param  vector<float>& scores - output
+ * @return void
+ */
+void OverlapKernel::candidates(const Boxes& a, const Boxes& b, float minScore,
+                               std::vector<uint>& start, std::vector<uint>& col, std::vector<float>& scores)
+{
+    start.resize(a.count+1);
+    col.clear();
+    scores.clear();
+    rowScores.resize(b.padded());
+
+    for (uint i=0; i<a.count; ++i)
+    {
+        start[i] = col.size();
+
+        if (b.count == 0)
+            continue;
+
+        row(a, i, b, &rowScores[0]);
+
+        for (uint j=0; j<b.count; ++j)
+        {
+            if (rowScores[j] > minScore) {
+                col.push_back(j);
+                scores.push_back(rowScores[j]);
+            }
+        }
+    }
+
+    start[a.count] = col.size();
+}
+
+/**
+ * Score of a's rect i and b's rect j, the same as row() gives.
+ *
+ * @return float
+ */
+float OverlapKernel::pair(const Boxes& a, uint i, const Boxes& b, uint j) const
+{
+    return scorePair(a.x1[i], a.y1[i], a.x2[i], a.y2[i], a.area[i],
+                     b.x1[j], b.y1[j], b.x2[j], b.y2[j], b.area[j], score == IOU);
+}
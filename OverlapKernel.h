@@ -0,0 +1,112 @@
+#ifndef OVERLAPKERNEL_H
+#define OVERLAPKERNEL_H
+
+#include "FaceDetector.h"
+#include <vector>
+
+namespace cvip
+{
+    /**
+     * Overlap scores of many rectangle pairs at once. Rectangles are
+     * copied into padded SoA arrays (Boxes) and one rectangle is scored
+     * against a whole array per pass, 8 (AVX) or 4 (SSE) pairs at a time.
+     * The instruction set is picked at runtime from what the cpu
+     * supports, so one binary runs everywhere; setIsa() forces another.
+     *
+     * Intersections follow Rect::intersect (corners x1,y1 inclusive,
+     * x2,y2 exclusive) and areas are width*height, so scores equal those
+     * of the scalar path up to float rounding.
+     *
+     * @author evangelos sariyanidi / sariyanidi[at]gmail[dot]com
+     * @date april 2011
+     */
+    class OverlapKernel
+    {
+    public:
+        //! instruction sets
+        enum Isa
+        {
+            SCALAR,
+            SSE,
+            AVX
+        };
+
+        //! scores
+        enum Score
+        {
+            OVERLAP,    //! intersection over the smaller area, see Associator::overlap()
+            IOU         //! intersection over union
+        };
+
+        //! arrays are padded with empty rects to a multiple of this
+        static const uint PAD = 8;
+
+        /**
+         * Rectangles as SoA. Padding rects score 0 against anything.
+         */
+        struct Boxes
+        {
+            std::vector<float> x1, y1, x2, y2, area;
+
+            //! number of rects, without the padding
+            uint count;
+
+            Boxes() : count(0) {}
+
+            void assign(const cvip::DetectionRect* rects, uint n);
+            void assign(const std::vector<cvip::DetectionRect>& rects) { assign(rects.empty() ? 0 : &rects[0], rects.size()); }
+            void assign(const std::vector<const cvip::DetectionRect*>& rects);
+
+            uint padded() const { return x1.size(); }
+
+            // room for n rects
+            void reserve(uint n);
+
+        private:
+            void resize(uint n);
+            void set(uint i, const cvip::DetectionRect& r);
+        };
+
+        OverlapKernel(Score _score = OVERLAP) : score(_score), isa(bestIsa()) {}
+
+        void setScore(Score _score) { score = _score; }
+        Score getScore() const { return score; }
+
+        // force an instruction set, one the cpu lacks falls back to the best supported
+        void setIsa(Isa _isa);
+        Isa getIsa() const { return isa; }
+
+        // best instruction set of this cpu
+        static Isa bestIsa();
+        static const char* isaName(Isa _isa);
+
+        // scores of a's rect i against all of b, out must hold b.padded() floats
+        void row(const Boxes& a, uint i, const Boxes& b, float* out) const;
+
+        // a.count x b.count scores, row major
+        void matrix(const Boxes& a, const Boxes& b, std::vector<float>& out);
+
+        // pairs scoring above minScore: for a's rect i, start[i]..start[i+1]
+        // index col (ascending) and scores
+        void candidates(const Boxes& a, const Boxes& b, float minScore,
+                        std::vector<uint>& start, std::vector<uint>& col, std::vector<float>& scores);
+
+        // score of a single pair
+        float pair(const Boxes& a, uint i, const Boxes& b, uint j) const;
+
+        // room for candidates() against n rects
+        void reserve(uint n) { rowScores.reserve((n+PAD-1)/PAD*PAD); }
+
+    private:
+        //! @property selected score
+        Score score;
+
+        //! @property selected instruction set
+        Isa isa;
+
+        //! @property scores of one row, for candidates()
+        std::vector<float> rowScores;
+    };
+}
+
+#endif // OVERLAPKERNEL_H
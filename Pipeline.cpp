@@ -0,0 +1,410 @@
+#include "Pipeline.h"
+#include "opencv2/highgui/highgui.hpp"
+#include <sstream>
+
+using namespace cvip;
+
+static const char* STAGE_NAMES[Pipeline::NUM_STAGES] =
+    { "capture", "scale space", "detect", "track", "render" };
+
+/**
+ * Constructor
+ * A cascade detector gets its scale spaces built in a stage of their
+ * own, other detectors run on the frame in the detect stage.
+ *
+ * @param  Tracker& _tracker - run on the calling thread of run() only
+ * @param  Config& _config
+ */
+Pipeline::Pipeline(Tracker& _tracker, const Config& _config)
+    : tracker(_tracker), config(_config), cascade(dynamic_cast<CascadeDetector*>(_tracker.getDetector()))
+{
+}
+
+/**
+ * Destructor
+ * Delete the pooled scale spaces.
+ */
+Pipeline::~Pipeline()
+{
+    for (uint i=0; i<freeScales.size(); ++i)
+        delete freeScales[i];
+}
+
+/**
+ * Run all stages until a key is pressed on a window or the capture
+ * device stops giving frames. Stage timings are reset at start.
+ *
+ * @return void
+ */
+void Pipeline::run()
+{
+    for (uint s=0; s<NUM_STAGES; ++s)
+    {
+        numFrames[s] = numDropped[s] = 0;
+        sumTime[s] = maxTime[s] = 0.;
+    }
+
+    quit = false;
+    detectNext = true;
+    nextRois.clear();
+
+    Queue toScale(config.queueDepth[CAPTURE]);
+    Queue toDetect(config.queueDepth[SCALE_SPACE]);
+    Queue toTrack(config.queueDepth[DETECT]);
+    Queue toRender(config.queueDepth[TRACK]);
+
+    std::thread tCapture(&Pipeline::capture, this, std::ref(toScale));
+    std::thread tScale(&Pipeline::buildScaleSpace, this, std::ref(toScale), std::ref(toDetect));
+    std::thread tDetect(&Pipeline::detect, this, std::ref(toDetect), std::ref(toTrack));
+    std::thread tTrack(&Pipeline::track, this, std::ref(toTrack), std::ref(toRender));
+
+    // highgui must be driven from this thread
+    render(toRender);
+
+    tCapture.join();
+    tScale.join();
+    tDetect.join();
+    tTrack.join();
+}
+
+/**
+ * Grab frames from the capture device.
+ *
+ * @return void
+ */
+void Pipeline::capture(Queue& out)
+{
+    cv::VideoCapture cap(config.device);
+
+    if (cap.isOpened())
+    {
+        cap.set(CV_CAP_PROP_FRAME_WIDTH, config.width);
+        cap.set(CV_CAP_PROP_FRAME_HEIGHT, config.height);
+
+        cv::Mat frame;
+        unsigned long index = 0;
+
+        while (!quit)
+        {
+            int64 t = cv::getTickCount();
+
+            cap >> frame;
+            if (frame.empty())
+                break;
+
+            // stamped once grabbed: the wait for the device is not part of the frame interval
+            int64 tGrab = cv::getTickCount();
+
+            // the device reuses its buffer, keep our own copy
+            Packet p;
+            p.index = index++;
+            p.time = tGrab/cv::getTickFrequency();
+            p.frame = frame.clone();
+
+            record(CAPTURE, t);
+            forward(out, p, SCALE_SPACE);
+        }
+    }
+
+    // a closed queue stops the next stages in turn
+    out.close();
+}
+
+/**
+ * Build the detector's scale space of each frame.
+ *
+ * @return void
+ */
+void Pipeline::buildScaleSpace(Queue& in, Queue& out)
+{
+    Packet p;
+
+    while (in.pop(p))
+    {
+        if (quit) {
+            release(p);
+            continue;
+        }
+
+        p.detected = detectNext;
+
+        if (p.detected)
+        {
+            std::lock_guard<std::mutex> lk(roiLock);
+            p.rois = nextRois;
+        }
+
+        // only the cascade detector is split in two stages
+        if (p.detected && cascade)
+        {
+            int64 t = cv::getTickCount();
+            p.scales = takeScaleSpace();
+
+            cascade->scaleSpace(p.frame, p.rois, *p.scales);
+            record(SCALE_SPACE, t);
+        }
+
+        forward(out, p, DETECT);
+    }
+
+    out.close();
+}
+
+/**
+ * Run the detector on each scale space, then give it back to the pool;
+ * detectors without a scale space stage take the frame.
+ *
+ * @return void
+ */
+void Pipeline::detect(Queue& in, Queue& out)
+{
+    Packet p;
+
+    while (in.pop(p))
+    {
+        if (quit) {
+            release(p);
+            continue;
+        }
+
+        if (p.detected)
+        {
+            int64 t = cv::getTickCount();
+
+            if (p.scales)
+                p.detections = cascade->detect(*p.scales);
+            else
+                p.detections = tracker.detect(p.frame, p.rois);
+
+            release(p);
+            record(DETECT, t);
+        }
+
+        forward(out, p, TRACK);
+    }
+
+    out.close();
+}
+
+/**
+ * Update the tracker with each frame's detections and take a view of
+ * the tracks being tracked for the render stage. This is the only stage
+ * touching the tracker's items.
+ *
+ * @return void
+ */
+void Pipeline::track(Queue& in, Queue& out)
+{
+    typedef Tracker::TrackTable::const_iterator TiIter;
+
+    Packet p;
+
+    while (in.pop(p))
+    {
+        if (quit)
+            continue;
+
+        int64 t = cv::getTickCount();
+
+        if (p.detected) {
+            // detections are left untouched, render still wants them
+            tracker.update(p.detections, p.time);
+        } else {
+            tracker.coast(p.time);
+        }
+
+        detectNext = tracker.detectionDue();
+
+        if (detectNext)
+        {
+            std::lock_guard<std::mutex> lk(roiLock);
+            tracker.planDetection(p.frame.size(), nextRois);
+        }
+
+        const Tracker::TrackTable& items = tracker.items();
+        p.tracks.clear();
+
+        for (TiIter it=items.begin(); it != items.end(); ++it)
+        {
+            const TrackItem* ti = *it;
+
+            if (!ti->isActive())
+                continue;
+
+            TrackView v;
+            v.id = ti->id;
+            v.rect = ti->dRect;
+            v.uptime = ti->uptime();
+            v.numInactiveFrames = ti->numInactiveFrames;
+            p.tracks.push_back(v);
+        }
+
+        record(TRACK, t);
+        forward(out, p, RENDER);
+    }
+
+    out.close();
+}
+
+/**
+ * Draw detections on the DETECTION window and confirmed tracks on the
+ * TRACKING window. Any key pressed stops the pipeline.
+ *
+ * @return void
+ */
+void Pipeline::render(Queue& in)
+{
+    using namespace cv;
+
+    Packet p;
+
+    while (in.pop(p))
+    {
+        if (quit)
+            continue;
+
+        int64 t = cv::getTickCount();
+
+        cv::Mat frame2 = p.frame.clone();
+
+        for (uint i=0; i<p.detections.size(); ++i)
+        {
+            cvip::DetectionRect& d = p.detections[i];
+            cv::Rect r(d.x1, d.y1, d.width, d.height);
+            cv::rectangle(frame2, r, CV_RGB(255,0,0),3);
+        }
+
+        for (uint i=0; i<p.tracks.size(); ++i)
+        {
+            cvip::DetectionRect& d = p.tracks[i].rect;
+            cv::Rect r(d.x1, d.y1, d.width, d.height);
+
+            cv::rectangle(p.frame, r, cv::Scalar::all(255),3);
+
+            std::stringstream ss1, ss2;
+            std::string faceTracked("Face Tracked!");
+
+            ss1 << "id: " << p.tracks[i].id;
+            ss2 << "Uptime: " << p.tracks[i].uptime;
+
+            cv::putText(p.frame, ss1.str().c_str(), Point(d.x1,d.y2), FONT_HERSHEY_SIMPLEX, 0.5, CV_RGB(255,0,0), 2);
+            cv::putText(p.frame, ss2.str().c_str(), Point(d.x1,d.y2+20), FONT_HERSHEY_SIMPLEX, 0.5, CV_RGB(255,0,0), 2);
+
+            if (p.tracks[i].numInactiveFrames >0)
+                cv::putText(p.frame, faceTracked.c_str(), Point(d.x1,d.y2+40), FONT_HERSHEY_SIMPLEX, 0.5, CV_RGB(255,0,0), 2);
+        }
+
+        cv::imshow("DETECTION", frame2);
+        cv::imshow("TRACKING", p.frame);
+
+        record(RENDER, t);
+
+        if (waitKey(1) >= 0)
+            quit = true;
+    }
+}
+
+/**
+ * Push a packet to the next stage. With DROP_OLDEST a full queue loses
+ * its oldest packet, which is released here and counted for the stage.
+ *
+ * @return void
+ */
+void Pipeline::forward(Queue& out, const Packet& p, Stage next)
+{
+    Packet dropped;
+
+    if (out.push(p, config.policy, dropped))
+    {
+        release(dropped);
+        ++numDropped[next];
+    }
+}
+
+/**
+ * Record the time a stage spent on a frame.
+ *
+ * @param  Stage s
+ * @param  int64 tStart - tick count when the stage started the frame
+ * @return void
+ */
+void Pipeline::record(Stage s, int64 tStart)
+{
+    double t = (cv::getTickCount()-tStart)/cv::getTickFrequency();
+
+    ++numFrames[s];
+    sumTime[s] += t;
+    if (t > maxTime[s])
+        maxTime[s] = t;
+}
+
+/**
+ * Give the scale space a packet may carry back to the pool; its levels
+ * are kept for the next frame that takes it.
+ *
+ * @return void
+ */
+void Pipeline::release(Packet& p)
+{
+    if (!p.scales)
+        return;
+
+    std::lock_guard<std::mutex> lk(scaleLock);
+    freeScales.push_back(p.scales);
+    p.scales = 0;
+}
+
+/**
+ * Take a scale space from the pool; the pool grows up to the number of
+ * frames in flight between the scale space and detect stages.
+ *
+ * @return ScaleSpace*
+ */
+ScaleSpace* Pipeline::takeScaleSpace()
+{
+    std::lock_guard<std::mutex> lk(scaleLock);
+
+    if (freeScales.empty())
+        return new ScaleSpace;
+
+    ScaleSpace* scales = freeScales.back();
+    freeScales.pop_back();
+
+    return scales;
+}
+
+/**
+ * Timing of a stage during the last run(), in secs.
+ *
+ * @param  Stage s
+ * @return StageStats
+ */
+Pipeline::StageStats Pipeline::stats(Stage s) const
+{
+    StageStats st;
+    st.name = STAGE_NAMES[s];
+    st.numFrames = numFrames[s];
+    st.numDropped = numDropped[s];
+    st.meanTime = numFrames[s] ? sumTime[s]/numFrames[s] : 0.;
+    st.maxTime = maxTime[s];
+
+    return st;
+}
+
+/**
+ * Write the timing of every stage during the last run(), a line each.
+ *
+ * @param  ostream& out
+ * @return void
+ */
+void Pipeline::report(std::ostream& out) const
+{
+    for (uint s=0; s<NUM_STAGES; ++s)
+    {
+        StageStats st = stats((Stage)s);
+
+        out << st.name << ": " << st.numFrames << " frames, "
+            << st.meanTime*1000 << " ms mean, " << st.maxTime*1000 << " ms max, "
+            << st.numDropped << " dropped" << std::endl;
+    }
+}
@@ -0,0 +1,164 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "Tracker.h"
+#include "CascadeDetector.h"
+#include "ScaleSpace.h"
+#include "BoundedQueue.h"
+#include <string>
+#include <ostream>
+#include <mutex>
+
+namespace cvip
+{
+    /**
+     * Tracker on video: capture, scale space build, detection and
+     * tracking run on their own threads, rendering
+     * runs on the calling thread (highgui wants that). Stages are linked
+     * with bounded lock-free queues; when a queue is full the producer
+     * either blocks or drops the oldest frame.
+     * Frames the tracker doesn't want to detect on (see
+     * Tracker::detectionDue()) skip scale space and detection; the
+     * decision is made as frames enter the scale space stage, thus frames
+     * already queued by then follow the previous decision. The same holds
+     * for the regions of Tracker::planDetection(). Scale spaces (of the
+     * whole frame or of its regions) come from a pool of ScaleSpace
+     * objects kept for the life of the pipeline, one per frame in flight.
+     * The scale space stage is the CascadeDetector's, which the pipeline
+     * takes from the tracker once; with any other detector the scale
+     * space stage passes frames through and the detect stage does all
+     * the work through Tracker::detect().
+     *
+     * @author evangelos sariyanidi / sariyanidi[at]gmail[dot]com
+     * @date april 2011
+     */
+    class Pipeline
+    {
+    public:
+        //! pipeline stages, in frame order
+        enum Stage { CAPTURE, SCALE_SPACE, DETECT, TRACK, RENDER, NUM_STAGES };
+
+        /**
+         * Queue depths and backpressure. queueDepth[s] is the depth of the
+         * queue feeding stage s+1.
+         */
+        struct Config
+        {
+            Config() : policy(BoundedQueueBase::BLOCK), device(0), width(640), height(480)
+            {
+                for (uint i=0; i<NUM_STAGES-1; ++i)
+                    queueDepth[i] = 2;
+            }
+
+            uint queueDepth[NUM_STAGES-1];
+            BoundedQueueBase::Policy policy;
+
+            //! @property capture device and requested frame size
+            int device;
+            int width, height;
+        };
+
+        //! time spent by a stage, in secs.
+        struct StageStats
+        {
+            std::string name;
+            unsigned long numFrames;
+            unsigned long numDropped; //! frames dropped at the queue feeding this stage
+            double meanTime;
+            double maxTime;
+        };
+
+        Pipeline(cvip::Tracker& _tracker, const Config& _config = Config());
+
+        ~Pipeline();
+
+        // run until a key is pressed on a window or capture ends
+        void run();
+
+        // per stage timing of the last run()
+        StageStats stats(Stage s) const;
+
+        // stats() of all stages, a line each
+        void report(std::ostream& out) const;
+
+    private:
+        //! a track as seen by the render stage
+        struct TrackView
+        {
+            uint id;
+            cvip::DetectionRect rect;
+            double uptime;
+            unsigned short numInactiveFrames;
+        };
+
+        //! a frame travelling through the stages
+        struct Packet
+        {
+            Packet() : index(0), time(0), detected(true), scales(0) {}
+
+            unsigned long index;
+
+            //! @property capture time in secs., drives the tracker's time step
+            double time;
+
+            //! @property false if the frame skips detection and coasts on predictions
+            bool detected;
+
+            //! @property regions to detect on, empty for full frame
+            std::vector<cv::Rect> rois;
+
+            cv::Mat frame;
+            cvip::ScaleSpace* scales;       //! taken from the pool, 0 if none
+            std::vector<cvip::DetectionRect> detections;
+            std::vector<TrackView> tracks;
+        };
+
+        typedef BoundedQueue<Packet> Queue;
+
+        // stage bodies
+        void capture(Queue& out);
+        void buildScaleSpace(Queue& in, Queue& out);
+        void detect(Queue& in, Queue& out);
+        void track(Queue& in, Queue& out);
+        void render(Queue& in);
+
+        // push to the next stage, count and release a dropped packet
+        void forward(Queue& out, const Packet& p, Stage next);
+
+        // record time spent on a frame
+        void record(Stage s, int64 tStart);
+
+        // release anything a packet owns outside of itself
+        void release(Packet& p);
+
+        // a scale space from the pool, or a new one
+        cvip::ScaleSpace* takeScaleSpace();
+
+        cvip::Tracker& tracker;
+        Config config;
+
+        //! @property the tracker's detector if it is a CascadeDetector, which gets a scale space stage; 0 otherwise
+        cvip::CascadeDetector* cascade;
+
+        //! @property per stage records, each entry has a single writer thread
+        unsigned long numFrames[NUM_STAGES];
+        unsigned long numDropped[NUM_STAGES];
+        double sumTime[NUM_STAGES], maxTime[NUM_STAGES];
+
+        //! @property set by render to stop the other stages
+        std::atomic<bool> quit;
+
+        //! @property Tracker::detectionDue() as of the last tracked frame
+        std::atomic<bool> detectNext;
+
+        //! @property Tracker::planDetection() as of the last tracked frame
+        std::mutex roiLock;
+        std::vector<cv::Rect> nextRois;
+
+        //! @property scale spaces not carried by any packet
+        std::mutex scaleLock;
+        std::vector<cvip::ScaleSpace*> freeScales;
+    };
+}
+
+#endif // PIPELINE_H
@@ -0,0 +1,276 @@
+#include "ScaleSpace.h"
+#include "WorkerPool.h"
+#include "opencv2/imgproc/imgproc.hpp"
+#include <algorithm>
+
+using namespace cvip;
+
+const uint ScaleSpace::MAX_IDLE_BUILDS;
+
+/**
+ * Build the scale spaces of a frame, replacing those of the previous
+ * one. A region whose size has kept levels is resampled into them,
+ * otherwise the detector makes its levels (one region at a time, under
+ * detectLock). Resampling runs on the shared WorkerPool, one job per
+ * level. Kept levels unused for MAX_IDLE_BUILDS builds are freed.
+ *
+ * @param  Mat& frame
+ * @param  vector<cv::Rect>& rois - regions within frame, empty for the whole frame
+ * @return void
+ */
+void ScaleSpace::build(const cv::Mat& frame, const std::vector<cv::Rect>& rois)
+{
+    ++numBuilds;
+
+    numRegions = rois.empty() ? 1 : rois.size();
+
+    if (regions.size() < numRegions) {
+        regions.resize(numRegions);
+        regionLevels.resize(numRegions);
+    }
+
+    if (rois.empty())
+        regions[0] = cv::Rect(0, 0, frame.cols, frame.rows);
+    else
+        std::copy(rois.begin(), rois.end(), regions.begin());
+
+    reused.clear();
+
+    for (uint r=0; r<numRegions; ++r)
+    {
+        cv::Size size(regions[r].width, regions[r].height);
+
+        LevelSet* set = take(size);
+        bool fresh = !set || resampling == OFF;
+
+        if (!set) {
+            set = new LevelSet;
+            set->size = size;
+            sets.push_back(set);
+        }
+
+        set->lastUsed = numBuilds;
+        regionLevels[r] = set;
+
+        if (fresh)
+            makeLevels(frame, r, set);
+        else
+            reused.push_back(r);
+    }
+
+    // free the levels of sizes that are gone
+    for (uint s=0; s<sets.size(); )
+    {
+        if (sets[s]->lastUsed + MAX_IDLE_BUILDS >= numBuilds) {
+            ++s;
+            continue;
+        }
+
+        freeLevels(sets[s]->levels);
+        delete sets[s];
+        sets[s] = sets.back();
+        sets.pop_back();
+    }
+
+    if (reused.empty())
+        return;
+
+    jobs.clear();
+    for (uint k=0; k<reused.size(); ++k)
+        for (uint i=0; i<regionLevels[reused[k]]->levels.size(); ++i)
+            jobs.push_back(std::make_pair(reused[k], i));
+
+    WorkerPool& pool = WorkerPool::shared();
+    pool.run(reused.size(), [this, &frame](uint k) { convert(frame, reused[k]); });
+    pool.run(jobs.size(), [this, &frame](uint k) { resample(frame, jobs[k].first, jobs[k].second); });
+
+    if (resampling == ON)
+        return;
+
+    // first reuse: the resampled levels must be those the detector would make
+    if (check(frame, reused[0])) {
+        resampling = ON;
+        return;
+    }
+
+    resampling = OFF;
+
+    for (uint k=0; k<reused.size(); ++k)
+        makeLevels(frame, reused[k], regionLevels[reused[k]]);
+}
+
+/**
+ * Delete the levels of all regions, kept ones included.
+ *
+ * @return void
+ */
+void ScaleSpace::release()
+{
+    for (uint s=0; s<sets.size(); ++s)
+    {
+        freeLevels(sets[s]->levels);
+        delete sets[s];
+    }
+
+    sets.clear();
+    numRegions = 0;
+}
+
+/**
+ * Find kept levels of a region size that no region of this build has
+ * taken yet.
+ *
+ * @param  Size& size
+ * @return LevelSet* - 0 if none
+ */
+ScaleSpace::LevelSet* ScaleSpace::take(const cv::Size& size)
+{
+    for (uint s=0; s<sets.size(); ++s)
+        if (sets[s]->size == size && sets[s]->lastUsed != numBuilds)
+            return sets[s];
+
+    return 0;
+}
+
+/**
+ * The scale space of region r as the detector makes it, under
+ * detectLock if one is given.
+ *
+ * @param  Mat& frame
+ * @param  uint r
+ * @return vector<Image*> - new levels, owned by the caller
+ */
+std::vector<Image*> ScaleSpace::detectorLevels(const cv::Mat& frame, uint r)
+{
+    std::unique_lock<std::mutex> lk;
+    if (detectLock)
+        lk = std::unique_lock<std::mutex>(*detectLock);
+
+    return Image::create_scale_space(cv::Mat(frame, regions[r]), detector);
+}
+
+/**
+ * Have the detector make the levels of region r into set. A level that
+ * is a view of the frame is copied, as the frame goes away and the
+ * level is kept.
+ *
+ * @param  Mat& frame
+ * @param  uint r
+ * @param  LevelSet* set
+ * @return void
+ */
+void ScaleSpace::makeLevels(const cv::Mat& frame, uint r, LevelSet* set)
+{
+    freeLevels(set->levels);
+
+    set->levels = detectorLevels(frame, r);
+
+    for (uint i=0; i<set->levels.size(); ++i)
+    {
+        cv::Mat& I = set->levels[i]->I;
+        if (I.data >= frame.datastart && I.data < frame.dataend)
+            I = I.clone();
+    }
+}
+
+/**
+ * Convert region r to the type of its levels into the source of its
+ * set; nothing to do if the frame is of that type already.
+ *
+ * @param  Mat& frame
+ * @param  uint r
+ * @return void
+ */
+void ScaleSpace::convert(const cv::Mat& frame, uint r)
+{
+    LevelSet* set = regionLevels[r];
+    if (set->levels.empty())
+        return;
+
+    cv::Mat roi(frame, regions[r]);
+    const cv::Mat& I = set->levels[0]->I;
+
+    if (roi.type() == I.type()) {
+        set->source.release();
+        return;
+    }
+
+    if (roi.channels() == I.channels()) {
+        roi.convertTo(set->source, I.type());
+        return;
+    }
+
+    if (I.channels() == 1)
+        cv::cvtColor(roi, set->gray, roi.channels() == 4 ? cv::COLOR_BGRA2GRAY : cv::COLOR_BGR2GRAY);
+    else
+        cv::cvtColor(roi, set->gray, I.channels() == 4 ? cv::COLOR_GRAY2BGRA : cv::COLOR_GRAY2BGR);
+
+    if (set->gray.depth() == I.depth())
+        set->source = set->gray;
+    else
+        set->gray.convertTo(set->source, I.type());
+}
+
+/**
+ * Resample region r (or its converted source) into level i, in place.
+ *
+ * @param  Mat& frame
+ * @param  uint r
+ * @param  uint i
+ * @return void
+ */
+void ScaleSpace::resample(const cv::Mat& frame, uint r, uint i)
+{
+    LevelSet* set = regionLevels[r];
+    cv::Mat& I = set->levels[i]->I;
+
+    if (set->source.empty())
+        cv::resize(cv::Mat(frame, regions[r]), I, I.size(), 0, 0, cv::INTER_LINEAR);
+    else
+        cv::resize(set->source, I, I.size(), 0, 0, cv::INTER_LINEAR);
+}
+
+/**
+ * Compare the resampled levels of region r with a scale space made by
+ * the detector: same levels, of the same sizes, and on average within a
+ * grey level of each other (interpolation may round differently).
+ *
+ * @param  Mat& frame
+ * @param  uint r
+ * @return bool - true if they match
+ */
+bool ScaleSpace::check(const cv::Mat& frame, uint r)
+{
+    std::vector<Image*> reference = detectorLevels(frame, r);
+
+    const std::vector<Image*>& levels = regionLevels[r]->levels;
+    bool same = reference.size() == levels.size();
+
+    for (uint i=0; i<levels.size() && same; ++i)
+    {
+        const Image* a = levels[i];
+        const Image* b = reference[i];
+
+        same = a->width == b->width && a->height == b->height
+            && a->I.size() == b->I.size() && a->I.type() == b->I.type()
+            && cv::norm(a->I, b->I, cv::NORM_L1) <= (double)a->I.total()*a->I.channels();
+    }
+
+    freeLevels(reference);
+
+    return same;
+}
+
+/**
+ * Delete the images of a scale space.
+ *
+ * @param  vector<Image*>& levels
+ * @return void
+ */
+void ScaleSpace::freeLevels(std::vector<Image*>& levels)
+{
+    for (uint i=0; i<levels.size(); i++)
+        delete levels[i];
+
+    levels.clear();
+}
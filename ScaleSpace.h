@@ -0,0 +1,131 @@
+#ifndef SCALESPACE_H
+#define SCALESPACE_H
+
+#include "FaceDetector.h"
+#include "Image.h"
+#include <vector>
+#include <mutex>
+
+namespace cvip
+{
+    /**
+     * Scale spaces of a frame as the detector wants them: one for the
+     * whole frame, or one per detection region (see
+     * Tracker::planDetection()). Regions are views of the frame.
+     *
+     * Meant to live as long as the tracking loop and to be rebuilt every
+     * detected frame. The levels are made by Image::create_scale_space()
+     * only the first time a region size comes up; they are kept, by size,
+     * and on the next frames with a region of that size the region is
+     * resampled into the same level images, in parallel over all levels
+     * of all regions, on the shared WorkerPool. This takes the detector
+     * to read nothing of a level but Image::I, width and height, which
+     * depend on the size alone: the first reuse is checked against a
+     * scale space of the detector, and if they differ every region gets
+     * new levels from the detector, as before.
+     *
+     * Image::create_scale_space() is the only call into the detector and
+     * is made by one thread at a time, under the lock given with the
+     * detector (see CascadeDetector::scaleSpace()).
+     *
+     * @author evangelos sariyanidi / sariyanidi[at]gmail[dot]com
+     * @date april 2011
+     */
+    class ScaleSpace
+    {
+    public:
+        ScaleSpace(cvip::FaceDetector* _detector = 0, std::mutex* _detectLock = 0)
+            : detector(_detector), detectLock(_detectLock), numRegions(0), numBuilds(0), resampling(UNKNOWN) {}
+        ~ScaleSpace() { release(); }
+
+        // detectLock serializes create_scale_space() with other users of detector, 0 if the caller does
+        void setDetector(cvip::FaceDetector* _detector, std::mutex* _detectLock = 0)
+        {
+            if (_detector != detector)
+                release();
+
+            detector = _detector;
+            detectLock = _detectLock;
+        }
+
+        // build the scale space of each region of frame, of the whole frame if rois is empty
+        void build(const cv::Mat& frame, const std::vector<cv::Rect>& rois = std::vector<cv::Rect>());
+
+        // free all levels, kept ones included
+        void release();
+
+        // turn off reuse of levels, every region gets new levels from the detector
+        void setResampling(bool on) { resampling = on ? UNKNOWN : OFF; }
+
+        bool empty() const { return numRegions == 0; }
+        uint size() const { return numRegions; }
+
+        // levels of region r and where r lies in the frame
+        std::vector<Image*>& levels(uint r) { return regionLevels[r]->levels; }
+        const cv::Rect& region(uint r) const { return regions[r]; }
+
+        //! levels of a region size unused for this many builds are freed
+        static const uint MAX_IDLE_BUILDS = 8;
+
+    private:
+        // not copyable, it owns the levels
+        ScaleSpace(const ScaleSpace&);
+        ScaleSpace& operator=(const ScaleSpace&);
+
+        //! levels made by the detector for a region size, kept between frames
+        struct LevelSet
+        {
+            cv::Size size;
+            std::vector<Image*> levels;
+
+            //! @property the region converted to the type of the levels, if the frame's differs
+            cv::Mat source, gray;
+
+            //! @property build that last used the set
+            uint lastUsed;
+        };
+
+        //! reuse of levels: not checked yet, checked and on, off
+        enum Resampling { UNKNOWN, ON, OFF };
+
+        // a kept set of levels of size, not taken yet by this build; 0 if none
+        LevelSet* take(const cv::Size& size);
+
+        // scale space of region r made by the detector, under detectLock
+        std::vector<Image*> detectorLevels(const cv::Mat& frame, uint r);
+
+        // new levels of region r from the detector, the previous ones of set are freed
+        void makeLevels(const cv::Mat& frame, uint r, LevelSet* set);
+
+        // convert region r into set->source if the levels are of another type
+        void convert(const cv::Mat& frame, uint r);
+
+        // resample region r into level i of its set
+        void resample(const cv::Mat& frame, uint r, uint i);
+
+        // check the resampled levels of region r against the detector's own
+        bool check(const cv::Mat& frame, uint r);
+
+        static void freeLevels(std::vector<Image*>& levels);
+
+        cvip::FaceDetector* detector;
+        std::mutex* detectLock;
+
+        //! @property regions[0..numRegions) in frame coords and their levels; kept between frames
+        std::vector<cv::Rect> regions;
+        std::vector<LevelSet*> regionLevels;
+        uint numRegions;
+
+        //! @property all kept sets of levels, owned
+        std::vector<LevelSet*> sets;
+        uint numBuilds;
+
+        //! @property regions of this build on kept levels and their (region, level) pairs
+        std::vector<uint> reused;
+        std::vector<std::pair<uint,uint> > jobs;
+
+        Resampling resampling;
+    };
+}
+
+#endif // SCALESPACE_H
@@ -0,0 +1,253 @@
+#include "SceneGenerator.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace cvip;
+
+/**
+ * Generate numFrames frames. Live boxes of each frame go to truth with
+ * their ids; jittered detections of the visible ones and false
+ * positives go to detections with id -1.
+ *
+ * @param  MotSequence& detections - output
+ * @param  MotSequence& truth - output
+ * @return void
+ */
+void SceneGenerator::generate(MotSequence& detections, MotSequence& truth)
+{
+    rng.seed(config.seed);
+    objects.clear();
+    nextId = 1;
+
+    detections.clear();
+    truth.clear();
+
+    for (uint i=0; i<config.numObjects; ++i)
+        spawn(0);
+
+    for (uint f=0; f<config.numFrames; ++f)
+    {
+        // deaths, then births keeping the mean number of boxes
+        if (config.lifetime > 0)
+        {
+            uint numAlive = 0;
+            for (uint i=0; i<objects.size(); ++i)
+                if (objects[i].death > f)
+                    objects[numAlive++] = objects[i];
+            objects.resize(numAlive);
+
+            uint numBirths = poisson((float)config.numObjects/config.lifetime);
+            for (uint i=0; i<numBirths; ++i)
+                spawn(f);
+        }
+
+        for (uint i=0; i<objects.size(); ++i)
+        {
+            if (f > 0)
+                move(objects[i]);
+
+            const Object& o = objects[i];
+
+            MotBox b;
+            b.id = o.id;
+            b.rect = DetectionRect(cvip::round(o.x), cvip::round(o.y), cvip::round(o.w), cvip::round(o.h));
+            b.conf = 1.f;
+            truth.add(f, b);
+        }
+
+        detect(f, detections);
+    }
+
+    // frames with no box at the end still count
+    detections.resize(config.numFrames);
+    truth.resize(config.numFrames);
+}
+
+/**
+ * Add a box at a random place with random size, velocity and lifetime.
+ *
+ * @param  uint frame - birth frame
+ * @return void
+ */
+void SceneGenerator::spawn(uint frame)
+{
+    Object o;
+    o.id = nextId++;
+    o.w = uniform(config.minSize, config.maxSize);
+    o.h = o.w;
+    o.x = uniform(0, std::max(1.f, config.width-o.w));
+    o.y = uniform(0, std::max(1.f, config.height-o.h));
+
+    float angle = uniform(0, 2*PI), speed = uniform(0, config.speed);
+    o.vx = speed*std::cos(angle);
+    o.vy = speed*std::sin(angle);
+    o.turn = uniform(-config.turnRate, config.turnRate);
+
+    // exponential lifetime
+    o.death = config.lifetime > 0 ? frame + 1 + (uint)(-std::log(uniform(1e-6f, 1.f))*config.lifetime) : ~0u;
+
+    objects.push_back(o);
+}
+
+/**
+ * Advance a box one frame; it bounces on the frame borders.
+ *
+ * @param  Object& o
+ * @return void
+ */
+void SceneGenerator::move(Object& o)
+{
+    if (config.motion == RANDOM_ACCELERATION)
+    {
+        o.vx += gaussian(config.acceleration);
+        o.vy += gaussian(config.acceleration);
+    }
+    else if (config.motion == TURNING)
+    {
+        float c = std::cos(o.turn), s = std::sin(o.turn);
+        float vx = c*o.vx - s*o.vy;
+        o.vy = s*o.vx + c*o.vy;
+        o.vx = vx;
+    }
+
+    o.x += o.vx;
+    o.y += o.vy;
+
+    if (o.x < 0 || o.x+o.w > config.width) {
+        o.vx = -o.vx;
+        o.x = std::min(std::max(o.x, 0.f), std::max(0.f, config.width-o.w));
+    }
+
+    if (o.y < 0 || o.y+o.h > config.height) {
+        o.vy = -o.vy;
+        o.y = std::min(std::max(o.y, 0.f), std::max(0.f, config.height-o.h));
+    }
+}
+
+/**
+ * Detections of a frame. A box is hidden by the boxes in front of it,
+ * i.e. the ones whose bottom edge is lower in the frame; the hidden
+ * fraction is the sum of their overlaps with the box, which may count
+ * a pixel twice but is close enough.
+ *
+ * @param  uint frame
+ * @param  MotSequence& detections - output
+ * @return void
+ */
+void SceneGenerator::detect(uint frame, MotSequence& detections)
+{
+    uint n = objects.size();
+
+    rects.resize(n);
+    rectPtrs.resize(n);
+    for (uint i=0; i<n; ++i)
+    {
+        const Object& o = objects[i];
+        rects[i] = DetectionRect(cvip::round(o.x), cvip::round(o.y), cvip::round(o.w), cvip::round(o.h));
+        rectPtrs[i] = &rects[i];
+    }
+
+    if (config.occlusion > 0)
+        grid.build(rectPtrs);
+
+    for (uint i=0; i<n; ++i)
+    {
+        // draw the numbers of missed boxes too, so missRate alone does not change the scene
+        bool missed = uniform(0, 1) < config.missRate;
+        float dx1 = gaussian(config.jitter), dy1 = gaussian(config.jitter);
+        float dx2 = gaussian(config.jitter), dy2 = gaussian(config.jitter);
+
+        if (missed)
+            continue;
+
+        if (config.occlusion > 0)
+        {
+            grid.query(rects[i], near);
+
+            double hidden = 0.;
+            for (uint k=0; k<near.size(); ++k)
+            {
+                const DetectionRect& r = rects[near[k]];
+
+                if (near[k] != i && r.y2 > rects[i].y2)
+                    hidden += Rect::intersect(rects[i], r);
+            }
+
+            if (hidden >= config.occlusion*rects[i].width*rects[i].height)
+                continue;
+        }
+
+        const Object& o = objects[i];
+        float x1 = o.x+dx1, y1 = o.y+dy1, x2 = o.x+o.w+dx2, y2 = o.y+o.h+dy2;
+
+        MotBox b;
+        b.id = -1;
+        b.rect = DetectionRect(cvip::round(x1), cvip::round(y1), cvip::round(x2-x1), cvip::round(y2-y1));
+        b.conf = 1.f;
+        detections.add(frame, b);
+    }
+
+    uint numFalse = poisson(config.falsePositives);
+
+    for (uint i=0; i<numFalse; ++i)
+    {
+        float side = uniform(config.minSize, config.maxSize);
+
+        MotBox b;
+        b.id = -1;
+        b.rect = DetectionRect(cvip::round(uniform(0, std::max(1.f, config.width-side))),
+                               cvip::round(uniform(0, std::max(1.f, config.height-side))),
+                               cvip::round(side), cvip::round(side));
+        b.conf = 0.5f;
+        detections.add(frame, b);
+    }
+}
+
+/**
+ * Uniform in [a,b), from the top 24 bits of one mt19937 output.
+ *
+ * @return float
+ */
+float SceneGenerator::uniform(float a, float b)
+{
+    return a + (b-a)*((rng() >> 8)*(1.f/16777216.f));
+}
+
+/**
+ * Zero mean gaussian, Box-Muller.
+ *
+ * @param  float std
+ * @return float
+ */
+float SceneGenerator::gaussian(float std)
+{
+    float u1 = uniform(1e-7f, 1.f), u2 = uniform(0, 1);
+
+    return std*std::sqrt(-2.f*std::log(u1))*std::cos(2*(float)PI*u2);
+}
+
+/**
+ * Poisson number of events, Knuth's method for small means and a
+ * rounded gaussian for large ones.
+ *
+ * @param  float mean
+ * @return uint
+ */
+uint SceneGenerator::poisson(float mean)
+{
+    if (mean <= 0)
+        return 0;
+
+    if (mean > 30)
+        return (uint)std::max(0.f, std::floor(mean + gaussian(std::sqrt(mean)) + 0.5f));
+
+    float limit = std::exp(-mean), p = 1.f;
+    uint k = 0;
+
+    do {
+        ++k;
+        p *= uniform(0, 1);
+    } while (p > limit);
+
+    return k-1;
+}
@@ -0,0 +1,104 @@
+#ifndef SCENEGENERATOR_H
+#define SCENEGENERATOR_H
+
+#include "MotSequence.h"
+#include "SpatialGrid.h"
+#include <random>
+#include <vector>
+
+namespace cvip
+{
+    /**
+     * Synthetic scenes for stress-testing the Tracker without video:
+     * boxes moving within a frame, with births and deaths, observed by
+     * an imperfect detector that jitters, misses boxes, misses boxes
+     * hidden behind others and reports false positives.
+     * The ground truth holds every live box (hidden ones too), the
+     * detections hold what the detector would report.
+     *
+     * A seed gives the same scene on any machine and build: only
+     * std::mt19937, whose output the standard fixes, is used, and all
+     * distributions are computed here. The float math must round the
+     * same everywhere, thus this file is built without -march=native and
+     * without fused multiply-adds (-ffp-contract=off, see cvip_scene in
+     * CMakeLists.txt); tests/SceneGeneratorTest.cpp pins seeded scenes.
+     *
+     * @author evangelos sariyanidi / sariyanidi[at]gmail[dot]com
+     * @date april 2011
+     */
+    class SceneGenerator
+    {
+    public:
+        //! how boxes move
+        enum Motion
+        {
+            CONSTANT_VELOCITY,  //! straight lines, bouncing on frame borders
+            RANDOM_ACCELERATION,//! velocity takes gaussian kicks every frame
+            TURNING             //! constant speed on circular arcs
+        };
+
+        struct Config
+        {
+            Config() : seed(1), width(1920), height(1080), numFrames(500), numObjects(100),
+                motion(CONSTANT_VELOCITY), speed(3.f), acceleration(0.5f), turnRate(0.05f),
+                minSize(24), maxSize(96), lifetime(0), missRate(0.05f), falsePositives(1.f),
+                jitter(1.f), occlusion(0.5f) {}
+
+            uint seed;
+            uint width, height;         //! frame size
+            uint numFrames;
+            uint numObjects;            //! boxes at start, and mean number of live boxes
+            Motion motion;
+            float speed;                //! max initial speed, pixels per frame
+            float acceleration;         //! std of velocity kicks, RANDOM_ACCELERATION
+            float turnRate;             //! max turn rate in radians per frame, TURNING
+            uint minSize, maxSize;      //! box side range
+            uint lifetime;              //! mean box lifetime in frames, 0 = boxes live forever
+            float missRate;             //! chance a visible box is not detected
+            float falsePositives;       //! mean number of false positives per frame
+            float jitter;               //! std of detection corner noise, pixels
+            float occlusion;            //! a box is missed once this fraction of it is hidden, 0 = off
+        };
+
+        SceneGenerator(const Config& _config = Config()) : config(_config) {}
+
+        // fill detections and truth with a new scene, same config = same scene
+        void generate(MotSequence& detections, MotSequence& truth);
+
+    private:
+        //! a live box
+        struct Object
+        {
+            int id;
+            float x, y, w, h;   //! top-left corner and size
+            float vx, vy;
+            float turn;
+            uint death;         //! frame the box dies at
+        };
+
+        // random numbers, same on any platform
+        float uniform(float a, float b);
+        float gaussian(float std);
+        uint poisson(float mean);
+
+        void spawn(uint frame);
+        void move(Object& o);
+        void detect(uint frame, MotSequence& detections);
+
+        const Config config;
+
+        std::mt19937 rng;
+
+        //! @property live boxes and next id to give
+        std::vector<Object> objects;
+        int nextId;
+
+        //! @property hidden-box test buffers
+        std::vector<cvip::DetectionRect> rects;
+        std::vector<const cvip::DetectionRect*> rectPtrs;
+        std::vector<uint> near;
+        cvip::SpatialGrid grid;
+    };
+}
+
+#endif // SCENEGENERATOR_H
@@ -0,0 +1,173 @@
+#ifndef SLOTMAP_H
+#define SLOTMAP_H
+
+#include <vector>
+#include <cstddef>
+
+namespace cvip
+{
+    /**
+     * Table of values addressed by stable keys. Values are kept densely
+     * in insertion order, except that erasing moves the last value into
+     * the hole, thus iterating is a linear walk over an array and both
+     * insert and erase are O(1).
+     *
+     * A key packs a slot index (low INDEX_BITS bits) and the generation
+     * of the slot (high bits). The generation is bumped when a value is
+     * erased, so a stale key never finds the value that reuses its slot.
+     * Keys of the first generation equal their slot index.
+     *
+     * @author evangelos sariyanidi / sariyanidi[at]gmail[dot]com
+     * @date april 2011
+     */
+    template <typename T>
+    class SlotMap
+    {
+    public:
+        typedef unsigned int Key;
+        typedef typename std::vector<T>::iterator iterator;
+        typedef typename std::vector<T>::const_iterator const_iterator;
+
+        //! at most 2^INDEX_BITS values live at once
+        static const unsigned int INDEX_BITS = 20;
+        static const unsigned int INDEX_MASK = (1u << INDEX_BITS) - 1;
+
+        // store value, return its key
+        Key insert(const T& value);
+
+        // erase the value of key, false if key is stale
+        bool erase(Key key);
+
+        // value of key, 0 if key is stale
+        T* find(Key key);
+        const T* find(Key key) const;
+
+        void clear();
+
+        // room for n values, insert() doesn't allocate until then
+        void reserve(size_t n)
+        {
+            values.reserve(n);
+            keys.reserve(n);
+            slots.reserve(n);
+            freeSlots.reserve(n);
+        }
+
+        size_t size() const { return values.size(); }
+        bool empty() const { return values.empty(); }
+
+        // dense access, i < size(); indices change on erase
+        T& operator[](size_t i) { return values[i]; }
+        const T& operator[](size_t i) const { return values[i]; }
+        Key keyAt(size_t i) const { return keys[i]; }
+
+        iterator begin() { return values.begin(); }
+        iterator end() { return values.end(); }
+        const_iterator begin() const { return values.begin(); }
+        const_iterator end() const { return values.end(); }
+
+    private:
+        static const unsigned int NONE = ~0u;
+
+        // where to find the value of a slot
+        struct Slot
+        {
+            unsigned int generation;
+            unsigned int dense; //! index in values, NONE if the slot is free
+        };
+
+        //! @property the values, densely
+        std::vector<T> values;
+
+        //! @property keys[i] is the key of values[i]
+        std::vector<Key> keys;
+
+        //! @property indexed by the slot part of a key
+        std::vector<Slot> slots;
+
+        //! @property slots not in use
+        std::vector<unsigned int> freeSlots;
+    };
+
+    template <typename T>
+    typename SlotMap<T>::Key SlotMap<T>::insert(const T& value)
+    {
+        unsigned int slot;
+
+        if (freeSlots.empty()) {
+            slot = slots.size();
+            Slot s = { 0, NONE };
+            slots.push_back(s);
+        } else {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+        }
+
+        Key key = (slots[slot].generation << INDEX_BITS) | slot;
+
+        slots[slot].dense = values.size();
+        values.push_back(value);
+        keys.push_back(key);
+
+        return key;
+    }
+
+    template <typename T>
+    bool SlotMap<T>::erase(Key key)
+    {
+        if (!find(key))
+            return false;
+
+        unsigned int slot = key & INDEX_MASK;
+        unsigned int i = slots[slot].dense;
+
+        // move the last value into the hole
+        if (i+1 != values.size())
+        {
+            values[i] = values.back();
+            keys[i] = keys.back();
+            slots[keys[i] & INDEX_MASK].dense = i;
+        }
+
+        values.pop_back();
+        keys.pop_back();
+
+        slots[slot].dense = NONE;
+        slots[slot].generation = (slots[slot].generation+1) & (~0u >> INDEX_BITS);
+        freeSlots.push_back(slot);
+
+        return true;
+    }
+
+    template <typename T>
+    T* SlotMap<T>::find(Key key)
+    {
+        return const_cast<T*>(static_cast<const SlotMap<T>*>(this)->find(key));
+    }
+
+    template <typename T>
+    const T* SlotMap<T>::find(Key key) const
+    {
+        unsigned int slot = key & INDEX_MASK;
+
+        if (slot >= slots.size())
+            return 0;
+
+        const Slot& s = slots[slot];
+
+        if (s.dense == NONE || s.generation != (key >> INDEX_BITS))
+            return 0;
+
+        return &values[s.dense];
+    }
+
+    template <typename T>
+    void SlotMap<T>::clear()
+    {
+        // erase one by one, so stale keys stay stale
+        while (!keys.empty())
+            erase(keys.back());
+    }
+}
+
+#endif // SLOTMAP_H
@@ -0,0 +1,195 @@
+#ifndef SNAPSHOTBUFFER_H
+#define SNAPSHOTBUFFER_H
+
+#include <atomic>
+
+namespace cvip
+{
+    /**
+     * Publication of immutable snapshots from one writer thread to any
+     * number of reader threads, without locks.
+     * The writer fills a buffer that no reader holds (edit()), then makes
+     * it the current one (publish()). A reader pins the current buffer
+     * with acquire(); the writer never edits a pinned buffer, thus the
+     * reader sees one consistent snapshot until it lets go of the
+     * Handle. Buffers are allocated on demand, up to MAX_BUFFERS, and
+     * reused; their contents (e.g. vectors) keep their capacity.
+     *
+     * Neither side ever waits: a reader retries only if a publish()
+     * races with its acquire(), and if all buffers are pinned by slow
+     * readers edit() returns 0 and the writer skips that snapshot.
+     *
+     * @author evangelos sariyanidi / sariyanidi[at]gmail[dot]com
+     * @date april 2011
+     */
+    template <typename T>
+    class SnapshotBuffer
+    {
+    public:
+        //! at most this many snapshots exist at once
+        static const unsigned int MAX_BUFFERS = 16;
+
+        /**
+         * A reader's pin on a snapshot, released on destruction.
+         */
+        class Handle
+        {
+        public:
+            Handle() : owner(0), index(0) {}
+            Handle(Handle&& h) : owner(h.owner), index(h.index) { h.owner = 0; }
+            ~Handle() { release(); }
+
+            Handle& operator=(Handle&& h)
+            {
+                if (this != &h) {
+                    release();
+                    owner = h.owner;
+                    index = h.index;
+                    h.owner = 0;
+                }
+                return *this;
+            }
+
+            // the snapshot, 0 if nothing was published yet
+            const T* get() const { return owner ? &owner->buffers[index]->value : 0; }
+            const T* operator->() const { return get(); }
+            const T& operator*() const { return *get(); }
+
+            // unpin early
+            void release()
+            {
+                if (owner)
+                    --owner->buffers[index]->readers;
+                owner = 0;
+            }
+
+        private:
+            friend class SnapshotBuffer;
+
+            Handle(const SnapshotBuffer* _owner, unsigned int _index) : owner(_owner), index(_index) {}
+
+            // not copyable
+            Handle(const Handle&);
+            Handle& operator=(const Handle&);
+
+            const SnapshotBuffer* owner;
+            unsigned int index;
+        };
+
+        SnapshotBuffer() : numBuffers(0), current(NONE), editing(NONE)
+        {
+            for (unsigned int i=0; i<MAX_BUFFERS; ++i)
+                buffers[i] = 0;
+        }
+
+        // all handles must be released before
+        ~SnapshotBuffer()
+        {
+            for (unsigned int i=0; i<numBuffers; ++i)
+                delete buffers[i];
+        }
+
+        // writer: a buffer to fill for the next publish(), 0 if all are pinned;
+        // it holds whatever an older snapshot left in it
+        T* edit();
+
+        // writer: make the buffer of the last edit() the current snapshot
+        void publish();
+
+        // reader: pin the current snapshot
+        Handle acquire() const;
+
+    private:
+        static const unsigned int NONE = ~0u;
+
+        struct Buffer
+        {
+            Buffer() : readers(0) {}
+
+            T value;
+
+            //! @property handles pinning this buffer
+            mutable std::atomic<unsigned int> readers;
+        };
+
+        // not copyable
+        SnapshotBuffer(const SnapshotBuffer&);
+        SnapshotBuffer& operator=(const SnapshotBuffer&);
+
+        //! @property buffers[0..numBuffers) exist; only the writer adds
+        Buffer* buffers[MAX_BUFFERS];
+        std::atomic<unsigned int> numBuffers;
+
+        //! @property index of the published buffer, NONE before the first publish()
+        std::atomic<unsigned int> current;
+
+        //! @property buffer being filled by the writer
+        unsigned int editing;
+    };
+
+    /**
+     * Pick a buffer that is neither current nor pinned. A reader may pin
+     * it right after the check, but it sees it is not current and lets
+     * go; the seq_cst order of its pin and its check against this
+     * thread's publish() and check makes that safe.
+     */
+    template <typename T>
+    T* SnapshotBuffer<T>::edit()
+    {
+        unsigned int cur = current.load();
+
+        for (unsigned int i=0; i<numBuffers; ++i)
+        {
+            if (i != cur && buffers[i]->readers.load() == 0) {
+                editing = i;
+                return &buffers[i]->value;
+            }
+        }
+
+        if (numBuffers == MAX_BUFFERS)
+            return 0;
+
+        // the slot is filled before readers can learn of it through current
+        editing = numBuffers;
+        buffers[editing] = new Buffer;
+        ++numBuffers;
+
+        return &buffers[editing]->value;
+    }
+
+    template <typename T>
+    void SnapshotBuffer<T>::publish()
+    {
+        if (editing == NONE)
+            return;
+
+        current.store(editing);
+        editing = NONE;
+    }
+
+    /**
+     * Pin the current buffer, then check it is still current: if a
+     * publish() came in between, the writer might be filling it, thus
+     * let go and try again.
+     */
+    template <typename T>
+    typename SnapshotBuffer<T>::Handle SnapshotBuffer<T>::acquire() const
+    {
+        while (true)
+        {
+            unsigned int i = current.load();
+
+            if (i == NONE)
+                return Handle();
+
+            ++buffers[i]->readers;
+
+            if (current.load() == i)
+                return Handle(this, i);
+
+            --buffers[i]->readers;
+        }
+    }
+}
+
+#endif // SNAPSHOTBUFFER_H
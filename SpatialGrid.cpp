@@ -0,0 +1,163 @@
+#include "SpatialGrid.h"
+#include <algorithm>
+
+using namespace cvip;
+
+/**
+ * Index the given rects. Cell size is the average of the rect sides so
+ * that a rect covers a few cells only; the number of cells is kept
+ * proportional to the number of rects.
+ *
+ * @param  vector<const DetectionRect*>& rects
+ * @return void
+ */
+void SpatialGrid::build(const std::vector<const DetectionRect*>& rects)
+{
+    uint n = rects.size();
+
+    numCols = numRows = 0;
+    cellStart.clear();
+    cellItems.clear();
+
+    if (n == 0)
+        return;
+
+    int minX = rects[0]->x1, minY = rects[0]->y1;
+    int maxX = rects[0]->x2, maxY = rects[0]->y2;
+    double sideSum = 0.;
+
+    for (uint i=0; i<n; ++i)
+    {
+        const DetectionRect& r = *rects[i];
+
+        minX = std::min(minX, std::min(r.x1, r.x2));
+        minY = std::min(minY, std::min(r.y1, r.y2));
+        maxX = std::max(maxX, std::max(r.x1, r.x2));
+        maxY = std::max(maxY, std::max(r.y1, r.y2));
+
+        sideSum += std::max(r.width, 1) + std::max(r.height, 1);
+    }
+
+    cellSize = std::max(1, (int)(sideSum/(2*n)));
+
+    // don't let a sparse, wide scene create far more cells than rects
+    while ((double)((maxX-minX)/cellSize+1)*((maxY-minY)/cellSize+1) > 4.*n + 16)
+        cellSize *= 2;
+
+    x0 = minX;
+    y0 = minY;
+    numCols = (maxX-minX)/cellSize + 1;
+    numRows = (maxY-minY)/cellSize + 1;
+
+    uint numCells = numCols*numRows;
+
+    // counting sort of rect indices into cells
+    cellStart.assign(numCells+1, 0);
+    ranges.resize(4*n);
+
+    for (uint i=0; i<n; ++i)
+    {
+        int* rg = &ranges[4*i];
+        cellRange(*rects[i], rg[0], rg[1], rg[2], rg[3]);
+
+        for (int y=rg[1]; y<=rg[3]; ++y)
+            for (int x=rg[0]; x<=rg[2]; ++x)
+                ++cellStart[y*numCols+x+1];
+    }
+
+    for (uint c=0; c<numCells; ++c)
+        cellStart[c+1] += cellStart[c];
+
+    cellItems.resize(cellStart[numCells]);
+
+    for (uint i=0; i<n; ++i)
+    {
+        const int* rg = &ranges[4*i];
+
+        for (int y=rg[1]; y<=rg[3]; ++y)
+            for (int x=rg[0]; x<=rg[2]; ++x)
+                cellItems[cellStart[y*numCols+x]++] = i;
+    }
+
+    // filling moved each start to the next cell's start, shift back
+    for (uint c=numCells; c>0; --c)
+        cellStart[c] = cellStart[c-1];
+    cellStart[0] = 0;
+
+    stamps.assign(n, 0);
+    queryStamp = 0;
+}
+
+/**
+ * Make room for n rects: build() then allocates nothing as long as the
+ * rects cover at most 9 cells each on average (the cells are the mean
+ * rect side, a rect up to twice that size covers 1 to 9 cells).
+ *
+ * @param  uint n
+ * @return void
+ */
+void SpatialGrid::reserve(uint n)
+{
+    cellStart.reserve(4*n + 17);
+    cellItems.reserve(9*n);
+    ranges.reserve(4*n);
+    stamps.reserve(n);
+}
+
+/**
+ * Find the rects that share at least one cell with r. These are the
+ * only ones that may intersect r.
+ *
+ * @param  DetectionRect& r - query rect
+ * @param  vector<uint>& out - indices of candidate rects
+ * @return void
+ */
+void SpatialGrid::query(const DetectionRect& r, std::vector<uint>& out)
+{
+    out.clear();
+
+    int c1, r1, c2, r2;
+    if (numCols == 0 || !cellRange(r, c1, r1, c2, r2))
+        return;
+
+    ++queryStamp;
+
+    for (int y=r1; y<=r2; ++y)
+        for (int x=c1; x<=c2; ++x)
+        {
+            uint c = y*numCols+x;
+
+            for (uint k=cellStart[c]; k<cellStart[c+1]; ++k)
+            {
+                uint i = cellItems[k];
+
+                if (stamps[i] != queryStamp) {
+                    stamps[i] = queryStamp;
+                    out.push_back(i);
+                }
+            }
+        }
+
+    std::sort(out.begin(), out.end());
+}
+
+/**
+ * Compute the range of cells covered by r, clipped to the grid.
+ *
+ * @return bool - false if r is completely outside of the grid
+ */
+bool SpatialGrid::cellRange(const DetectionRect& r, int& c1, int& r1, int& c2, int& r2) const
+{
+    int left = std::min(r.x1, r.x2), right = std::max(r.x1, r.x2);
+    int top = std::min(r.y1, r.y2), bottom = std::max(r.y1, r.y2);
+
+    if (right < x0 || bottom < y0)
+        return false;
+
+    c1 = std::max(0, (left-x0)/cellSize);
+    r1 = std::max(0, (top-y0)/cellSize);
+    c2 = std::min(numCols-1, (right-x0)/cellSize);
+    r2 = std::min(numRows-1, (bottom-y0)/cellSize);
+
+    return c1 <= c2 && r1 <= r2;
+}
@@ -0,0 +1,61 @@
+#ifndef SPATIALGRID_H
+#define SPATIALGRID_H
+
+#include "FaceDetector.h"
+#include <vector>
+
+namespace cvip
+{
+    /**
+     * Uniform grid over a set of rectangles, used to find quickly which
+     * rectangles may overlap a query rectangle.
+     * Cell size follows the average rectangle size; buffers are kept
+     * between builds so rebuilding every frame costs no allocation once
+     * the number of rectangles settles.
+     *
+     * @author evangelos sariyanidi / sariyanidi[at]gmail[dot]com
+     * @date april 2011
+     */
+    class SpatialGrid
+    {
+    public:
+        SpatialGrid() : numCols(0), numRows(0), cellSize(1), x0(0), y0(0), queryStamp(0) {}
+
+        // index rects, the pointers are only used during build
+        void build(const std::vector<const cvip::DetectionRect*>& rects);
+
+        // room for indexing n rects
+        void reserve(uint n);
+
+        // indices of indexed rects sharing a cell with r, sorted ascending
+        void query(const cvip::DetectionRect& r, std::vector<uint>& out);
+
+    private:
+        // cell range covered by a rect, false if it's outside the grid
+        bool cellRange(const cvip::DetectionRect& r, int& c1, int& r1, int& c2, int& r2) const;
+
+        //! @property grid dimensions
+        int numCols, numRows;
+
+        //! @property width/height of a cell in pixels
+        int cellSize;
+
+        //! @property top-left corner of the grid
+        int x0, y0;
+
+        //! @property cellStart[c]..cellStart[c+1] indexes cellItems of cell c
+        std::vector<uint> cellStart;
+
+        //! @property rect indices, grouped by cell
+        std::vector<uint> cellItems;
+
+        //! @property per rect: last query that reported it, avoids duplicates
+        std::vector<uint> stamps;
+        uint queryStamp;
+
+        //! @property cell ranges of the indexed rects
+        std::vector<int> ranges;
+    };
+}
+
+#endif // SPATIALGRID_H
@@ -3,9 +3,6 @@
 
 using namespace cvip;
 
-uint TrackItem::counter = 0; //! keep number of TrackItem instances
-uint TrackItem::maxId = 1; //! use this each time an id is assigned to a new TrackItem
-
 /**
  * A TrackItem becomes active only if it is tracked for
  * at least Tracker::NUM_MIN_DETECTIONS times
@@ -19,7 +16,8 @@ bool TrackItem::isActive() const
 
 /**
  * Update an active item using new rectangle
- * Assuming that this TrackItem is active in this frame
+ * Assuming that this TrackItem is active in this frame and
+ * that the KalmanBank is predicted for this frame
  *
  * @param  DetectionRect&
  * @return void
@@ -29,18 +27,33 @@ void TrackItem::update(const DetectionRect& d)
     ++numActiveFrames;
     numInactiveFrames = 0;
 
-    // Tracking 4 points
-    cv::Mat measurement(kalman.M, 1, CV_32F);
-    measurement.at<float>(0,0) = d.x1;
-    measurement.at<float>(1,0) = d.y1;
-    measurement.at<float>(2,0) = d.x2;
-    measurement.at<float>(3,0) = d.y2;
-
-    kalman.filter->predict();
-    const cv::Mat& statePost = kalman.filter->correct(measurement);
+    // the bank has already predicted this frame, correct the prediction
+    kalman.bank.correct(kalman.slot, d);
 
     // update rectangle
-    setRectFrom(statePost);
+    setRectFromState();
+}
+
+/**
+ * Update an item using a rectangle detected at an earlier frame: the
+ * filter fuses it at that frame and re-predicts up to this one.
+ * Assuming that the KalmanBank is predicted for this frame
+ *
+ * @param  unsigned long frame - of the detection
+ * @param  DetectionRect&
+ * @return bool - false if the filter has no record of frame, nothing is updated then
+ */
+bool TrackItem::updateLate(unsigned long frame, const DetectionRect& d)
+{
+    if (!kalman.bank.correctLate(kalman.slot, frame, d))
+        return false;
+
+    ++numActiveFrames;
+    numInactiveFrames = 0;
+
+    setRectFromState();
+
+    return true;
 }
 
 /**
@@ -57,10 +70,8 @@ bool TrackItem::update()
     if (++numInactiveFrames >= Tracker::NUM_MAX_INACTIVE_FRAMES || !isActive())
         return false;
 
-    const cv::Mat& statePre = kalman.filter->predict();
-
-    // update rectangle
-    setRectFrom(statePre);
+    // the bank has already predicted this frame, take the prediction
+    setRectFromState();
 
     return true;
 }
@@ -68,61 +79,17 @@ bool TrackItem::update()
 /**
  * Update rectangle from the most recent state.
  *
- * @param  Mat& state
  * @return void
  */
-void TrackItem::setRectFrom(const cv::Mat &state)
+void TrackItem::setRectFromState()
 {
     using cvip::round;
 
-    dRect.x1 = state.at<float>(0,0);
-    dRect.y1 = state.at<float>(1,0);
-    dRect.x2 = state.at<float>(2,0);
-    dRect.y2 = state.at<float>(3,0);
+    dRect.x1 = kalman.bank.coord(kalman.slot, 0);
+    dRect.y1 = kalman.bank.coord(kalman.slot, 1);
+    dRect.x2 = kalman.bank.coord(kalman.slot, 2);
+    dRect.y2 = kalman.bank.coord(kalman.slot, 3);
 
     dRect.width = dRect.x2-dRect.x1;//2*halfWin;
     dRect.height = dRect.y2-dRect.y1;//2*halfWin;
 }
-
-/**
- * Kalman constructor: Parameters of the filter are set in here.
- * These parameters have a direct effect on the behaviour pf the filter.
- */
-TrackItem::Kalman::Kalman(const DetectionRect& initRect)
-{
-    N = 8; // dimension of trans. matrix
-    M = 4; // length of measurement
-
-    // setup kalman filter with a Model Matrix, a Measurement Matrix and no control vars
-    filter = new cv::KalmanFilter(N, M, 0);
-
-    // transitionMatrix is eye(n,n) by default
-    filter->transitionMatrix.at<float>(0,4) = 0.067f; // dt=0.04, stands for the time
-    filter->transitionMatrix.at<float>(1,5) = 0.067f; // betweeen two video frames in secs.
-    filter->transitionMatrix.at<float>(2,6) = 0.067f;
-    filter->transitionMatrix.at<float>(3,7) = 0.067f;
-
-    // measurementMatrix is zeros(n,p) by default
-    filter->measurementMatrix.at<float>(0,0) = 1.0f;
-    filter->measurementMatrix.at<float>(1,1) = 1.0f;
-    filter->measurementMatrix.at<float>(2,2) = 1.0f;
-    filter->measurementMatrix.at<float>(3,3) = 1.0f;
-
-    using cv::Scalar;
-
-    // assign a small value to diagonal coeffs of processNoiseCov
-    cv::setIdentity(filter->processNoiseCov, Scalar::all(1e-2)); // 1e-2
-
-    // Measurement noise is important, it defines how much can we trust to the
-    // measurement and has direct effect on the smoothness of tracking window
-    // - increase this tracking gets smoother
-    // - decrease this and tracking window becomes almost same with detection window
-    cv::setIdentity(filter->measurementNoiseCov, Scalar::all(1e-1)); // 1e-1
-    cv::setIdentity(filter->errorCovPost, Scalar::all(1));
-
-    // we are tracking 4 points, thus having 4 states: corners of rectangle
-    filter->statePost.at<float>(0,0) = initRect.x1;
-    filter->statePost.at<float>(1,0) = initRect.y1;
-    filter->statePost.at<float>(2,0) = initRect.x2;
-    filter->statePost.at<float>(3,0) = initRect.y2;
-}
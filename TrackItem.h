@@ -2,10 +2,26 @@
 #define TRACKITEM_H
 
 #include "FaceDetector.h"
-#include "opencv2/video/tracking.hpp"
+#include "KalmanBank.h"
+#include "opencv2/core/core.hpp"
 
 namespace cvip
 {
+    /**
+     * Instance and id counters of the track items of one Tracker.
+     * Each Tracker has its own, so trackers may run on different threads.
+     */
+    struct TrackCounters
+    {
+        TrackCounters() : counter(0), maxId(1) {}
+
+        //! @property count TrackItem instances
+        uint counter;
+
+        //! @property use to assign a new id
+        uint maxId;
+    };
+
     /**
      * Class to keep a track item.
      * Duty of this class:
@@ -13,68 +29,84 @@ namespace cvip
      * - Keep and give tracking statistics
      *
      * @author evangelos sariyanidi / sariyanidi[at]gmail[dot]com
-     * @todo update uptime() !
      * @date april 2011
      */
     class TrackItem
     {
     public:
-        // count instances + assign new
-        TrackItem(const cvip::DetectionRect& d) : id(maxId++),
-            numInactiveFrames(0), numActiveFrames(1), tStart(cv::getTickCount()), kalman(d),
-            dRect(d.x1, d.y1, d.width, d.height, d.angle, d.scale) {}
+        // count instances + assign new id, the key is given by the owning Tracker
+        TrackItem(uint _key, const cvip::DetectionRect& d, cvip::KalmanBank& bank, cvip::TrackCounters& _counters)
+            : id(_counters.maxId++), key(_key), numInactiveFrames(0), numActiveFrames(1), detection(-1), counters(_counters),
+            tStart(cv::getTickCount()), kalman(bank, d),
+            dRect(d.x1, d.y1, d.width, d.height, d.angle, d.scale) { ++counters.counter; }
 
-        // decrease num of instances on destruct
-        ~TrackItem() { --counter; if (!isActive()) --maxId; }
+        // decrease num of instances on destruct, ids are never given back
+        ~TrackItem() { --counters.counter; }
 
         // update active item with rect
         void update(const cvip::DetectionRect& dRect);
 
-        // update inactive item
+        // update with a rect detected at an earlier frame, false if it can't be (see KalmanBank::correctLate())
+        bool updateLate(unsigned long frame, const cvip::DetectionRect& dRect);
+
+        // update inactive item, the bank must be predicted already
         bool update();
 
+        // follow the prediction on a frame without detection, never drops
+        void coast() { setRectFromState(); }
+
+        // trace of the error covariance of the filter
+        float uncertainty() const { return kalman.bank.uncertainty(kalman.slot); }
+
+        // where the filter of this item lives, to read its state and covariance
+        const cvip::KalmanBank& filterBank() const { return kalman.bank; }
+        uint filterSlot() const { return kalman.slot; }
+
         // time passed since the tracking this (in secs.)
-        double uptime() const { return (double)(cv::getTickCount()-tStart);/*/CLOCKS_PER_SEC;*/ }
+        double uptime() const { return (cv::getTickCount()-tStart)/cv::getTickFrequency(); }
 		
         // dont begin tracking immediately, begin when ...
         bool isActive() const;
 
         /**
-         * Wrap class cv::KalmanFilter like this to handle it prettier.
+         * Handle to the filter of this item, which lives in the
+         * KalmanBank of the Tracker.
          */
         class Kalman
         {
         public:
             friend class TrackItem;
 
-            Kalman(const cvip::DetectionRect& initRect);
-            ~Kalman() { delete filter; }
+            Kalman(cvip::KalmanBank& _bank, const cvip::DetectionRect& initRect)
+                : bank(_bank), slot(_bank.alloc(initRect)) {}
+            ~Kalman() { bank.release(slot); }
 
         private:
-            uint N; //! dimension of transition matrix: NxN
-            uint M; //! length of measurement vector
-
-            cv::KalmanFilter* filter;
+            cvip::KalmanBank& bank; //! owner of the filter
+            const uint slot; //! index of the filter within bank
         };
 
-        //! @property unique id of track item
+        //! @property unique id of track item, increasing from 1
         const uint id;
 
+        //! @property key of the item in the Tracker's table, a lookup handle only: slots and keys are reused
+        const uint key;
+
         //! @property number of inactive frames - use to drop track if needed
         unsigned short numInactiveFrames;
 
         //! @property number of active frames - just record data
         uint numActiveFrames;
 
-    private:
-        // set detection item
-        void setRectFrom(const cv::Mat& state);
+        //! @property index of the detection that updated the item at the last frame, -1 if none
+        int detection;
 
-        //! @property count TrackItem instances
-        static uint counter;
+    private:
+        // set detection item from the current filter state
+        void setRectFromState();
 
-        //! @property use to assign a new id
-        static uint maxId;
+        //! @property instance/id counters of the owning Tracker
+        cvip::TrackCounters& counters;
 
         //! @property tick count at Track init. time of this item
         unsigned long tStart;
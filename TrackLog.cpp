@@ -0,0 +1,378 @@
+#include "TrackLog.h"
+#include <cstring>
+
+#ifdef _WIN32
+#include <fstream>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace cvip;
+
+typedef TrackLogFormat Format;
+
+// records follow 24-byte frame headers, keep them 8-byte aligned in the map
+static_assert(sizeof(TrackRecord) % 8 == 0 && sizeof(TrackLogFormat::FrameHeader) % 8 == 0,
+              "track log blocks must keep 8-byte alignment");
+
+static const char FILE_MAGIC[8] = { 'C', 'V', 'I', 'P', 'T', 'L', 'O', 'G' };
+
+/**
+ * Seek to an absolute offset, past the 2GB limit of fseek().
+ *
+ * @return bool
+ */
+static bool seek(std::FILE* file, uint64_t offset)
+{
+#ifdef _WIN32
+    return _fseeki64(file, (__int64)offset, SEEK_SET) == 0;
+#else
+    return fseeko(file, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+/**
+ * Create a log, write its header and its first index block.
+ *
+ * @param  string& path
+ * @param  MotionModel::Kind model - model of the trackers to be written
+ * @return bool
+ */
+bool TrackLogWriter::open(const std::string& path, MotionModel::Kind model)
+{
+    close();
+
+    this->model = model;
+
+    file = std::fopen(path.c_str(), "wb");
+
+    if (!file)
+        return false;
+
+    Format::FileHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, FILE_MAGIC, sizeof(h.magic));
+    h.version = Format::VERSION;
+    h.recordSize = sizeof(TrackRecord);
+    h.framesPerIndex = Format::FRAMES_PER_INDEX;
+    h.model = model;
+
+    numFrames = 0;
+    endOffset = sizeof(h);
+
+    if (std::fwrite(&h, sizeof(h), 1, file) != 1 || !startIndex()) {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Append an empty index block; the previous one, if any, is full and
+ * gets linked to it.
+ *
+ * @return bool
+ */
+bool TrackLogWriter::startIndex()
+{
+    uint64_t offset = endOffset;
+
+    if (numFrames > 0)
+    {
+        index.next = offset;
+        if (!writeIndex())
+            return false;
+    }
+
+    memset(&index, 0, sizeof(index));
+    index.magic = Format::INDEX_MAGIC;
+    index.firstFrame = numFrames;
+    indexOffset = offset;
+
+    if (!seek(file, offset) || std::fwrite(&index, sizeof(index), 1, file) != 1)
+        return false;
+
+    endOffset += sizeof(index);
+
+    return true;
+}
+
+/**
+ * Write the index block being filled over its reserved place.
+ *
+ * @return bool
+ */
+bool TrackLogWriter::writeIndex()
+{
+    return seek(file, indexOffset) && std::fwrite(&index, sizeof(index), 1, file) == 1
+        && seek(file, endOffset);
+}
+
+/**
+ * Append the items of a tracker as the next frame: id, rect, counters
+ * and the filter's state and covariance of every item, in the
+ * coordinates of its model. A tracker of another model than the log's
+ * is refused, its state would read as the wrong coordinates.
+ *
+ * @param  Tracker& tracker
+ * @param  double timestamp - secs, stored as is
+ * @return bool
+ */
+bool TrackLogWriter::write(const Tracker& tracker, double timestamp)
+{
+    typedef Tracker::TrackTable::const_iterator TiIter;
+
+    if (!file || tracker.motionModel().kind != model)
+        return false;
+
+    if (index.numFrames == Format::FRAMES_PER_INDEX && !startIndex())
+        return false;
+
+    const Tracker::TrackTable& items = tracker.items();
+    records.resize(items.size());
+
+    uint n = 0;
+    for (TiIter it=items.begin(); it != items.end(); ++it, ++n)
+    {
+        const TrackItem& ti = **it;
+        const KalmanBank& bank = ti.filterBank();
+        uint slot = ti.filterSlot();
+        TrackRecord& r = records[n];
+
+        r.id = ti.id;
+        r.numInactiveFrames = ti.numInactiveFrames;
+        r.flags = ti.isActive() ? TrackRecord::ACTIVE : 0;
+        r.numActiveFrames = ti.numActiveFrames;
+        r.x1 = ti.dRect.x1;
+        r.y1 = ti.dRect.y1;
+        r.x2 = ti.dRect.x2;
+        r.y2 = ti.dRect.y2;
+
+        for (uint i=0; i<KalmanBank::M; ++i)
+        {
+            r.state[i] = bank.position(slot, i);
+            r.state[KalmanBank::M+i] = bank.velocity(slot, i);
+            r.state[2*KalmanBank::M+i] = bank.acceleration(slot, i);
+        }
+
+        r.covPos = bank.covPos(slot);
+        r.covPosVel = bank.covPosVel(slot);
+        r.covVel = bank.covVel(slot);
+        r.covPosAcc = bank.covPosAcc(slot);
+        r.covVelAcc = bank.covVelAcc(slot);
+        r.covAcc = bank.covAcc(slot);
+        r.reserved = 0;
+    }
+
+    Format::FrameHeader h;
+    h.magic = Format::FRAME_MAGIC;
+    h.numRecords = n;
+    h.frame = numFrames;
+    h.timestamp = timestamp;
+
+    if (std::fwrite(&h, sizeof(h), 1, file) != 1)
+        return false;
+
+    if (n > 0 && std::fwrite(&records[0], sizeof(TrackRecord), n, file) != n)
+        return false;
+
+    index.offsets[index.numFrames++] = endOffset;
+    endOffset += sizeof(h) + n*sizeof(TrackRecord);
+    ++numFrames;
+
+    return true;
+}
+
+/**
+ * Bring the index up to date and flush the file.
+ *
+ * @return bool
+ */
+bool TrackLogWriter::flush()
+{
+    return file && writeIndex() && std::fflush(file) == 0;
+}
+
+/**
+ * Flush and close the log.
+ *
+ * @return void
+ */
+void TrackLogWriter::close()
+{
+    if (!file)
+        return;
+
+    flush();
+    std::fclose(file);
+    file = 0;
+}
+
+/**
+ * Map a log, hop over its index blocks and pick up the frames that an
+ * unclosed writer left out of the index. Logs of another version
+ * (version 1 kept corners whatever the model) are not read.
+ *
+ * @param  string& path
+ * @return bool
+ */
+bool TrackLogReader::open(const std::string& path)
+{
+    close();
+
+#ifdef _WIN32
+    std::ifstream in(path.c_str(), std::ios::binary);
+    if (!in)
+        return false;
+
+    buffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    data = buffer.empty() ? 0 : &buffer[0];
+    size = buffer.size();
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+
+    void* p = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+
+    if (p == MAP_FAILED)
+        return false;
+
+    data = static_cast<const char*>(p);
+    size = st.st_size;
+#endif
+
+    const Format::FileHeader* h = reinterpret_cast<const Format::FileHeader*>(data);
+
+    if (size < sizeof(*h) || memcmp(h->magic, FILE_MAGIC, sizeof(h->magic))
+        || h->version != Format::VERSION || h->recordSize != sizeof(TrackRecord)
+        || h->framesPerIndex != Format::FRAMES_PER_INDEX || h->model >= MotionModel::NUM_KINDS)
+    {
+        close();
+        return false;
+    }
+
+    kind = (MotionModel::Kind)h->model;
+
+    uint64_t offset = sizeof(*h), tail = offset;
+
+    while (offset + sizeof(Format::IndexBlock) <= size)
+    {
+        const Format::IndexBlock* b = reinterpret_cast<const Format::IndexBlock*>(data+offset);
+
+        if (b->magic != Format::INDEX_MAGIC)
+            break;
+
+        indexOffsets.push_back(offset);
+        numIndexed += b->numFrames;
+        tail = offset + sizeof(*b);
+
+        if (b->numFrames > 0)
+        {
+            const Format::FrameHeader* last = reinterpret_cast<const Format::FrameHeader*>(data + b->offsets[b->numFrames-1]);
+            tail = b->offsets[b->numFrames-1] + sizeof(*last) + last->numRecords*sizeof(TrackRecord);
+        }
+
+        // only the last block may be partly filled
+        if (b->next == 0 || b->numFrames < Format::FRAMES_PER_INDEX)
+            break;
+
+        offset = b->next;
+    }
+
+    recoverTail(tail);
+
+    return true;
+}
+
+/**
+ * Walk the frames from offset on, as long as they are complete.
+ *
+ * @return void
+ */
+void TrackLogReader::recoverTail(uint64_t offset)
+{
+    while (offset + sizeof(Format::FrameHeader) <= size)
+    {
+        const Format::FrameHeader* h = reinterpret_cast<const Format::FrameHeader*>(data+offset);
+
+        // a block reserved for frames that were never indexed
+        if (h->magic == Format::INDEX_MAGIC) {
+            offset += sizeof(Format::IndexBlock);
+            continue;
+        }
+
+        uint64_t end = offset + sizeof(*h) + (uint64_t)h->numRecords*sizeof(TrackRecord);
+
+        if (h->magic != Format::FRAME_MAGIC || end > size)
+            break;
+
+        tailOffsets.push_back(offset);
+        offset = end;
+    }
+}
+
+/**
+ * Unmap the log.
+ *
+ * @return void
+ */
+void TrackLogReader::close()
+{
+#ifdef _WIN32
+    buffer.clear();
+#else
+    if (data)
+        munmap(const_cast<char*>(data), size);
+#endif
+
+    data = 0;
+    size = 0;
+    kind = MotionModel::CORNER_VELOCITY;
+    indexOffsets.clear();
+    numIndexed = 0;
+    tailOffsets.clear();
+}
+
+/**
+ * Records of a frame, found through its index block.
+ *
+ * @param  uint64_t f - frame number
+ * @param  uint32_t& numRecords - output
+ * @param  double* timestamp - output, if not 0
+ * @return TrackRecord* - first record, 0 if there's none
+ */
+const TrackRecord* TrackLogReader::frame(uint64_t f, uint32_t& numRecords, double* timestamp) const
+{
+    uint64_t offset;
+
+    if (f < numIndexed)
+    {
+        const Format::IndexBlock* b = reinterpret_cast<const Format::IndexBlock*>(
+            data + indexOffsets[f/Format::FRAMES_PER_INDEX]);
+        offset = b->offsets[f%Format::FRAMES_PER_INDEX];
+    }
+    else
+    {
+        offset = tailOffsets[f-numIndexed];
+    }
+
+    const Format::FrameHeader* h = reinterpret_cast<const Format::FrameHeader*>(data+offset);
+
+    numRecords = h->numRecords;
+    if (timestamp)
+        *timestamp = h->timestamp;
+
+    return numRecords ? reinterpret_cast<const TrackRecord*>(h+1) : 0;
+}
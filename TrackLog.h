@@ -0,0 +1,189 @@
+#ifndef TRACKLOG_H
+#define TRACKLOG_H
+
+#include "Tracker.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace cvip
+{
+    //! state of a track item at a frame, as stored in a track log
+    struct TrackRecord
+    {
+        uint32_t id;
+        uint16_t numInactiveFrames;
+        uint16_t flags;                 //! ACTIVE if the item was confirmed
+        uint32_t numActiveFrames;
+        int32_t x1, y1, x2, y2;         //! dRect
+        float state[12];                //! positions, velocities, accelerations, in the coordinates of the log's model
+        float covPos, covPosVel, covVel;//! error covariance block, see KalmanBank
+        float covPosAcc, covVelAcc, covAcc; //! its acceleration terms
+        uint32_t reserved;
+
+        enum Flags { ACTIVE = 1 };
+    };
+
+    /**
+     * Binary track log, a file made to be memory mapped:
+     *
+     *     FileHeader
+     *     IndexBlock, frame, frame, ..., IndexBlock, frame, ...
+     *
+     * A frame is a FrameHeader followed by its TrackRecords. An index
+     * block holds the file offsets of the FRAMES_PER_INDEX frames that
+     * follow it and the offset of the next index block, so a reader
+     * finds any frame with two lookups after hopping over the index
+     * blocks once. All fields are in host byte order.
+     *
+     * The filter state of a record is in the coordinates of the motion
+     * model named in the file header (KalmanBank::position(), velocity()
+     * and acceleration()): corners for corner-cv and corner-ca, center,
+     * aspect and height for center-cv. Accelerations and their
+     * covariance terms are 0 for the velocity models.
+     *
+     * @author evangelos sariyanidi / sariyanidi[at]gmail[dot]com
+     * @date april 2011
+     */
+    struct TrackLogFormat
+    {
+        static const uint32_t VERSION = 2;
+        static const uint32_t FRAMES_PER_INDEX = 1024;
+        static const uint32_t FRAME_MAGIC = 0x4d415246; // "FRAM"
+        static const uint32_t INDEX_MAGIC = 0x58444e49; // "INDX"
+
+        struct FileHeader
+        {
+            char magic[8];              //! "CVIPTLOG"
+            uint32_t version;
+            uint32_t recordSize;        //! sizeof(TrackRecord)
+            uint32_t framesPerIndex;
+            uint32_t model;             //! MotionModel::Kind of the filter state
+        };
+
+        struct FrameHeader
+        {
+            uint32_t magic;
+            uint32_t numRecords;
+            uint64_t frame;             //! frame number, from 0
+            double timestamp;           //! secs, as given to the writer
+        };
+
+        struct IndexBlock
+        {
+            uint32_t magic;
+            uint32_t numFrames;         //! entries of offsets in use
+            uint64_t firstFrame;
+            uint64_t next;              //! offset of the next index block, 0 if none yet
+            uint64_t offsets[FRAMES_PER_INDEX];
+        };
+    };
+
+    /**
+     * Appends the items of a Tracker to a track log, one frame per call.
+     * Records are filled straight from the tracker's items into a buffer
+     * that is reused, so writing allocates nothing once the number of
+     * items settles. The index block being filled is written back every
+     * FRAMES_PER_INDEX frames and on flush()/close(); a log that is not
+     * closed still reads up to its last complete frame.
+     *
+     * @author evangelos sariyanidi / sariyanidi[at]gmail[dot]com
+     * @date april 2011
+     */
+    class TrackLogWriter
+    {
+    public:
+        TrackLogWriter() : file(0), model(cvip::MotionModel::CORNER_VELOCITY), numFrames(0), endOffset(0), indexOffset(0) {}
+        ~TrackLogWriter() { close(); }
+
+        // create (truncate) a log of trackers of model, false on failure
+        bool open(const std::string& path, cvip::MotionModel::Kind model);
+
+        // append all items of tracker as the next frame, false if tracker is of another model
+        bool write(const cvip::Tracker& tracker, double timestamp);
+
+        // write the index block being filled and flush the file
+        bool flush();
+
+        void close();
+
+    private:
+        // reserve a fresh index block at the end of the file
+        bool startIndex();
+
+        // write the index block being filled at its place
+        bool writeIndex();
+
+        std::FILE* file;
+        cvip::MotionModel::Kind model;
+        uint64_t numFrames;
+
+        //! @property size of the file
+        uint64_t endOffset;
+
+        //! @property index block being filled and its offset
+        TrackLogFormat::IndexBlock index;
+        uint64_t indexOffset;
+
+        //! @property records of the frame being written
+        std::vector<cvip::TrackRecord> records;
+
+        // not copyable
+        TrackLogWriter(const TrackLogWriter&);
+        TrackLogWriter& operator=(const TrackLogWriter&);
+    };
+
+    /**
+     * Reads a track log through a read-only memory map: records are
+     * returned as pointers into the mapping, nothing is copied.
+     *
+     * @author evangelos sariyanidi / sariyanidi[at]gmail[dot]com
+     * @date april 2011
+     */
+    class TrackLogReader
+    {
+    public:
+        TrackLogReader() : data(0), size(0), kind(cvip::MotionModel::CORNER_VELOCITY), numIndexed(0) {}
+        ~TrackLogReader() { close(); }
+
+        // map a log and index its frames, false if it's not a track log
+        bool open(const std::string& path);
+
+        void close();
+
+        uint64_t numFrames() const { return numIndexed + tailOffsets.size(); }
+
+        // model whose coordinates the filter state of the records is in
+        cvip::MotionModel::Kind model() const { return kind; }
+
+        // records of frame f (< numFrames()), valid until close()
+        const cvip::TrackRecord* frame(uint64_t f, uint32_t& numRecords, double* timestamp = 0) const;
+
+    private:
+        // frames written after the last index update (log not closed)
+        void recoverTail(uint64_t offset);
+
+        const char* data;
+        size_t size;
+        cvip::MotionModel::Kind kind;
+
+#ifdef _WIN32
+        //! @property file content, where there is no mmap
+        std::vector<char> buffer;
+#endif
+
+        //! @property offsets of the index blocks and number of frames they index
+        std::vector<uint64_t> indexOffsets;
+        uint64_t numIndexed;
+
+        //! @property offsets of frames missing from the index
+        std::vector<uint64_t> tailOffsets;
+
+        // not copyable
+        TrackLogReader(const TrackLogReader&);
+        TrackLogReader& operator=(const TrackLogReader&);
+    };
+}
+
+#endif // TRACKLOG_H
@@ -1,223 +1,746 @@
-#include "Tracker.h"
-#include "FaceDetector.h"
-#include "opencv2/highgui/highgui.hpp"
-
-using namespace cvip;
-
-/**
- * Destructor
- * Release memory. Delete detector and all trackItems
- */
-Tracker::~Tracker()
-{
-    delete detector;
-
-    typedef std::map<uint, TrackItem*>::iterator TiIter;
-
-    for (TiIter it = trackItems.begin(); it != trackItems.end(); ++it)
-        drop(it->first);
-}
-
-/**
- * Sample function, run tracker on video
- *
- * @todo erase this function !
- * @return void
- */
-void Tracker::onVideo()
-{
-    using namespace cv;
-
-    Mat frame;
-    VideoCapture cap(0);
-
-    if (!cap.isOpened())
-        return;
-
-    cap.set(CV_CAP_PROP_FRAME_WIDTH, 640);
-    cap.set(CV_CAP_PROP_FRAME_HEIGHT, 480);
-
-    while (1)
-    {
-        double t = (double) cv::getTickCount();
-
-        cap >> frame;
-
-        cv::Mat frame2 = frame.clone();
-
-		std::vector<Image*> images = Image::create_scale_space(frame,detector);
-        std::vector<cvip::DetectionRect> detections;
-
-        detections = detector->detect(images, true);
-
-		for (uint i=0; i<images.size(); i++)
-			delete images[i];
-
-        for (uint i=0; i<detections.size(); ++i)
-        {
-            cvip::DetectionRect& d = detections[i];
-            cv::Rect r(d.x1, d.y1, d.width, d.height);
-            cv::rectangle(frame2, r, CV_RGB(255,0,0),3);
-        }
-
-        updateWith(detections);
-
-        typedef std::map<uint, TrackItem*>::const_iterator TiIter;
-
-        for (TiIter it=trackItems.begin();
-                it != trackItems.end(); ++it)
-        {
-            cvip::DetectionRect& d = it->second->dRect;
-            cv::Rect r(d.x1, d.y1, d.width, d.height);
-
-            // draw bold if item is being tracked
-            if (it->second->isActive())
-            {
-                cv::rectangle(frame, r, cv::Scalar::all(255),3);
-
-                std::stringstream ss1, ss2, ss3;
-                std::string faceTracked("Face Tracked!");
-
-                ss1 << "id: " << it->first;
-                ss2 << "Uptime: " << it->second->uptime();
-                ss3 << "# of dead frames: " << it->second->numInactiveFrames;
-
-                cv::putText(frame, ss1.str().c_str(), Point(d.x1,d.y2), FONT_HERSHEY_SIMPLEX, 0.5, CV_RGB(255,0,0), 2);
-                cv::putText(frame, ss2.str().c_str(), Point(d.x1,d.y2+20), FONT_HERSHEY_SIMPLEX, 0.5, CV_RGB(255,0,0), 2);
-
-                if (it->second->numInactiveFrames >0)
-                    cv::putText(frame, faceTracked.c_str(), Point(d.x1,d.y2+40), FONT_HERSHEY_SIMPLEX, 0.5, CV_RGB(255,0,0), 2);
-            }
-            else // draw thin otherwise
-            {
-                //cv::rectangle(frame, r, cv::Scalar::all(255),1);
-            }
-        }
-
-        //std::cout << numItems() << std::endl;
-
-        cv::imshow("DETECTION", frame2);
-        cv::imshow("TRACKING", frame);
-
-        if(waitKey(10) >= 0)
-            break;
-    }
-}
-
-/**
- * Take new detections and update the whole trackItems list.
- * Processes are distributed to some internal methods.
- *
- * @param  vector<DetectionRect>& freshDetects - incoming detections
- * @return void
- */
-void Tracker::updateWith(std::vector<DetectionRect>& freshDetects)
-{
-    // a flag map keeping the state of each item: updated or not
-    std::map<uint, bool> flagActive;
-
-    // 1) update whatever you matchs
-    flagActive = updateActiveItems(freshDetects);
-
-    // 2) add remaining rectangles ass new items
-    this->addNewItems(freshDetects);
-
-    // 3) update unmatched items, drop them if necessary
-    this->updateInactiveItems(flagActive);
-}
-
-/**
- * Take new detections and update the ones matched with the
- * existing items.
- * WARNING! the detections which are not matched are removed
- * from the vector.
- *
- * @param  vector<DetectionRect>& freshDetects - incoming detections
- * @return std::map<uint,bool> - a flag for each item stating whether item is updated or not
- */
-std::map<uint,bool> Tracker::updateActiveItems(std::vector<DetectionRect>& freshDetects)
-{
-    std::map<uint, bool> flagActive;
-
-    typedef std::map<uint, TrackItem*>::iterator TiIter;
-
-    for (TiIter it=trackItems.begin(); it != trackItems.end(); ++it)
-        flagActive[it->first] = false;
-
-    // associate rects to items
-    for (int i=freshDetects.size()-1; i>=0; --i)
-    {
-        int maxIdx = -1;
-        double maxArea = 0.;
-
-        for (TiIter it=trackItems.begin(); it != trackItems.end(); ++it)
-        {
-            if (flagActive[it->first]) // update an item only once
-                continue;
-
-            uint area = Rect::intersect(freshDetects[i], it->second->dRect);
-
-            // check if they intersect
-            if (area > 0)
-            {
-                double ratio1 = (double)area/(freshDetects[i].width*freshDetects[i].height);
-                double ratio2 = (double)area/(it->second->dRect.width*it->second->dRect.height);
-
-                // try to find the best/largest intersection between rects
-                if (max<double>(ratio1,ratio2) > maxArea)
-                {
-                    maxArea = max<double>(ratio1,ratio2);
-                    maxIdx = it->first;
-                }
-            }
-        }
-
-        // is the best good enough?
-        if (maxArea > 0.20)
-        {
-            // if it is, freshDetects[i] is assumed to stand for the
-            // TrackedItem with id = maxIdx
-            flagActive[maxIdx] = true;
-            trackItems[maxIdx]->update(freshDetects[i]);
-            freshDetects.erase(freshDetects.begin()+i);
-        }
-    }
-
-    // this will be piped to updateInactiveItems()
-    return flagActive;
-}
-
-/**
- * Take a list including a flag for each TrackItem: updated or not.
- * Update each inactive item
- *
- * @param  map<uint,bool>& flagActive
- * @return void
- */
-void Tracker::updateInactiveItems(const std::map<uint,bool>& flagActive)
-{
-    typedef std::map<uint, bool>::const_iterator FlagIter;
-
-    for (FlagIter it = flagActive.begin(); it != flagActive.end(); ++it )
-    {
-        // skip if item is active at this frame
-        if (it->second)
-            continue;
-
-        // drop item if it's inactive for long
-        if (!trackItems[it->first]->update())
-            drop(it->first);
-    }
-}
-
-/**
- * Add remaining unmatched freshRects as new TrackItems
- *
- * @param  vector<DetectionRect>
- * @return void
- */
-void Tracker::addNewItems(std::vector<DetectionRect>& freshDetects)
-{
-    for (uint i=0; i<freshDetects.size(); ++i)
-        add(new TrackItem(freshDetects[i]));
-}
+#include "Tracker.h"
+#include "FaceDetector.h"
+#include "Instruments.h"
+#include <algorithm>
+
+using namespace cvip;
+
+/**
+ * Constructor
+ * Wrap a detector, or none if the caller gives the detections.
+ *
+ * @param  Detector* _detector - 0 if detections are given by the caller only
+ * @param  bool _ownsDetector - delete the detector with the tracker
+ */
+Tracker::Tracker(Detector* _detector, bool _ownsDetector) : detector(_detector), ownsDetector(_ownsDetector),
+    pendingTicket(0), streamId(0), detectionInterval(1),
+    maxUncertainty(0), framesSinceDetection(0), roiScale(0), fullScanInterval(1), framesSinceFullScan(0),
+    gateRelStd(0.1f), lastTimestamp(-1.), tStart(cv::getTickCount()), numFrames(0), publishing(false),
+    reservedItems(0)
+{
+}
+
+/**
+ * Make room for numItems track items and numDetects detections per
+ * frame: the item storage, the filters, the per-frame buffers, the
+ * associator and the published snapshots. Frames within these bounds
+ * then run without allocating.
+ *
+ * @param  uint numItems
+ * @param  uint numDetects
+ * @return void
+ */
+void Tracker::reserve(uint numItems, uint numDetects)
+{
+    itemPool.reserve(numItems);
+    trackItems.reserve(numItems);
+    kalmanBank.reserve(numItems);
+
+    frameItems.reserve(numItems);
+    frameRects.reserve(std::max(numItems, numDetects));
+    frameIds.reserve(numItems);
+    flagActive.reserve(numItems);
+    gates.reserve(numItems);
+    lateItems.reserve(numItems);
+    lateRects.reserve(numItems);
+
+    assignment.reserve(numDetects);
+    freeDetects.reserve(numDetects);
+
+    associator.reserve(numDetects, std::max(numItems, numDetects));
+
+    reservedItems = std::max(reservedItems, numItems);
+}
+
+/**
+ * Destructor
+ * Release memory. Delete detector (if owned) and all trackItems
+ */
+Tracker::~Tracker()
+{
+    // a result nobody polls would stay in a shared detector
+    if (pendingTicket) {
+        detector->wait();
+        detector->poll(pendingTicket, asyncResult);
+    }
+
+    if (ownsDetector)
+        delete detector;
+
+    typedef TrackTable::iterator TiIter;
+
+    for (TiIter it = trackItems.begin(); it != trackItems.end(); ++it)
+        itemPool.release(*it);
+
+    trackItems.clear();
+}
+
+/**
+ * Start tracking a new item at rect d. The item lives in the item
+ * pool of this tracker and its filter in the kalman bank.
+ *
+ * @param  DetectionRect& d
+ * @return TrackItem* - the new item
+ */
+TrackItem* Tracker::add(const DetectionRect& d)
+{
+    uint key = trackItems.insert(0);
+    TrackItem* ti = new (itemPool.allocate()) TrackItem(key, d, kalmanBank, counters);
+    *trackItems.find(key) = ti;
+
+    return ti;
+}
+
+/**
+ * Stop tracking an item, its storage goes back to the pool.
+ *
+ * @param  uint key - TrackItem::key of the item
+ * @return void
+ */
+void Tracker::drop(uint key)
+{
+    TrackItem** ti = trackItems.find(key);
+
+    if (!ti)
+        return;
+
+    itemPool.release(*ti);
+    trackItems.erase(key);
+}
+
+/**
+ * Run the detector on the scale space of a frame.
+ *
+ * @param  Mat& frame
+ * @return vector<DetectionRect> - detections in frame coordinates
+ */
+std::vector<DetectionRect> Tracker::detect(const cv::Mat& frame)
+{
+    return detect(frame, std::vector<cv::Rect>());
+}
+
+/**
+ * Run the detector on each region of a frame; regions are views of
+ * frame, nothing is copied. An empty list means the whole frame.
+ *
+ * @param  Mat& frame
+ * @param  vector<cv::Rect>& rois - regions within frame
+ * @return vector<DetectionRect> - detections in frame coordinates
+ */
+std::vector<DetectionRect> Tracker::detect(const cv::Mat& frame, const std::vector<cv::Rect>& rois)
+{
+    CVIP_TIME(instr, DETECT);
+
+    return detector->detect(frame, rois);
+}
+
+/**
+ * Decide where the detector runs on the next detected frame: around
+ * the items, in their rects enlarged by roiScale (sides rounded up to
+ * ROI_ALIGN), or on the full frame
+ * when ROI detection is off, every fullScanInterval frames (to catch
+ * new objects), when there is no item, or when the regions would cover
+ * most of the frame anyway. Overlapping regions are merged so that no
+ * pixel is scanned twice.
+ * Call once per detected frame.
+ *
+ * @param  Size& frameSize
+ * @param  vector<cv::Rect>& rois - output, empty for full frame
+ * @return void
+ */
+void Tracker::planDetection(const cv::Size& frameSize, std::vector<cv::Rect>& rois)
+{
+    typedef TrackTable::const_iterator TiIter;
+
+    rois.clear();
+
+    if (roiScale <= 0 || trackItems.empty() || ++framesSinceFullScan >= fullScanInterval)
+    {
+        framesSinceFullScan = 0;
+        return;
+    }
+
+    cv::Rect frameRect(0, 0, frameSize.width, frameSize.height);
+
+    for (TiIter it=trackItems.begin(); it != trackItems.end(); ++it)
+    {
+        const DetectionRect& d = (*it)->dRect;
+
+        int w = (int)(d.width*roiScale), h = (int)(d.height*roiScale);
+        w = (w + ROI_ALIGN-1)/ROI_ALIGN*ROI_ALIGN;
+        h = (h + ROI_ALIGN-1)/ROI_ALIGN*ROI_ALIGN;
+        cv::Rect r(d.x1 + d.width/2 - w/2, d.y1 + d.height/2 - h/2, w, h);
+        r = r & frameRect;
+
+        if (r.area() > 0)
+            rois.push_back(r);
+    }
+
+    // merge overlapping regions until none overlaps
+    bool merged = true;
+    while (merged)
+    {
+        merged = false;
+
+        for (uint i=0; i<rois.size() && !merged; ++i)
+            for (uint j=i+1; j<rois.size(); ++j)
+            {
+                if ((rois[i] & rois[j]).area() == 0)
+                    continue;
+
+                rois[i] = rois[i] | rois[j];
+                rois.erase(rois.begin()+j);
+                merged = true;
+                break;
+            }
+    }
+
+    // scanning a few large regions costs more than one full frame
+    double area = 0;
+    for (uint i=0; i<rois.size(); ++i)
+        area += rois[i].area();
+
+    if (rois.empty() || area > 0.5*frameRect.area())
+    {
+        rois.clear();
+        framesSinceFullScan = 0;
+    }
+}
+
+/**
+ * Take new detections and update the whole trackItems list.
+ * Processes are distributed to some internal methods.
+ * The detections are not modified; TrackItem::detection tells which
+ * one updated (or started) an item.
+ *
+ * @param  DetectionRect* freshDetects - incoming detections
+ * @param  uint numDetects
+ * @param  double timestamp - of the frame in secs., < 0 if unknown
+ * @return void
+ */
+void Tracker::update(const DetectionRect* freshDetects, uint numDetects, double timestamp)
+{
+    CVIP_TIME(instr, FRAME);
+    CVIP_COUNT(instr, FRAMES, 1);
+    CVIP_COUNT(instr, DETECTIONS, numDetects);
+
+    // 0) predict all items in one pass
+    {
+        CVIP_TIME(instr, PREDICT);
+        kalmanBank.predict(frameDt(timestamp));
+    }
+    framesSinceDetection = 0;
+
+    // 1) update whatever you matchs, flag them in flagActive
+    updateActiveItems(freshDetects, numDetects);
+
+    // 2) add remaining rectangles ass new items
+    this->addNewItems(freshDetects);
+
+    // 3) update unmatched items, drop them if necessary
+    this->updateInactiveItems();
+
+    endFrame();
+}
+
+/**
+ * Same as update(), except that the detections which are matched to
+ * existing items are removed from the vector: on return it holds the
+ * detections that started new items.
+ *
+ * @param  vector<DetectionRect>& freshDetects - incoming detections
+ * @param  double timestamp - of the frame in secs., < 0 if unknown
+ * @return void
+ */
+void Tracker::updateWith(std::vector<DetectionRect>& freshDetects, double timestamp)
+{
+    update(freshDetects, timestamp);
+
+    for (uint k=0; k<freeDetects.size(); ++k)
+        freshDetects[k] = freshDetects[freeDetects[k]];
+
+    freshDetects.resize(freeDetects.size());
+}
+
+/**
+ * Run a frame with detections of an earlier frame, e.g. those of a
+ * detector that lags behind the capture. Items are matched to the
+ * detections where they were at that frame, and a matched item's
+ * filter fuses its detection there and is re-predicted to this frame
+ * (see KalmanBank::correctLate()). Items started after that frame
+ * just coast. Unmatched detections start new items, at the detected
+ * rect.
+ *
+ * If frame is older than setLateDetections() allows (or it is off),
+ * the detections are taken as this frame's, as update() does.
+ *
+ * @param  DetectionRect* lateDetects
+ * @param  uint numDetects
+ * @param  unsigned long frame - the frame detected on, see nextFrame()
+ * @param  double timestamp - of this frame in secs., < 0 if unknown
+ * @return void
+ */
+void Tracker::updateLate(const DetectionRect* lateDetects, uint numDetects, unsigned long frame, double timestamp)
+{
+    if (!kalmanBank.inHistory(frame)) {
+        update(lateDetects, numDetects, timestamp);
+        return;
+    }
+
+    CVIP_TIME(instr, FRAME);
+    CVIP_COUNT(instr, FRAMES, 1);
+    CVIP_COUNT(instr, DETECTIONS, numDetects);
+
+    {
+        CVIP_TIME(instr, PREDICT);
+        kalmanBank.predict(frameDt(timestamp));
+    }
+    framesSinceDetection = 0;
+
+    updateLateItems(lateDetects, numDetects, frame);
+
+    this->addNewItems(lateDetects);
+
+    this->updateInactiveItems();
+
+    endFrame();
+}
+
+/**
+ * State of every item after the last frame, in table order.
+ *
+ * @param  vector<TrackOutput>& out
+ * @return void
+ */
+void Tracker::exportTracks(std::vector<TrackOutput>& out) const
+{
+    typedef TrackTable::const_iterator TiIter;
+
+    out.resize(trackItems.size());
+
+    uint k = 0;
+    for (TiIter it=trackItems.begin(); it != trackItems.end(); ++it, ++k)
+    {
+        const TrackItem& ti = **it;
+        TrackOutput& o = out[k];
+
+        o.id = ti.id;
+        o.rect = ti.dRect;
+        o.detection = ti.detection;
+        o.numActiveFrames = ti.numActiveFrames;
+        o.numInactiveFrames = ti.numInactiveFrames;
+        o.active = ti.isActive();
+    }
+}
+
+/**
+ * Advance all items on a frame the detector is not run on: items follow
+ * their prediction only. Such a frame is not a missed detection, thus it
+ * neither counts toward NUM_MAX_INACTIVE_FRAMES nor drops any item.
+ *
+ * @param  double timestamp - of the frame in secs., < 0 if unknown
+ * @return void
+ */
+void Tracker::coast(double timestamp)
+{
+    typedef TrackTable::iterator TiIter;
+
+    CVIP_TIME(instr, FRAME);
+    CVIP_COUNT(instr, FRAMES, 1);
+
+    {
+        CVIP_TIME(instr, PREDICT);
+        kalmanBank.predict(frameDt(timestamp));
+    }
+    ++framesSinceDetection;
+
+    for (TiIter it=trackItems.begin(); it != trackItems.end(); ++it)
+    {
+        (*it)->coast();
+        (*it)->detection = -1;
+    }
+
+    endFrame();
+}
+
+/**
+ * Time step to predict this frame by: the time since the last
+ * timestamped frame (at most the model's maxDt), or one nominal frame
+ * if either timestamp is missing or time didn't advance.
+ *
+ * @param  double timestamp - of this frame in secs., < 0 if unknown
+ * @return float
+ */
+float Tracker::frameDt(double timestamp)
+{
+    const MotionModel& model = kalmanBank.getModel();
+    float dt = model.dt;
+
+    if (timestamp >= 0)
+    {
+        if (lastTimestamp >= 0 && timestamp > lastTimestamp)
+            dt = (float)std::min<double>(timestamp - lastTimestamp, model.maxDt);
+
+        lastTimestamp = timestamp;
+    }
+
+    return dt;
+}
+
+/**
+ * Count the frame and, if publishing, publish the state of all items.
+ * If readers still pin every snapshot buffer, this frame is not
+ * published; readers keep seeing the previous one.
+ *
+ * @return void
+ */
+void Tracker::endFrame()
+{
+    // for updateLate()
+    kalmanBank.record(numFrames);
+
+    ++numFrames;
+
+    if (!publishing)
+        return;
+
+    TrackSnapshot* snap = snapshots.edit();
+
+    if (!snap)
+        return;
+
+    snap->frame = numFrames;
+    snap->time = totalTime();
+    snap->tracks.reserve(reservedItems);
+    exportTracks(snap->tracks);
+
+    snapshots.publish();
+}
+
+/**
+ * Track on a frame: run the detector and update with its detections if
+ * detection is due, coast on predictions otherwise.
+ *
+ * @param  Mat& frame
+ * @param  double timestamp - of the frame in secs., < 0 if unknown
+ * @return void
+ */
+void Tracker::track(const cv::Mat& frame, double timestamp)
+{
+    if (detectionDue()) {
+        planDetection(frame.size(), rois);
+        std::vector<DetectionRect> detections = detect(frame, rois);
+        update(detections, timestamp);
+    } else {
+        coast(timestamp);
+    }
+}
+
+/**
+ * Track on a frame without waiting for the detector. The detections of
+ * a submitted frame update the items at the first frame after they are
+ * back, fused at the submitted frame if setLateDetections() reaches
+ * that far (see updateLate()); until then every frame coasts. One request is in flight at a
+ * time, and the next one is submitted once detection is due again,
+ * with regions planned from the updated items.
+ *
+ * @param  Mat& frame - shared with the detector until its result is back
+ * @param  double timestamp - of the frame in secs., < 0 if unknown
+ * @return void
+ */
+void Tracker::trackAsync(const cv::Mat& frame, double timestamp)
+{
+    if (pendingTicket && detector->poll(pendingTicket, asyncResult)) {
+        pendingTicket = 0;
+        updateLate(asyncResult.detections, asyncResult.frame, timestamp);
+    } else {
+        coast(timestamp);
+    }
+
+    if (pendingTicket || !detectionDue())
+        return;
+
+    Detector::Request request;
+    request.stream = streamId;
+    request.frame = numFrames-1;
+    request.timestamp = timestamp;
+    request.image = frame;
+    planDetection(frame.size(), request.rois);
+
+    pendingTicket = detector->submit(request);
+}
+
+/**
+ * Detection is due when detectionInterval frames have passed since the
+ * last one, or when the error covariance trace (the uncertainty) of a
+ * confirmed item exceeds maxUncertainty.
+ *
+ * @return bool
+ */
+bool Tracker::detectionDue() const
+{
+    if (framesSinceDetection+1 >= detectionInterval)
+        return true;
+
+    if (maxUncertainty <= 0)
+        return false;
+
+    typedef TrackTable::const_iterator TiIter;
+
+    for (TiIter it=trackItems.begin(); it != trackItems.end(); ++it)
+        if ((*it)->isActive() && (*it)->uncertainty() > maxUncertainty)
+            return true;
+
+    return false;
+}
+
+/**
+ * Take new detections and update the ones matched with the
+ * existing items. Matching is done by the associator, see
+ * Associator::associate(). Indices of the unmatched detections
+ * are kept in freeDetects.
+ *
+ * Items of this frame are flattened into frameItems, and
+ * flagActive[i] tells whether frameItems[i] is updated or not.
+ *
+ * @param  DetectionRect* freshDetects - incoming detections
+ * @param  uint numDetects
+ * @return void
+ */
+void Tracker::updateActiveItems(const DetectionRect* freshDetects, uint numDetects)
+{
+    // the table is dense already, but drops reorder it; keep this frame's items
+    frameItems.assign(trackItems.begin(), trackItems.end());
+    frameRects.clear();
+    frameIds.clear();
+
+    for (uint i=0; i<frameItems.size(); ++i) {
+        frameRects.push_back(&frameItems[i]->dRect);
+        frameIds.push_back(frameItems[i]->id);
+    }
+
+    flagActive.assign(frameItems.size(), 0);
+
+    // associate rects to items
+    {
+        CVIP_TIME(instr, ASSOCIATE);
+
+        if (associator.getGating() > 0)
+            makeGates();
+
+        associator.associate(freshDetects, numDetects, frameRects, assignment, &gates, &frameIds);
+    }
+
+    CVIP_TIME(instr, CORRECT);
+
+    // update matched items and list the unmatched detections
+    freeDetects.clear();
+    for (uint i=0; i<numDetects; ++i)
+    {
+        if (assignment[i] < 0)
+        {
+            freeDetects.push_back(i);
+            continue;
+        }
+
+        // freshDetects[i] is assumed to stand for the matched item
+        TrackItem* ti = frameItems[assignment[i]];
+        flagActive[assignment[i]] = 1;
+        ti->update(freshDetects[i]);
+        ti->detection = i;
+
+        // confirmed right now?
+        CVIP_COUNT(instr, TRACKS_CONFIRMED, ti->numActiveFrames == NUM_MIN_DETECTIONS+1);
+    }
+}
+
+/**
+ * As updateActiveItems(), with detections of an earlier frame: they are
+ * associated with the items as they were at that frame, and the items
+ * that didn't exist yet are flagged and coast. Gating is not applied,
+ * the gates are those of this frame.
+ *
+ * @param  DetectionRect* lateDetects
+ * @param  uint numDetects
+ * @param  unsigned long frame - of the detections, in the history of the bank
+ * @return void
+ */
+void Tracker::updateLateItems(const DetectionRect* lateDetects, uint numDetects, unsigned long frame)
+{
+    frameItems.assign(trackItems.begin(), trackItems.end());
+    flagActive.assign(frameItems.size(), 0);
+
+    lateItems.clear();
+    lateRects.resize(frameItems.size());
+
+    for (uint i=0; i<frameItems.size(); ++i)
+    {
+        TrackItem* ti = frameItems[i];
+        float r[KalmanBank::M];
+
+        // not there at frame, the detector couldn't see it
+        if (!ti->filterBank().coordAt(ti->filterSlot(), frame, r)) {
+            flagActive[i] = 1;
+            ti->coast();
+            ti->detection = -1;
+            continue;
+        }
+
+        DetectionRect& d = lateRects[lateItems.size()];
+        d.x1 = r[0];
+        d.y1 = r[1];
+        d.x2 = r[2];
+        d.y2 = r[3];
+        d.width = d.x2-d.x1;
+        d.height = d.y2-d.y1;
+
+        lateItems.push_back(i);
+    }
+
+    frameRects.clear();
+    frameIds.clear();
+    for (uint k=0; k<lateItems.size(); ++k) {
+        frameRects.push_back(&lateRects[k]);
+        frameIds.push_back(frameItems[lateItems[k]]->id);
+    }
+
+    {
+        CVIP_TIME(instr, ASSOCIATE);
+        associator.associate(lateDetects, numDetects, frameRects, assignment, 0, &frameIds);
+    }
+
+    CVIP_TIME(instr, CORRECT);
+
+    freeDetects.clear();
+    for (uint i=0; i<numDetects; ++i)
+    {
+        if (assignment[i] < 0)
+        {
+            freeDetects.push_back(i);
+            continue;
+        }
+
+        uint j = lateItems[assignment[i]];
+        TrackItem* ti = frameItems[j];
+        flagActive[j] = 1;
+
+        // measured at frame already: take it as this frame's
+        if (!ti->updateLate(frame, lateDetects[i]))
+            ti->update(lateDetects[i]);
+
+        ti->detection = i;
+
+        CVIP_COUNT(instr, TRACKS_CONFIRMED, ti->numActiveFrames == NUM_MIN_DETECTIONS+1);
+    }
+}
+
+/**
+ * Gates of frameItems for the associator: predicted rect and innovation
+ * variance of each filter. The filter's noise levels are smoothing
+ * knobs rather than pixel variances, only their ratios matter: the
+ * innovation variance over the measurement noise tells how much wider
+ * than the detector's noise the prediction is spread, in every
+ * coordinate of the model. The detector's noise is taken as a std s of
+ * gateRelStd times the track size on each corner. The corner models
+ * gate on the corners, each with s^2. The center model gates on center
+ * and size (its aspect ratio times height is the width), where that
+ * noise gives the center a variance of s^2/2 and the width and height
+ * 2*s^2, independently of each other, unlike its aspect ratio and
+ * height.
+ *
+ * @return void
+ */
+void Tracker::makeGates()
+{
+    bool centered = kalmanBank.getModel().centered();
+    float noiseVar = kalmanBank.getModel().measurementNoise;
+
+    gates.resize(frameItems.size());
+
+    for (uint i=0; i<frameItems.size(); ++i)
+    {
+        const TrackItem& ti = *frameItems[i];
+        const KalmanBank& bank = ti.filterBank();
+        uint slot = ti.filterSlot();
+
+        float noiseStd = gateRelStd*0.5f*(ti.dRect.width + ti.dRect.height);
+        float var = bank.innovationVar(slot)/noiseVar*noiseStd*noiseStd;
+
+        Associator::Gate& g = gates[i];
+
+        if (!centered)
+        {
+            for (uint k=0; k<4; ++k) {
+                g.z[k] = bank.position(slot, k);
+                g.var[k] = var;
+            }
+            continue;
+        }
+
+        g.z[0] = bank.position(slot, 0);
+        g.z[1] = bank.position(slot, 1);
+        g.z[2] = bank.position(slot, 2)*bank.position(slot, 3);
+        g.z[3] = bank.position(slot, 3);
+
+        g.var[0] = g.var[1] = 0.5f*var;
+        g.var[2] = g.var[3] = 2.f*var;
+    }
+}
+
+/**
+ * Change the motion model of the filters, the gates follow its
+ * coordinates.
+ *
+ * @param  MotionModel& model
+ * @return bool - false if any item is tracked
+ */
+bool Tracker::setMotionModel(const MotionModel& model)
+{
+    if (!kalmanBank.setModel(model))
+        return false;
+
+    associator.setCenteredGates(model.centered());
+    return true;
+}
+
+/**
+ * Update each item of frameItems that is not flagged in flagActive,
+ * i.e. not matched at this frame.
+ *
+ * @return void
+ */
+void Tracker::updateInactiveItems()
+{
+    CVIP_TIME(instr, DROP);
+
+    for (uint i=0; i<frameItems.size(); ++i)
+    {
+        // skip if item is active at this frame
+        if (flagActive[i])
+            continue;
+
+        frameItems[i]->detection = -1;
+
+        // drop item if it's inactive for long
+        if (!frameItems[i]->update())
+        {
+            drop(frameItems[i]->key);
+            CVIP_COUNT(instr, TRACKS_DROPPED, 1);
+        }
+    }
+}
+
+/**
+ * Add the detections listed in freeDetects as new TrackItems
+ *
+ * @param  DetectionRect* freshDetects - this frame's detections
+ * @return void
+ */
+void Tracker::addNewItems(const DetectionRect* freshDetects)
+{
+    CVIP_TIME(instr, BIRTH);
+    CVIP_COUNT(instr, TRACKS_CREATED, freeDetects.size());
+
+    for (uint k=0; k<freeDetects.size(); ++k)
+        add(freshDetects[freeDetects[k]])->detection = freeDetects[k];
+}
@@ -1,45 +1,180 @@
 #ifndef TRACKER_H
 #define TRACKER_H
 
+#include "Detector.h"
 #include "FaceDetector.h"
 #include "TrackItem.h"
-#include <map>
+#include "Associator.h"
+#include "KalmanBank.h"
+#include "ObjectPool.h"
+#include "SlotMap.h"
+#include "SnapshotBuffer.h"
+#ifdef CVIP_INSTRUMENTATION
+#include "Instruments.h"
+#endif
 
 namespace cvip
 {
+    class Instruments;
+
+    /**
+     * State of a track item after a frame, see Tracker::exportTracks().
+     */
+    struct TrackOutput
+    {
+        uint id;
+        cvip::DetectionRect rect;
+        int detection;                      //! index of the frame's detection that updated the item, -1 if none
+        uint numActiveFrames;
+        unsigned short numInactiveFrames;
+        bool active;                        //! see TrackItem::isActive()
+    };
+
+    /**
+     * Immutable view of all track items after a frame, see
+     * Tracker::snapshot().
+     */
+    struct TrackSnapshot
+    {
+        unsigned long frame;                //! frames run so far, this one included
+        double time;                        //! secs since the tracker started
+        std::vector<TrackOutput> tracks;
+    };
+
     /**
      * Tracker class written according to a "kind of" decorator pattern:
      * Take a detector and wrap it with this Tracker
      *
-     * @todo convert FaceDetector* to Detector* after Detectors are abstracted
-     * @todo include "Detector.h" rather than "FaceDetector.h" after abstraction
-     * @todo update totalTime()
+     * Any Detector backend will do (CascadeDetector wraps the cascade
+     * FaceDetector). track() detects in line; trackAsync() submits the
+     * frame to the detector and keeps predicting while it is in flight.
+     *
      * @author evangelos sariyanidi / sariyanidi[at]gmail[dot]com
      * @date april 2011
      */
     class Tracker
     {
     public:
+        // trackItems by key (TrackItem::key)
+        typedef cvip::SlotMap<cvip::TrackItem*> TrackTable;
 
-        // construct tracker using a detector
-        Tracker( cvip::FaceDetector* _detector ) : detector(_detector), tStart(cv::getTickCount()), numFrames(0) {}
+        // snapshots published for other threads
+        typedef cvip::SnapshotBuffer<cvip::TrackSnapshot> TrackSnapshots;
 
-        // in destructor delete detector and all track items
-        ~Tracker();
+        // construct tracker using a detector, deleted with the tracker if owned
+        Tracker( cvip::Detector* _detector, bool _ownsDetector = true );
 
-        // Track items on video
-        void onVideo();
+        // in destructor delete detector (if owned) and all track items
+        ~Tracker();
 
         // add/drop trackItems
-        void add(cvip::TrackItem* ti) { trackItems.insert(std::pair<uint, TrackItem*>(ti->id, ti)); }
-        void drop(uint id) { delete trackItems[id]; trackItems.erase(id); }
+        cvip::TrackItem* add(const cvip::DetectionRect& d);
+        void drop(uint key);
+
+        // run the detector on a frame
+        std::vector<DetectionRect> detect(const cv::Mat& frame);
+
+        // run the detector on regions of a frame, detections are in frame coordinates
+        std::vector<DetectionRect> detect(const cv::Mat& frame, const std::vector<cv::Rect>& rois);
+
+        // detect around items in rects enlarged by scale, full frame every n frames (scale 0 = off)
+        void setRoiDetection(float scale, uint n) { roiScale = scale; fullScanInterval = n ? n : 1; }
+
+        // regions to detect on in the next detected frame, empty for full frame
+        void planDetection(const cv::Size& frameSize, std::vector<cv::Rect>& rois);
+
+        // update trackItems with fresh detections, which are left untouched;
+        // timestamp of the frame in secs., < 0 = one nominal frame after the last
+        void update(const DetectionRect* freshDetects, uint numDetects, double timestamp = -1.);
+        void update(const std::vector<DetectionRect>& freshDetects, double timestamp = -1.)
+        { update(freshDetects.empty() ? 0 : &freshDetects[0], freshDetects.size(), timestamp); }
+
+        // update trackItems with fresh detections, the matched ones are removed from the vector
+        void updateWith(std::vector<DetectionRect>& freshDetects, double timestamp = -1.);
+
+        // run this frame with detections of an earlier frame (see nextFrame()), fused at
+        // that frame if it is within setLateDetections(), at this frame otherwise
+        void updateLate(const DetectionRect* lateDetects, uint numDetects, unsigned long frame, double timestamp = -1.);
+        void updateLate(const std::vector<DetectionRect>& lateDetects, unsigned long frame, double timestamp = -1.)
+        { updateLate(lateDetects.empty() ? 0 : &lateDetects[0], lateDetects.size(), frame, timestamp); }
+
+        // index of the next frame to run, frames are counted from 0
+        unsigned long nextFrame() const { return numFrames; }
+
+        // state of all trackItems after the last frame
+        void exportTracks(std::vector<TrackOutput>& out) const;
+
+        // advance trackItems on a frame that is not run through the detector
+        void coast(double timestamp = -1.);
+
+        // detect on frame if due, otherwise coast
+        void track(const cv::Mat& frame, double timestamp = -1.);
+
+        // as track(), without waiting for the detector: frame is submitted if detection is due
+        // and its detections update the items once they are back (at the frame they were
+        // detected on, see setLateDetections()); frame must stay unchanged until then
+        // (clone it if the capture reuses its buffer)
+        void trackAsync(const cv::Mat& frame, double timestamp = -1.);
+
+        // is a trackAsync() request in flight?
+        bool detectionPending() const { return pendingTicket != 0; }
+
+        // stream of this tracker's detector requests, see Detector::Request
+        void setStreamId(uint id) { streamId = id; }
+
+        cvip::Detector* getDetector() { return detector; }
+
+        // motion model of new items, false if there are items already
+        bool setMotionModel(const cvip::MotionModel& model);
+        const cvip::MotionModel& motionModel() const { return kalmanBank.getModel(); }
 
-        // update trackItems with fresh detections
-        void updateWith(std::vector<DetectionRect>& freshDetects);
+        // converged tracks measured every nominal frame take the cached
+        // steady-state Kalman gain (off by default, see KalmanBank)
+        void setSteadyStateGain(bool on) { kalmanBank.setSteadyState(on); }
+
+        // keep the filter states of the last maxLag frames, so that detections up to
+        // maxLag frames late are fused at their frame (0 = off, the default)
+        void setLateDetections(uint maxLag) { kalmanBank.setHistory(maxLag); }
+        uint getLateDetections() const { return kalmanBank.getHistory(); }
+
+        // room for numItems track items and numDetects detections per frame,
+        // frames within these bounds allocate nothing
+        void reserve(uint numItems, uint numDetects);
+
+        // run the detector every k frames at least (1 = every frame)
+        void setDetectionInterval(uint k) { detectionInterval = k ? k : 1; }
+
+        // run the detector as soon as a track's uncertainty exceeds u (0 = never)
+        void setMaxUncertainty(float u) { maxUncertainty = u; }
+
+        // should the next frame go through the detector?
+        bool detectionDue() const;
+
+        // choose how detections are associated to trackItems
+        void setAssociationMode(Associator::Mode mode) { associator.setMode(mode); }
+
+        // gate pairs at chi2 (0 = off, see Associator::CHI2_4DOF_99), detection
+        // noise std of a corner being relStd times the track size
+        void setGating(float chi2, float relStd = 0.1f) { associator.setGating(chi2); gateRelStd = relStd; }
+
+        // publish a TrackSnapshot after every frame (off by default)
+        void setPublishing(bool on) { publishing = on; }
+
+        // pin the last published snapshot, from any thread and without
+        // blocking the tracker; get() is 0 if none was published
+        TrackSnapshots::Handle snapshot() const { return snapshots.acquire(); }
 
         // record regarding tracker
         uint numItems() const { return trackItems.size(); }
-        double totalTime() const { return (double)(cv::getTickCount()-tStart);/*/CLOCKS_PER_SEC*/; }
+        const TrackTable& items() const { return trackItems; }
+        double totalTime() const { return (cv::getTickCount()-tStart)/cv::getTickFrequency(); }
+
+        // step timers and track event counters, 0 if built without CVIP_INSTRUMENTATION
+#ifdef CVIP_INSTRUMENTATION
+        const cvip::Instruments* instruments() const { return &instr; }
+#else
+        const cvip::Instruments* instruments() const { return 0; }
+#endif
 
         //! @property allowed num of inactive frames, drop tracking if this number exceeded
         static const unsigned short NUM_MAX_INACTIVE_FRAMES = 20;
@@ -47,12 +182,75 @@ namespace cvip
         //! @property minimum number of detections before start to track an item
         static const unsigned short NUM_MIN_DETECTIONS = 3;
 
+        //! @property sides of detection regions are rounded up to this, so a region keeps its
+        //! size (and its scale space levels, see ScaleSpace) while its item moves
+        static const int ROI_ALIGN = 16;
+
     private:
         //! @property detector to detect objects
-        cvip::FaceDetector* detector;
+        cvip::Detector* detector;
+        bool ownsDetector;
+
+        //! @property trackAsync() request in flight (0 if none), its result, and this tracker's stream
+        cvip::Detector::Ticket pendingTicket;
+        cvip::Detector::Result asyncResult;
+        uint streamId;
+
+        //! @property detection schedule, see setDetectionInterval() and setMaxUncertainty()
+        uint detectionInterval;
+        float maxUncertainty;
+
+        //! @property frames coasted since the last detection
+        uint framesSinceDetection;
+
+        //! @property ROI detection, see setRoiDetection()
+        float roiScale;
+        uint fullScanInterval;
+
+        //! @property detected frames since the last full frame scan
+        uint framesSinceFullScan;
+
+        //! @property planDetection() output of track(), reused every frame
+        std::vector<cv::Rect> rois;
+
+        //! @property kalman filters of all trackItems, must outlive them
+        cvip::KalmanBank kalmanBank;
+
+        //! @property instance/id counters of this tracker's items
+        cvip::TrackCounters counters;
+
+        //! @property storage of trackItems
+        cvip::ObjectPool<cvip::TrackItem> itemPool;
 
         //! @property items being tracked -> associate each item with its id
-        std::map<uint, cvip::TrackItem*> trackItems;
+        TrackTable trackItems;
+
+        //! @property matches fresh detections to trackItems
+        cvip::Associator associator;
+
+        //! @property associator output, reused every frame
+        std::vector<int> assignment;
+
+        //! @property indices of this frame's detections that no item took
+        std::vector<uint> freeDetects;
+
+        //! @property gating noise, see setGating(), and the gates of this frame
+        float gateRelStd;
+        std::vector<cvip::Associator::Gate> gates;
+
+        //! @property items at the start of update(), their rects, ids and whether matched
+        std::vector<cvip::TrackItem*> frameItems;
+        std::vector<const cvip::DetectionRect*> frameRects;
+        std::vector<uint> frameIds;
+        std::vector<char> flagActive;
+
+        //! @property items that existed at the frame of late detections (indices of frameItems)
+        //! and their rects at that frame, see updateLate()
+        std::vector<uint> lateItems;
+        std::vector<cvip::DetectionRect> lateRects;
+
+        //! @property timestamp of the last frame that had one, < 0 if none
+        double lastTimestamp;
 
         //! @property tick count of Tracker initialization time
         unsigned long tStart;
@@ -60,11 +258,26 @@ namespace cvip
         //! @property total number of frames run
         unsigned long numFrames;
 
+        //! @property see setPublishing() and snapshot()
+        bool publishing;
+        TrackSnapshots snapshots;
+
+        //! @property see reserve()
+        uint reservedItems;
+
+#ifdef CVIP_INSTRUMENTATION
+        //! @property see instruments()
+        cvip::Instruments instr;
+#endif
+
         // see definition of Tracker::updateItems() for comments of these:
-        std::map<uint, bool>
-             updateActiveItems(std::vector<DetectionRect>& freshDetects);
-        void updateInactiveItems(const std::map<uint, bool>& flagUpdated);
-        void addNewItems(std::vector<DetectionRect>& freshDetects);
+        void updateActiveItems(const DetectionRect* freshDetects, uint numDetects);
+        void updateLateItems(const DetectionRect* lateDetects, uint numDetects, unsigned long frame);
+        void updateInactiveItems();
+        void makeGates();
+        void addNewItems(const DetectionRect* freshDetects);
+        float frameDt(double timestamp);
+        void endFrame();
     };
 }
 
@@ -0,0 +1,378 @@
+#include "TrackerPool.h"
+#include <algorithm>
+
+using namespace cvip;
+
+/**
+ * Start the worker threads.
+ *
+ * @param  uint numWorkers - 0 means one per hardware thread
+ */
+TrackerPool::TrackerPool(uint numWorkers) : numQueued(0), numPending(0), stop(false)
+{
+    if (numWorkers == 0)
+        numWorkers = std::max(1u, std::thread::hardware_concurrency());
+
+    for (uint i=0; i<numWorkers; ++i)
+        workers.push_back(new Worker);
+
+    for (uint i=0; i<numWorkers; ++i)
+        threads.push_back(std::thread(&TrackerPool::run, this, i));
+}
+
+/**
+ * Destructor
+ * Let pending frames finish, stop workers, delete all trackers.
+ */
+TrackerPool::~TrackerPool()
+{
+    wait();
+
+    {
+        std::lock_guard<std::mutex> lk(sleepLock);
+        stop = true;
+    }
+    wake.notify_all();
+
+    for (uint i=0; i<threads.size(); ++i)
+        threads[i].join();
+
+    for (uint i=0; i<workers.size(); ++i)
+        delete workers[i];
+
+    for (uint i=0; i<streams.size(); ++i)
+    {
+        delete streams[i]->tracker;
+        delete streams[i];
+    }
+}
+
+/**
+ * Host a tracker. Streams must be added before frames are submitted
+ * from other threads.
+ *
+ * @param  Tracker* tracker - owned by the pool from now on
+ * @return uint - stream id
+ */
+uint TrackerPool::addStream(Tracker* tracker)
+{
+    // tells the stream's requests apart in a shared detector
+    tracker->setStreamId(streams.size());
+
+    streams.push_back(new Stream(tracker));
+    return streams.size()-1;
+}
+
+/**
+ * Queue the detections of the next frame of a stream.
+ *
+ * @param  uint stream
+ * @param  vector<DetectionRect>& detections - copied
+ * @param  double timestamp - of the frame in secs., < 0 if unknown
+ * @return void
+ */
+void TrackerPool::submit(uint stream, const std::vector<DetectionRect>& detections, double timestamp)
+{
+    Frame f;
+    f.detections = detections;
+    f.timestamp = timestamp;
+    enqueue(stream, f);
+}
+
+/**
+ * Queue the next frame of a stream; a worker runs Tracker::track() on it,
+ * which detects or coasts as the tracker's detection schedule says.
+ * The pixel data is shared, not copied: pass a clone if the caller
+ * reuses the buffer (e.g. a VideoCapture frame).
+ *
+ * @param  uint stream
+ * @param  Mat& frame
+ * @param  double timestamp - of the frame in secs., < 0 if unknown
+ * @return void
+ */
+void TrackerPool::submit(uint stream, const cv::Mat& frame, double timestamp)
+{
+    Frame f;
+    f.image = frame;
+    f.timestamp = timestamp;
+    enqueue(stream, f);
+}
+
+/**
+ * Append frame to the pending frames of stream. The stream gets a task
+ * on its home worker unless it has one already; that task keeps
+ * rescheduling itself until the stream has no pending frame, so frames
+ * of a stream never run concurrently or out of order.
+ *
+ * @return void
+ */
+void TrackerPool::enqueue(uint stream, Frame& f)
+{
+    Stream& s = *streams[stream];
+    bool needTask = false;
+
+    f.tSubmit = cv::getTickCount();
+    ++numPending;
+
+    {
+        std::lock_guard<std::mutex> lk(s.lock);
+
+        s.pending.push_back(Frame());
+        Frame& queued = s.pending.back();
+        queued.detections.swap(f.detections);
+        queued.image = f.image;
+        queued.tSubmit = f.tSubmit;
+        queued.timestamp = f.timestamp;
+        queued.batchDetects = f.batchDetects;
+        queued.numBatchDetects = f.numBatchDetects;
+        queued.batchFrame = f.batchFrame;
+
+        if (!s.scheduled)
+            needTask = s.scheduled = true;
+    }
+
+    if (needTask)
+        schedule(stream, stream % workers.size());
+}
+
+/**
+ * Push a stream task to the back of a worker's deque and wake a worker.
+ *
+ * @return void
+ */
+void TrackerPool::schedule(uint stream, uint worker)
+{
+    {
+        std::lock_guard<std::mutex> lk(sleepLock);
+        ++numQueued;
+    }
+
+    {
+        std::lock_guard<std::mutex> lk(workers[worker]->lock);
+        workers[worker]->tasks.push_back(stream);
+    }
+
+    wake.notify_one();
+}
+
+/**
+ * Take the newest task of own deque; if it's empty steal the oldest
+ * task of another worker.
+ *
+ * @param  uint self - worker index
+ * @param  uint& stream - output
+ * @return bool - false if no task is found
+ */
+bool TrackerPool::popTask(uint self, uint& stream)
+{
+    uint n = workers.size();
+
+    for (uint k=0; k<n; ++k)
+    {
+        Worker& w = *workers[(self+k) % n];
+        std::lock_guard<std::mutex> lk(w.lock);
+
+        if (w.tasks.empty())
+            continue;
+
+        if (k == 0) {
+            stream = w.tasks.back();
+            w.tasks.pop_back();
+        } else {
+            stream = w.tasks.front();
+            w.tasks.pop_front();
+        }
+
+        --numQueued;
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * Worker thread: process tasks, sleep when there is none.
+ *
+ * @param  uint self - worker index
+ * @return void
+ */
+void TrackerPool::run(uint self)
+{
+    while (true)
+    {
+        uint stream;
+
+        if (popTask(self, stream)) {
+            process(stream, self);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lk(sleepLock);
+        wake.wait(lk, [this] { return stop || numQueued > 0; });
+
+        if (stop && numQueued == 0)
+            return;
+    }
+}
+
+/**
+ * Process the oldest pending frame of a stream and record its latency.
+ * Reschedule the stream on this worker if more frames are waiting.
+ *
+ * @param  uint stream
+ * @param  uint self - worker index
+ * @return void
+ */
+void TrackerPool::process(uint stream, uint self)
+{
+    Stream& s = *streams[stream];
+    Frame f;
+
+    {
+        std::lock_guard<std::mutex> lk(s.lock);
+
+        Frame& front = s.pending.front();
+        f.detections.swap(front.detections);
+        f.image = front.image;
+        f.tSubmit = front.tSubmit;
+        f.timestamp = front.timestamp;
+        f.batchDetects = front.batchDetects;
+        f.numBatchDetects = front.numBatchDetects;
+        f.batchFrame = front.batchFrame;
+        s.pending.pop_front();
+    }
+
+    // with an image, the tracker's detection schedule decides whether to detect;
+    // a batch frame leaves its tracks where updateBatch() collects them
+    if (f.batchFrame >= 0) {
+        s.tracker->update(f.batchDetects, f.numBatchDetects, f.timestamp);
+        s.tracker->exportTracks(batchTracks[f.batchFrame]);
+    } else if (!f.image.empty()) {
+        s.tracker->track(f.image, f.timestamp);
+    } else {
+        s.tracker->update(f.detections, f.timestamp);
+    }
+
+    int64 tDone = cv::getTickCount();
+    double latency = (tDone - f.tSubmit)/cv::getTickFrequency();
+    bool more;
+
+    {
+        std::lock_guard<std::mutex> lk(s.lock);
+
+        if (s.numFrames++ == 0)
+            s.tFirst = f.tSubmit;
+
+        s.tLast = tDone;
+        s.sumLatency += latency;
+        s.maxLatency = std::max(s.maxLatency, latency);
+
+        more = !s.pending.empty();
+        if (!more)
+            s.scheduled = false;
+    }
+
+    if (more)
+        schedule(stream, self);
+
+    if (--numPending == 0)
+    {
+        std::lock_guard<std::mutex> lk(sleepLock);
+        idle.notify_all();
+    }
+}
+
+/**
+ * Block until every submitted frame is processed.
+ *
+ * @return void
+ */
+void TrackerPool::wait()
+{
+    std::unique_lock<std::mutex> lk(sleepLock);
+    idle.wait(lk, [this] { return numPending == 0; });
+}
+
+/**
+ * Run a batch of frames in one call and block until they, as well as
+ * any frame submitted before, are done.
+ * Frames of different streams run in parallel on the workers; frames
+ * of a stream run in batch order, after the frames submitted to it
+ * before. Detections are read in place, not copied or modified.
+ *
+ * The tracks of every item of its stream after frame k (see
+ * Tracker::exportTracks()) are written to
+ * tracks[trackOffsets[k]..trackOffsets[k+1]). If the returned total
+ * exceeds capacity, only the first capacity tracks are written, yet
+ * trackOffsets is complete. Call from one thread at a time.
+ *
+ * @param  uint* frameStreams - numFrames stream ids
+ * @param  uint numFrames
+ * @param  DetectionRect* detections - all detections, frame after frame
+ * @param  uint* offsets - numFrames+1 offsets into detections
+ * @param  TrackOutput* tracks - output
+ * @param  uint capacity - size of tracks
+ * @param  uint* trackOffsets - output, numFrames+1 offsets into tracks
+ * @param  double* timestamps - numFrames timestamps in secs., or 0
+ * @return uint - number of tracks of all frames
+ */
+uint TrackerPool::updateBatch(const uint* frameStreams, uint numFrames,
+                              const DetectionRect* detections, const uint* offsets,
+                              TrackOutput* tracks, uint capacity, uint* trackOffsets,
+                              const double* timestamps)
+{
+    // never shrink, the buffers of the frames are reused by the next batches
+    if (batchTracks.size() < numFrames)
+        batchTracks.resize(numFrames);
+
+    for (uint k=0; k<numFrames; ++k)
+    {
+        Frame f;
+        f.batchDetects = detections + offsets[k];
+        f.numBatchDetects = offsets[k+1] - offsets[k];
+        f.batchFrame = k;
+        f.timestamp = timestamps ? timestamps[k] : -1.;
+        enqueue(frameStreams[k], f);
+    }
+
+    wait();
+
+    uint total = 0;
+
+    for (uint k=0; k<numFrames; ++k)
+    {
+        const std::vector<TrackOutput>& ft = batchTracks[k];
+
+        trackOffsets[k] = total;
+
+        for (uint i=0; i<ft.size(); ++i, ++total)
+            if (total < capacity)
+                tracks[total] = ft[i];
+    }
+
+    trackOffsets[numFrames] = total;
+
+    return total;
+}
+
+/**
+ * Throughput and latency records of a stream.
+ *
+ * @param  uint stream
+ * @return StreamStats
+ */
+TrackerPool::StreamStats TrackerPool::stats(uint stream) const
+{
+    const Stream& s = *streams[stream];
+    std::lock_guard<std::mutex> lk(s.lock);
+
+    StreamStats st;
+    st.numFrames = s.numFrames;
+    st.meanLatency = s.numFrames ? s.sumLatency/s.numFrames : 0.;
+    st.maxLatency = s.maxLatency;
+
+    double elapsed = (s.tLast - s.tFirst)/cv::getTickFrequency();
+    st.fps = elapsed > 0 ? s.numFrames/elapsed : 0.;
+
+    return st;
+}
@@ -0,0 +1,159 @@
+#ifndef TRACKERPOOL_H
+#define TRACKERPOOL_H
+
+#include "Tracker.h"
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+namespace cvip
+{
+    /**
+     * Runtime hosting many independent Trackers, one per video stream.
+     * Frames submitted to a stream are processed (Tracker::track() if
+     * an image is given, which detects when detection is due, otherwise
+     * Tracker::update() with the submitted detections, which are left
+     * untouched) by a fixed pool of worker threads. Each worker has its
+     * own task deque and steals from the others when it runs dry. A
+     * stream is processed by one worker at a time and its frames are
+     * processed in submission order.
+     * updateBatch() runs many frames of many streams in one call, e.g.
+     * the output of a batched detector, reading the detections in place
+     * and writing the tracks after each frame to caller buffers.
+     *
+     * @author evangelos sariyanidi / sariyanidi[at]gmail[dot]com
+     * @date april 2011
+     */
+    class TrackerPool
+    {
+    public:
+        /**
+         * Throughput and latency record of a stream. Latency is measured
+         * from submit() to the end of tracking, in secs.
+         */
+        struct StreamStats
+        {
+            unsigned long numFrames;
+            double meanLatency;
+            double maxLatency;
+            double fps;
+        };
+
+        // start numWorkers threads, 0 = one per hardware thread
+        TrackerPool(uint numWorkers = 0);
+
+        // finish pending frames, stop workers and delete all trackers
+        ~TrackerPool();
+
+        // host a tracker (ownership is taken), return its stream id
+        uint addStream(cvip::Tracker* tracker);
+
+        // queue detections of the next frame of a stream, timestamp in secs. (< 0 = unknown)
+        void submit(uint stream, const std::vector<DetectionRect>& detections, double timestamp = -1.);
+
+        // queue the next frame of a stream, Tracker::track() runs on the workers
+        void submit(uint stream, const cv::Mat& frame, double timestamp = -1.);
+
+        // block until every submitted frame is processed
+        void wait();
+
+        // run numFrames frames in one call, in parallel across streams: frame k
+        // belongs to stream frameStreams[k], its detections are
+        // detections[offsets[k]..offsets[k+1]) and the tracks after it go to
+        // tracks[trackOffsets[k]..trackOffsets[k+1]); return the number of tracks;
+        // timestamps of the frames in secs. are optional
+        uint updateBatch(const uint* frameStreams, uint numFrames,
+                         const DetectionRect* detections, const uint* offsets,
+                         TrackOutput* tracks, uint capacity, uint* trackOffsets,
+                         const double* timestamps = 0);
+
+        // records regarding a stream
+        StreamStats stats(uint stream) const;
+        uint numStreams() const { return streams.size(); }
+
+        // hosted tracker, don't touch it while its frames are pending (snapshot() excepted)
+        cvip::Tracker& tracker(uint stream) { return *streams[stream]->tracker; }
+
+    private:
+        //! a queued frame
+        struct Frame
+        {
+            Frame() : timestamp(-1.), batchDetects(0), numBatchDetects(0), batchFrame(-1) {}
+
+            std::vector<DetectionRect> detections;
+            cv::Mat image;
+            int64 tSubmit;
+            double timestamp;
+
+            //! frame k of updateBatch(): its detections, read in place
+            const DetectionRect* batchDetects;
+            uint numBatchDetects;
+            int batchFrame;
+        };
+
+        //! a hosted tracker with its pending frames and records
+        struct Stream
+        {
+            Stream(cvip::Tracker* _tracker) : tracker(_tracker), scheduled(false),
+                numFrames(0), sumLatency(0), maxLatency(0), tFirst(0), tLast(0) {}
+
+            cvip::Tracker* tracker;
+
+            mutable std::mutex lock;
+            std::deque<Frame> pending;
+
+            //! @property true while a task for this stream is queued or running
+            bool scheduled;
+
+            unsigned long numFrames;
+            double sumLatency, maxLatency;
+            int64 tFirst, tLast;
+        };
+
+        //! a worker's task deque: owner pops at the back, thieves at the front
+        struct Worker
+        {
+            std::mutex lock;
+            std::deque<uint> tasks;
+        };
+
+        // queue frame f of stream
+        void enqueue(uint stream, Frame& f);
+
+        // put stream task on a worker's deque
+        void schedule(uint stream, uint worker);
+
+        // take a task from own deque or steal one
+        bool popTask(uint self, uint& stream);
+
+        // worker thread body
+        void run(uint self);
+
+        // process the oldest pending frame of a stream
+        void process(uint stream, uint self);
+
+        std::vector<Stream*> streams;
+        std::vector<Worker*> workers;
+        std::vector<std::thread> threads;
+
+        //! @property guards sleeping workers and waiters
+        std::mutex sleepLock;
+        std::condition_variable wake, idle;
+
+        //! @property tasks sitting in deques
+        std::atomic<unsigned long> numQueued;
+
+        //! @property frames submitted but not yet processed
+        std::atomic<unsigned long> numPending;
+
+        std::atomic<bool> stop;
+
+        //! @property tracks after each frame of the running updateBatch(), kept between calls
+        std::vector<std::vector<cvip::TrackOutput> > batchTracks;
+    };
+}
+
+#endif // TRACKERPOOL_H
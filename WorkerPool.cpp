@@ -0,0 +1,139 @@
+#include "WorkerPool.h"
+#include <algorithm>
+
+using namespace cvip;
+
+const uint WorkerPool::MAX_SHARED_THREADS;
+
+/**
+ * Constructor
+ * Start the workers, they sleep until the first run().
+ *
+ * @param  uint numWorkers - 0 = one per hardware thread besides the caller
+ */
+WorkerPool::WorkerPool(uint numWorkers)
+    : job(0), numJobs(0), next(0), numDone(0), generation(0), stop(false)
+{
+    if (numWorkers == 0)
+        numWorkers = std::max(1u, std::thread::hardware_concurrency()) - 1;
+
+    for (uint i=0; i<numWorkers; ++i)
+        threads.push_back(std::thread(&WorkerPool::work, this));
+}
+
+/**
+ * Destructor
+ * Wake the workers and wait for them to leave.
+ */
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lk(lock);
+        stop = true;
+    }
+    wake.notify_all();
+
+    for (uint i=0; i<threads.size(); ++i)
+        threads[i].join();
+}
+
+/**
+ * Run a parallel loop: jobs are taken one at a time, in index order, by
+ * whichever thread is free. Every worker joins every run, so when run()
+ * returns no worker can still hold a job of it. A single job, or a pool
+ * without workers, runs on the calling thread only.
+ *
+ * @param  uint numJobs
+ * @param  function<void(uint)>& job - called with 0..numJobs-1
+ * @return void
+ */
+void WorkerPool::run(uint numJobs, const std::function<void(uint)>& job)
+{
+    if (numJobs == 0)
+        return;
+
+    if (numJobs == 1 || threads.empty())
+    {
+        for (uint i=0; i<numJobs; ++i)
+            job(i);
+        return;
+    }
+
+    std::lock_guard<std::mutex> runLk(runLock);
+
+    {
+        std::lock_guard<std::mutex> lk(lock);
+        this->job = &job;
+        this->numJobs = numJobs;
+        next = 0;
+        numDone = 0;
+        ++generation;
+    }
+    wake.notify_all();
+
+    drain(&job, numJobs);
+
+    std::unique_lock<std::mutex> lk(lock);
+    while (numDone < threads.size())
+        done.wait(lk);
+
+    this->job = 0;
+}
+
+/**
+ * Worker thread body: sleep until a run starts, help with it, report.
+ *
+ * @return void
+ */
+void WorkerPool::work()
+{
+    unsigned long seen = 0;
+
+    for (;;)
+    {
+        const std::function<void(uint)>* fn;
+        uint n;
+
+        {
+            std::unique_lock<std::mutex> lk(lock);
+            while (!stop && generation == seen)
+                wake.wait(lk);
+
+            if (stop)
+                return;
+
+            seen = generation;
+            fn = job;
+            n = numJobs;
+        }
+
+        drain(fn, n);
+
+        std::lock_guard<std::mutex> lk(lock);
+        if (++numDone == threads.size())
+            done.notify_one();
+    }
+}
+
+/**
+ * Take jobs of the running loop until none is left.
+ *
+ * @return void
+ */
+void WorkerPool::drain(const std::function<void(uint)>* fn, uint n)
+{
+    for (uint i=next++; i<n; i=next++)
+        (*fn)(i);
+}
+
+/**
+ * The pool the scale spaces and the face aligner share, started on
+ * first use with up to MAX_SHARED_THREADS threads (the caller included).
+ *
+ * @return WorkerPool&
+ */
+WorkerPool& WorkerPool::shared()
+{
+    static WorkerPool pool(std::min(MAX_SHARED_THREADS, std::max(1u, std::thread::hardware_concurrency())) - 1);
+    return pool;
+}
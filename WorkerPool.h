@@ -0,0 +1,77 @@
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+namespace cvip
+{
+    /**
+     * Fixed set of threads that run the jobs of a parallel loop: run()
+     * hands out job indices to the workers and to the calling thread and
+     * returns when all are done. The threads are started once and sleep
+     * between runs, so a loop that runs every frame costs no thread
+     * creation. One run() at a time; concurrent callers take turns, and a
+     * job must not call run() on its own pool.
+     *
+     * @author evangelos sariyanidi / sariyanidi[at]gmail[dot]com
+     * @date april 2011
+     */
+    class WorkerPool
+    {
+    public:
+        // start numWorkers threads, 0 = one per hardware thread besides the caller
+        WorkerPool(uint numWorkers = 0);
+
+        // stop the workers
+        ~WorkerPool();
+
+        // run job(0), ..., job(numJobs-1) on the workers and the calling thread
+        void run(uint numJobs, const std::function<void(uint)>& job);
+
+        // threads a run() spreads over, the caller included
+        uint numThreads() const { return threads.size() + 1; }
+
+        // pool shared by the scale spaces and Aligner::alignBatch(), MAX_SHARED_THREADS threads at most
+        static WorkerPool& shared();
+
+        static const uint MAX_SHARED_THREADS = 8;
+
+    private:
+        // not copyable, it owns threads
+        WorkerPool(const WorkerPool&);
+        WorkerPool& operator=(const WorkerPool&);
+
+        // worker thread body
+        void work();
+
+        // take jobs of the running loop until none is left
+        void drain(const std::function<void(uint)>* fn, uint n);
+
+        std::vector<std::thread> threads;
+
+        //! @property guards the fields of the running loop; wake starts it, done ends it
+        std::mutex lock;
+        std::condition_variable wake, done;
+
+        //! @property one run() at a time
+        std::mutex runLock;
+
+        //! @property the running loop: its jobs, the next job index, workers through with it
+        const std::function<void(uint)>* job;
+        uint numJobs;
+        std::atomic<uint> next;
+        uint numDone;
+
+        //! @property counts runs, a worker joins each one once
+        unsigned long generation;
+
+        bool stop;
+    };
+}
+
+#endif // WORKERPOOL_H
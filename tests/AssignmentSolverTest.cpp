@@ -0,0 +1,286 @@
+#include "AssignmentSolver.h"
+#include "Associator.h"
+#include <cmath>
+#include <iostream>
+#include <random>
+
+/**
+ * AssignmentSolver and HUNGARIAN association against brute force on
+ * small random problems, square and rectangular: the dense solve must
+ * find the cheapest full assignment, and the sparse solve, whose pairs
+ * that are not candidates are infeasible, the most candidate pairs and
+ * the cheapest of those matchings. Association must match the most
+ * detection/track pairs that overlap more than MIN_OVERLAP, and of
+ * those the most overlapping matching, with the grid and without.
+ * Greedy association must give equal overlaps to the track of the
+ * lowest id.
+ *
+ * @author evangelos sariyanidi / sariyanidi[at]gmail[dot]com
+ * @date april 2011
+ */
+
+static const uint NUM_TRIALS = 2000;
+static const uint MAX_SIZE = 6;
+
+// cost of pairs that are not candidates
+static const double MISSING_COST = 1e6;
+
+//! best matching found so far: most pairs, then least cost
+struct Best
+{
+    uint numPairs;
+    double cost;
+};
+
+/**
+ * Try every matching of rows r.. to the columns not used yet; pairs
+ * with isPair 0 are never taken.
+ *
+ * @return void
+ */
+static void bruteForce(const std::vector<double>& costs, const std::vector<char>& isPair, uint numRows,
+                       uint numCols, uint r, std::vector<char>& usedCols, uint numPairs, double cost, Best& best)
+{
+    if (r == numRows)
+    {
+        if (numPairs > best.numPairs || (numPairs == best.numPairs && cost < best.cost)) {
+            best.numPairs = numPairs;
+            best.cost = cost;
+        }
+        return;
+    }
+
+    // row r left out
+    bruteForce(costs, isPair, numRows, numCols, r+1, usedCols, numPairs, cost, best);
+
+    for (uint c=0; c<numCols; ++c)
+    {
+        if (usedCols[c] || !isPair[r*numCols+c])
+            continue;
+
+        usedCols[c] = 1;
+        bruteForce(costs, isPair, numRows, numCols, r+1, usedCols, numPairs+1, cost + costs[r*numCols+c], best);
+        usedCols[c] = 0;
+    }
+}
+
+// best matching of a problem, by brute force
+static Best bruteForce(const std::vector<double>& costs, const std::vector<char>& isPair, uint numRows, uint numCols)
+{
+    Best best = { 0, 0. };
+    std::vector<char> usedCols(numCols, 0);
+
+    bruteForce(costs, isPair, numRows, numCols, 0, usedCols, 0, 0., best);
+
+    return best;
+}
+
+/**
+ * Pairs and cost of an assignment; false if it takes a column twice or
+ * a pair that is not allowed.
+ *
+ * @return bool
+ */
+static bool evaluate(const std::vector<int>& rowAssignment, const std::vector<double>& costs,
+                     const std::vector<char>& isPair, uint numRows, uint numCols, Best& result)
+{
+    std::vector<char> usedCols(numCols, 0);
+    result.numPairs = 0;
+    result.cost = 0.;
+
+    if (rowAssignment.size() != numRows)
+        return false;
+
+    for (uint r=0; r<numRows; ++r)
+    {
+        int c = rowAssignment[r];
+        if (c < 0)
+            continue;
+
+        if (c >= (int)numCols || usedCols[c] || !isPair[r*numCols+c])
+            return false;
+
+        usedCols[c] = 1;
+        ++result.numPairs;
+        result.cost += costs[r*numCols+c];
+    }
+
+    return true;
+}
+
+static bool same(const Best& a, const Best& b, double tolerance)
+{
+    return a.numPairs == b.numPairs && std::fabs(a.cost - b.cost) <= tolerance;
+}
+
+/**
+ * Dense and sparse solves of random problems; a pair is a candidate
+ * with probability density, its cost uniform in [0, 1).
+ *
+ * @return uint - number of wrong solves
+ */
+static uint solverTrials(double density)
+{
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<double> uniform(0., 1.);
+
+    cvip::AssignmentSolver solver;
+    std::vector<int> rowAssignment;
+    uint numWrong = 0;
+
+    for (uint t=0; t<NUM_TRIALS; ++t)
+    {
+        uint numRows = 1 + rng() % MAX_SIZE, numCols = 1 + rng() % MAX_SIZE;
+
+        std::vector<double> costs(numRows*numCols);
+        std::vector<char> isPair(numRows*numCols), all(numRows*numCols, 1);
+        std::vector<uint> candStart(1, 0), candCol;
+        std::vector<double> candCost;
+
+        for (uint r=0; r<numRows; ++r)
+        {
+            for (uint c=0; c<numCols; ++c)
+            {
+                costs[r*numCols+c] = uniform(rng);
+                isPair[r*numCols+c] = uniform(rng) < density;
+
+                if (isPair[r*numCols+c]) {
+                    candCol.push_back(c);
+                    candCost.push_back(costs[r*numCols+c]);
+                }
+            }
+
+            candStart.push_back(candCol.size());
+        }
+
+        Best result;
+
+        solver.solve(costs, numRows, numCols, rowAssignment);
+        if (!evaluate(rowAssignment, costs, all, numRows, numCols, result)
+            || !same(result, bruteForce(costs, all, numRows, numCols), 1e-9))
+        {
+            std::cerr << "dense solve of " << numRows << "x" << numCols << " not optimal" << std::endl;
+            ++numWrong;
+        }
+
+        solver.solve(numRows, numCols, candStart, candCol, candCost, MISSING_COST, rowAssignment);
+        if (!evaluate(rowAssignment, costs, isPair, numRows, numCols, result)
+            || !same(result, bruteForce(costs, isPair, numRows, numCols), 1e-9))
+        {
+            std::cerr << "sparse solve of " << numRows << "x" << numCols << " not optimal" << std::endl;
+            ++numWrong;
+        }
+    }
+
+    return numWrong;
+}
+
+/**
+ * HUNGARIAN association of random rects crowded in a small area, all
+ * pairs scored or through the grid. Costs are 1 - overlap as the
+ * associator takes them; the kernel scores in float.
+ *
+ * @return uint - number of wrong associations
+ */
+static uint associatorTrials(bool grid)
+{
+    std::mt19937 rng(5);
+
+    cvip::Associator associator(cvip::Associator::HUNGARIAN);
+    associator.setMinGridPairs(grid ? 0 : 1000000);
+
+    std::vector<int> assignment;
+    uint numWrong = 0;
+
+    for (uint t=0; t<NUM_TRIALS; ++t)
+    {
+        uint numDetects = 1 + rng() % MAX_SIZE, numTracks = 1 + rng() % MAX_SIZE;
+
+        std::vector<cvip::DetectionRect> detects, trackRects;
+        for (uint i=0; i<numDetects; ++i)
+            detects.push_back(cvip::DetectionRect(rng() % 60, rng() % 60, 20 + rng() % 30, 20 + rng() % 30));
+        for (uint j=0; j<numTracks; ++j)
+            trackRects.push_back(cvip::DetectionRect(rng() % 60, rng() % 60, 20 + rng() % 30, 20 + rng() % 30));
+
+        std::vector<const cvip::DetectionRect*> tracks;
+        for (uint j=0; j<numTracks; ++j)
+            tracks.push_back(&trackRects[j]);
+
+        std::vector<double> costs(numDetects*numTracks);
+        std::vector<char> isPair(numDetects*numTracks);
+
+        for (uint i=0; i<numDetects; ++i)
+            for (uint j=0; j<numTracks; ++j)
+            {
+                double overlap = cvip::Associator::overlap(detects[i], trackRects[j]);
+                costs[i*numTracks+j] = 1.-overlap;
+                isPair[i*numTracks+j] = overlap > cvip::Associator::MIN_OVERLAP;
+            }
+
+        associator.associate(detects, tracks, assignment);
+
+        Best result;
+        if (!evaluate(assignment, costs, isPair, numDetects, numTracks, result)
+            || !same(result, bruteForce(costs, isPair, numDetects, numTracks), 1e-4))
+        {
+            std::cerr << "association of " << numDetects << " detections to " << numTracks
+                      << " tracks not optimal" << (grid ? " (grid)" : "") << std::endl;
+            ++numWrong;
+        }
+    }
+
+    return numWrong;
+}
+
+/**
+ * A detection overlapping two tracks equally goes to the one of the
+ * lowest id, or of the lowest index without ids.
+ *
+ * @return uint - number of wrong associations
+ */
+static uint greedyTies()
+{
+    cvip::Associator associator(cvip::Associator::GREEDY);
+
+    std::vector<cvip::DetectionRect> detects(1, cvip::DetectionRect(10, 10, 40, 40));
+    std::vector<cvip::DetectionRect> trackRects(2, cvip::DetectionRect(12, 12, 40, 40));
+    std::vector<const cvip::DetectionRect*> tracks;
+    tracks.push_back(&trackRects[0]);
+    tracks.push_back(&trackRects[1]);
+
+    std::vector<uint> ids(2);
+    std::vector<int> assignment;
+    uint numWrong = 0;
+
+    ids[0] = 7;
+    ids[1] = 3;
+    associator.associate(detects, tracks, assignment, 0, &ids);
+    numWrong += assignment[0] != 1;
+
+    ids[0] = 3;
+    ids[1] = 7;
+    associator.associate(detects, tracks, assignment, 0, &ids);
+    numWrong += assignment[0] != 0;
+
+    associator.associate(detects, tracks, assignment);
+    numWrong += assignment[0] != 0;
+
+    if (numWrong)
+        std::cerr << "greedy ties not broken on the lowest id" << std::endl;
+
+    return numWrong;
+}
+
+int main()
+{
+    uint numWrong = solverTrials(0.3) + solverTrials(0.7) + solverTrials(1.)
+        + associatorTrials(false) + associatorTrials(true) + greedyTies();
+
+    if (numWrong) {
+        std::cerr << numWrong << " assignments off the brute force optimum" << std::endl;
+        return 1;
+    }
+
+    std::cout << "assignment against brute force: ok" << std::endl;
+    return 0;
+}
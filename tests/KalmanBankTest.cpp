@@ -0,0 +1,133 @@
+#include "KalmanBank.h"
+#include "KalmanFilter.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+/**
+ * KalmanBank against the full-matrix KalmanFilter: for each motion
+ * model, a few tracks run through nominal and long frame intervals and
+ * missed detections, and after every frame the state and covariance of
+ * each slot must be those of a KalmanFilter of the same model, up to
+ * float rounding.
+ *
+ * @author evangelos sariyanidi / sariyanidi[at]gmail[dot]com
+ * @date april 2011
+ */
+
+static const uint NUM_TRACKS = 5;
+static const uint NUM_FRAMES = 300;
+
+// every LONG_EVERY-th frame comes LONG_STEP nominal intervals after the previous one;
+// every MISS_EVERY-th frame has no detections
+static const uint LONG_EVERY = 7, MISS_EVERY = 11;
+static const float LONG_STEP = 1.5f;
+
+// are a and b equal up to float rounding?
+static bool close(float a, float b)
+{
+    return std::fabs(a-b) <= 1e-3f*std::max(1.f, std::fabs(b));
+}
+
+// largest mismatch count over the run of the bank against filters of models nominal and long
+template <unsigned int N>
+static uint compare(const cvip::MotionModel& model, const cvip::KalmanModel<N, 4>& nominal,
+                    const cvip::KalmanModel<N, 4>& longStep)
+{
+    typedef cvip::KalmanFilter<N, 4> Filter;
+    const uint M = cvip::KalmanBank::M;
+
+    cvip::KalmanBank bank(model);
+    std::vector<Filter> filters;
+    std::vector<uint> slots;
+    std::mt19937 rng(3);
+
+    for (uint t=0; t<NUM_TRACKS; ++t)
+    {
+        cvip::DetectionRect d(100 + 50*t, 80 + 30*t, 40 + 5*t, 50 + 4*t);
+        slots.push_back(bank.alloc(d));
+
+        // filters start where the bank does: at the measurement, identity covariance
+        Filter f(nominal);
+        bank.measure(d, f.x);
+        filters.push_back(f);
+    }
+
+    uint numWrong = 0;
+
+    for (uint frame=1; frame<NUM_FRAMES; ++frame)
+    {
+        bool isLong = frame % LONG_EVERY == 0;
+        bank.predict(isLong ? LONG_STEP*model.dt : model.dt);
+
+        for (uint t=0; t<NUM_TRACKS; ++t)
+        {
+            // the models are shared by reference: take the one of this step
+            Filter f(isLong ? longStep : nominal);
+            std::copy(filters[t].x, filters[t].x+N, f.x);
+            std::copy(&filters[t].P[0][0], &filters[t].P[0][0]+N*N, &f.P[0][0]);
+
+            f.predict();
+
+            if (frame % MISS_EVERY != 0)
+            {
+                int jitter = (int)(rng() % 5) - 2;
+                cvip::DetectionRect d(100 + 50*t + 2*frame + jitter, 80 + 30*t + frame, 40 + 5*t + frame/20, 50 + 4*t + frame/20);
+
+                float z[M];
+                bank.measure(d, z);
+
+                bank.correct(slots[t], d);
+                f.correct(z);
+            }
+
+            filters[t] = f;
+
+            for (uint i=0; i<M; ++i)
+            {
+                uint s = slots[t];
+
+                if (!close(bank.position(s, i), f.x[i]) || !close(bank.velocity(s, i), f.x[M+i])
+                    || !close(bank.covPos(s), f.P[i][i]) || !close(bank.covPosVel(s), f.P[i][M+i])
+                    || !close(bank.covVel(s), f.P[M+i][M+i]))
+                    ++numWrong;
+            }
+        }
+    }
+
+    return numWrong;
+}
+
+int main()
+{
+    int failed = 0;
+
+    for (uint k=0; k<cvip::MotionModel::NUM_KINDS; ++k)
+    {
+        cvip::MotionModel model((cvip::MotionModel::Kind)k);
+
+        // the bank scales the process noise by the step over the nominal one
+        float dt = model.dt, q = model.processNoise, r = model.measurementNoise;
+        float longDt = LONG_STEP*dt, longQ = LONG_STEP*q;
+        uint numWrong;
+
+        if (model.kind == cvip::MotionModel::CORNER_VELOCITY)
+            numWrong = compare<8>(model, cvip::cornerVelocityModel(dt, q, r), cvip::cornerVelocityModel(longDt, longQ, r));
+        else if (model.kind == cvip::MotionModel::CENTER_SCALE_VELOCITY)
+            numWrong = compare<8>(model, cvip::centerScaleVelocityModel(dt, q, r), cvip::centerScaleVelocityModel(longDt, longQ, r));
+        else
+            numWrong = compare<12>(model, cvip::cornerAccelerationModel(dt, q, r), cvip::cornerAccelerationModel(longDt, longQ, r));
+
+        if (numWrong) {
+            std::cerr << cvip::MotionModel::name(model.kind) << ": " << numWrong
+                      << " coordinates off the full-matrix filter" << std::endl;
+            failed = 1;
+        }
+    }
+
+    if (!failed)
+        std::cout << "KalmanBank against KalmanFilter: ok" << std::endl;
+
+    return failed;
+}
@@ -0,0 +1,273 @@
+#include "KalmanBank.h"
+#include "Tracker.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <map>
+
+/**
+ * Late corrections against on-time ones: a measurement fused at its own
+ * frame by KalmanBank::correctLate() and replayed to the current frame
+ * must leave a slot where correcting it on time would have, up to float
+ * rounding, for measurements that arrive after or before the current
+ * frame's and for several late frames of a slot arriving out of order.
+ * Frames out of the history, slots born after the late frame and frames
+ * measured already are refused and change nothing. Tracker::updateLate()
+ * is checked the same way against update() and coast(), with an item
+ * born after the late frame, and with a frame out of the history, where
+ * it must do what update() does.
+ *
+ * @author evangelos sariyanidi / sariyanidi[at]gmail[dot]com
+ * @date april 2011
+ */
+
+static const uint HISTORY = 10;
+static const uint NUM_FRAMES = 70;
+
+// every LONG_EVERY-th frame comes LONG_STEP nominal intervals after the previous one
+static const uint LONG_EVERY = 7;
+static const float LONG_STEP = 1.5f;
+
+// are a and b equal up to float rounding?
+static bool close(float a, float b)
+{
+    return std::fabs(a-b) <= 1e-3f*std::max(1.f, std::fabs(b));
+}
+
+// detection of object k at frame f
+static cvip::DetectionRect detection(uint k, uint f)
+{
+    int jitter = (int)((f*7 + k*3) % 5) - 2;
+    return cvip::DetectionRect(100 + 120*k + 2*f + jitter, 80 + 60*k + f, 40 + 5*k + f/20, 50 + 4*k + f/20);
+}
+
+// do slots a of bank A and b of bank B hold the same state and covariance?
+static bool same(const cvip::KalmanBank& A, uint a, const cvip::KalmanBank& B, uint b)
+{
+    for (uint i=0; i<cvip::KalmanBank::M; ++i)
+        if (!close(B.position(b, i), A.position(a, i)) || !close(B.velocity(b, i), A.velocity(a, i))
+            || !close(B.acceleration(b, i), A.acceleration(a, i)))
+            return false;
+
+    return close(B.covPos(b), A.covPos(a)) && close(B.covPosVel(b), A.covPosVel(a))
+        && close(B.covVel(b), A.covVel(a)) && close(B.covAcc(b), A.covAcc(a));
+}
+
+/**
+ * Bank onTime corrects every slot at every frame; bank late holds some
+ * measurements back and fuses them later with correctLate():
+ *
+ *     slot 0: frame 20 arrives at frame 23, after that frame's correction
+ *     slot 1: frames 30 and 28 arrive at frame 32, in that order
+ *     slot 2: frame 40 arrives at frame 41, before that frame's correction
+ *     slot 3: born at frame 45, frame 44 is refused
+ *
+ * and at frame 60 a frame out of the history, the current frame and a
+ * frame measured already are refused. Both banks must agree whenever
+ * nothing is held back.
+ *
+ * @return uint - number of failed checks
+ */
+static uint bankLate(const cvip::MotionModel& model)
+{
+    cvip::KalmanBank onTime(model), late(model);
+    onTime.setHistory(HISTORY);
+    late.setHistory(HISTORY);
+
+    uint numSlots = 3;
+    for (uint k=0; k<numSlots; ++k) {
+        onTime.alloc(detection(k, 0));
+        late.alloc(detection(k, 0));
+    }
+
+    onTime.record(0);
+    late.record(0);
+
+    uint numFailed = 0;
+
+    for (uint f=1; f<NUM_FRAMES; ++f)
+    {
+        float dt = f % LONG_EVERY == 0 ? LONG_STEP*model.dt : model.dt;
+        onTime.predict(dt);
+        late.predict(dt);
+
+        if (f == 45)
+        {
+            uint a = onTime.alloc(detection(3, f)), b = late.alloc(detection(3, f));
+            ++numSlots;
+
+            if (late.correctLate(b, 44, detection(3, 44)) || !same(onTime, a, late, b)) {
+                std::cerr << "correctLate() took a frame before the slot was born" << std::endl;
+                ++numFailed;
+            }
+        }
+
+        if (f == 41 && !late.correctLate(2, 40, detection(2, 40)))
+            ++numFailed;
+
+        for (uint s=0; s<numSlots; ++s)
+        {
+            onTime.correct(s, detection(s, f));
+
+            bool held = (s == 0 && f == 20) || (s == 1 && (f == 28 || f == 30)) || (s == 2 && f == 40);
+            if (!held)
+                late.correct(s, detection(s, f));
+        }
+
+        if (f == 23 && !late.correctLate(0, 20, detection(0, 20)))
+            ++numFailed;
+
+        if (f == 32 && (!late.correctLate(1, 30, detection(1, 30)) || !late.correctLate(1, 28, detection(1, 28))))
+            ++numFailed;
+
+        if (f == 60)
+        {
+            if (late.correctLate(0, f-HISTORY-1, detection(0, f-HISTORY-1)) || late.correctLate(0, f, detection(0, f))
+                || late.correctLate(0, f-1, detection(0, f-1)))
+            {
+                std::cerr << "correctLate() took a frame out of the history or measured already" << std::endl;
+                ++numFailed;
+            }
+        }
+
+        onTime.record(f);
+        late.record(f);
+
+        bool pending = (f >= 20 && f < 23) || (f >= 28 && f < 32) || f == 40;
+        if (pending)
+            continue;
+
+        for (uint s=0; s<numSlots; ++s)
+            if (!same(onTime, s, late, s)) {
+                std::cerr << "slot " << s << " off its on-time state at frame " << f << std::endl;
+                ++numFailed;
+            }
+    }
+
+    return numFailed;
+}
+
+// detections of the objects seen at frame f: 0 and 1 all along, 2 from frame born on
+static std::vector<cvip::DetectionRect> detections(uint f, uint born)
+{
+    std::vector<cvip::DetectionRect> d;
+    for (uint k=0; k<3; ++k)
+        if (k < 2 || f >= born)
+            d.push_back(detection(k, f));
+
+    return d;
+}
+
+// do the items of A and B, by id, have the same filters?
+static bool sameItems(const cvip::Tracker& A, const cvip::Tracker& B)
+{
+    typedef cvip::Tracker::TrackTable::const_iterator TiIter;
+
+    std::map<uint, const cvip::TrackItem*> byId;
+    for (TiIter it=B.items().begin(); it != B.items().end(); ++it)
+        byId[(*it)->id] = *it;
+
+    if (byId.size() != A.items().size())
+        return false;
+
+    for (TiIter it=A.items().begin(); it != A.items().end(); ++it)
+    {
+        const cvip::TrackItem& a = **it;
+
+        if (!byId.count(a.id))
+            return false;
+
+        const cvip::TrackItem& b = *byId[a.id];
+        if (!same(a.filterBank(), a.filterSlot(), b.filterBank(), b.filterSlot()))
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * Tracker onTime takes every frame's detections but coasts at frame
+ * arrival; tracker late coasts at frame lateFrame and gets its
+ * detections with updateLate() at arrival instead. An item is born
+ * right after lateFrame and must just coast at arrival. A third pair
+ * checks that detections of a frame out of the history are taken as
+ * the current frame's.
+ *
+ * @return uint - number of failed checks
+ */
+static uint trackerLate(const cvip::MotionModel& model)
+{
+    const uint lateFrame = 25, arrival = 28, numFrames = 40;
+
+    cvip::Tracker onTime(0, false), late(0, false), updated(0, false), fallback(0, false);
+    cvip::Tracker* trackers[] = { &onTime, &late, &updated, &fallback };
+
+    for (uint t=0; t<4; ++t) {
+        trackers[t]->setMotionModel(model);
+        trackers[t]->setLateDetections(HISTORY);
+    }
+
+    uint numFailed = 0;
+
+    for (uint f=0; f<numFrames; ++f)
+    {
+        double timestamp = f*model.dt;
+        std::vector<cvip::DetectionRect> d = detections(f, lateFrame+1);
+
+        if (f == arrival) {
+            onTime.coast(timestamp);
+            late.updateLate(detections(lateFrame, lateFrame+1), lateFrame, timestamp);
+            updated.update(d, timestamp);
+            fallback.updateLate(d, f-HISTORY-1, timestamp);
+        } else {
+            if (f == lateFrame)
+                late.coast(timestamp);
+            else
+                late.update(d, timestamp);
+
+            onTime.update(d, timestamp);
+            updated.update(d, timestamp);
+            fallback.update(d, timestamp);
+        }
+
+        if ((f < lateFrame || f >= arrival) && !sameItems(onTime, late)) {
+            std::cerr << "updateLate() off the on-time update at frame " << f << std::endl;
+            ++numFailed;
+        }
+
+        if (!sameItems(updated, fallback)) {
+            std::cerr << "updateLate() out of the history is not update() at frame " << f << std::endl;
+            ++numFailed;
+        }
+    }
+
+    if (onTime.items().size() != 3) {
+        std::cerr << onTime.items().size() << " items tracked, 3 expected" << std::endl;
+        ++numFailed;
+    }
+
+    return numFailed;
+}
+
+int main()
+{
+    int failed = 0;
+
+    for (uint k=0; k<cvip::MotionModel::NUM_KINDS; ++k)
+    {
+        cvip::MotionModel model((cvip::MotionModel::Kind)k);
+
+        uint numFailed = bankLate(model) + trackerLate(model);
+
+        if (numFailed) {
+            std::cerr << cvip::MotionModel::name(model.kind) << ": " << numFailed
+                      << " late correction checks failed" << std::endl;
+            failed = 1;
+        }
+    }
+
+    if (!failed)
+        std::cout << "late corrections against on-time ones: ok" << std::endl;
+
+    return failed;
+}
@@ -0,0 +1,76 @@
+#include "SceneGenerator.h"
+#include <iostream>
+
+/**
+ * Seeded scenes are pinned: the hash of the truth and detections of a
+ * seeded scene of each motion must not change across machines, builds
+ * (-march=native or not) and releases. A new hash means old benchmark
+ * numbers no longer compare with new ones.
+ *
+ * @author evangelos sariyanidi / sariyanidi[at]gmail[dot]com
+ * @date april 2011
+ */
+
+// FNV-1a over the ids and rects of every frame, with a record of frame number only closing each frame
+static unsigned long long hashSequence(const cvip::MotSequence& s, unsigned long long h)
+{
+    for (uint f=0; f<s.numFrames(); ++f)
+    {
+        const std::vector<cvip::MotBox>& boxes = s.frame(f);
+
+        int values[6] = { (int)f, 0, 0, 0, 0, 0 };
+        for (uint i=0; i<=boxes.size(); ++i)
+        {
+            if (i < boxes.size()) {
+                const cvip::MotBox& b = boxes[i];
+                values[1] = b.id;
+                values[2] = b.rect.x1;
+                values[3] = b.rect.y1;
+                values[4] = b.rect.width;
+                values[5] = b.rect.height;
+            }
+
+            // little-endian bytes, whatever the machine
+            for (uint k=0; k<6; ++k)
+                for (uint b=0; b<4; ++b)
+                    h = (h ^ (((unsigned int)values[k] >> 8*b) & 0xff))*1099511628211ull;
+        }
+    }
+
+    return h;
+}
+
+int main()
+{
+    static const char* names[] = { "constant velocity", "random acceleration", "turning" };
+
+    // seed 7, 100 boxes living 100 frames on average, 500 frames
+    static const unsigned long long expected[] = { 9315090031051406718ull, 13149291826469634813ull, 15967647055630047356ull };
+
+    int failed = 0;
+
+    for (uint m=0; m<3; ++m)
+    {
+        cvip::SceneGenerator::Config config;
+        config.seed = 7;
+        config.numObjects = 100;
+        config.numFrames = 500;
+        config.lifetime = 100;
+        config.motion = (cvip::SceneGenerator::Motion)m;
+
+        cvip::MotSequence detections, truth;
+        cvip::SceneGenerator(config).generate(detections, truth);
+
+        unsigned long long h = hashSequence(detections, hashSequence(truth, 14695981039346656037ull));
+
+        if (h != expected[m]) {
+            std::cerr << names[m] << ": scene hash " << h << "ull, expected " << expected[m] << "ull" << std::endl;
+            failed = 1;
+        }
+    }
+
+    if (!failed)
+        std::cout << "seeded scenes: ok" << std::endl;
+
+    return failed;
+}
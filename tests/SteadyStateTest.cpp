@@ -0,0 +1,85 @@
+#include "KalmanBank.h"
+#include <cmath>
+#include <iostream>
+#include <random>
+
+/**
+ * Steady-state gain under timestamp jitter: a track measured every
+ * frame, with frame intervals computed from jittered timestamps the way
+ * the Tracker does, must take the cached steady-state gain once it has
+ * converged as long as the intervals are within the model's
+ * dtTolerance, and the full update when they are really off-nominal.
+ * Timestamps are like those of a live source: wall-clock jitter of a
+ * millisecond, read from a clock of millisecond resolution.
+ *
+ * @author evangelos sariyanidi / sariyanidi[at]gmail[dot]com
+ * @date april 2011
+ */
+
+// frames on the steady path, out of the frames after the first numWarmup; frames come every
+// scale nominal intervals, timestamps jitter by up to jitter secs. and are rounded to quantum secs.
+static uint steadyFrames(cvip::MotionModel::Kind kind, double scale, double jitter, double quantum,
+                         uint numFrames, uint numWarmup)
+{
+    cvip::MotionModel model(kind);
+    cvip::KalmanBank bank(model);
+    bank.setSteadyState(true);
+
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<double> noise(-jitter, jitter);
+
+    uint slot = bank.alloc(cvip::DetectionRect(100, 100, 50, 50));
+    double lastTimestamp = 0.;
+    uint numSteady = 0;
+
+    for (uint f=1; f<numFrames; ++f)
+    {
+        // constant velocity object
+        double timestamp = f*scale*model.dt + noise(rng);
+        if (quantum > 0)
+            timestamp = std::floor(timestamp/quantum)*quantum;
+
+        bank.predict((float)(timestamp - lastTimestamp));
+        lastTimestamp = timestamp;
+
+        // after predict(), steady means the correction takes the cached gain
+        if (f >= numWarmup && bank.isSteady(slot))
+            ++numSteady;
+
+        bank.correct(slot, cvip::DetectionRect(100 + 2*f, 100 + f, 50, 50));
+    }
+
+    return numSteady;
+}
+
+int main()
+{
+    const uint numFrames = 400, numWarmup = 200;
+    int failed = 0;
+
+    for (uint k=0; k<cvip::MotionModel::NUM_KINDS; ++k)
+    {
+        cvip::MotionModel::Kind kind = (cvip::MotionModel::Kind)k;
+        const char* name = cvip::MotionModel::name(kind);
+
+        // wall-clock jitter of 1 ms on a 1 ms clock: every converged frame is nominal
+        uint n = steadyFrames(kind, 1., 1e-3, 1e-3, numFrames, numWarmup);
+        if (n != numFrames-numWarmup) {
+            std::cerr << name << ": " << n << " of " << numFrames-numWarmup
+                      << " jittered frames on the steady path" << std::endl;
+            failed = 1;
+        }
+
+        // intervals 10% longer than nominal, same jitter: never
+        n = steadyFrames(kind, 1.1, 1e-3, 1e-3, numFrames, numWarmup);
+        if (n != 0) {
+            std::cerr << name << ": " << n << " off-nominal frames on the steady path" << std::endl;
+            failed = 1;
+        }
+    }
+
+    if (!failed)
+        std::cout << "steady state under jitter: ok" << std::endl;
+
+    return failed;
+}